@@ -0,0 +1,283 @@
+////////////////////////////////////////////////////////////////////////////////
+// File:   generate.cpp
+// Author: Patrick Vargas               (patrick.vargas@colorado.edu)
+//
+// Description
+//------------------------------------------------------------------------------
+//     This program writes synthetic input files for the five programs in this
+//   repository, in the formats they read, so they can be benchmarked at sizes
+//   well beyond the small test files that come with them. The same kind, size
+//   and seed always give the same file, on any machine, since the numbers come
+//   from a xorshift generator of our own rather than rand().
+//
+//     Lists, for bubbleSort and mergeSort, hold one integer per line:
+//       random    uniform over [0, 2^31)
+//       sorted    ascending
+//       reversed  descending
+//       few       only sixteen distinct values
+//       sawtooth  ascending runs of a thousand
+//
+//     Graphs, for depthFirstSearch, start with the number of vertices and
+//   then list one edge (u,v) per line:
+//       graph     random, about four edges per vertex, with a path through
+//                 every vertex so the graph is connected
+//       scalefree preferential attachment, two edges per new vertex
+//
+//     Weighted, directed graphs, for floydWarshall, list one edge u,v,w per
+//   line after the number of vertices:
+//       weighted  random, about four edges per vertex, weights 1 to 9
+//
+//     Polygons, for quickHull, list the vertices (x,y), a dash, and then the
+//   edges (i,j) between them by index:
+//       polygon   a convex polygon, with its vertices on a circle
+//       cloud     points scattered over a square, joined in a random order
+//
+// Invariant
+//------------------------------------------------------------------------------
+//     generate <kind> <size> [seed] writes to standard output. The size is
+//   the number of values, vertices or points.
+//
+// References
+//------------------------------------------------------------------------------
+// Marsaglia, G. (2003) Xorshift RNGs. Journal of Statistical Software 8(14).
+//
+// Barabasi, A. and Albert, R. (1999) Emergence of Scaling in Random
+//   Networks. Science 286(5439), pp.509-512.
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+// Few-unique lists: number of distinct values
+#define FEW_VALUES 16
+
+// Sawtooth lists: length of each ascending run
+#define TOOTH 1000
+
+// Random graphs: edges per vertex, besides the path that connects them
+#define DEGREE 4
+
+// Scale-free graphs: edges from each new vertex
+#define ATTACH 2
+
+// Polygons and clouds: coordinates fall in [0, 2 * RADIUS]
+#define RADIUS 1000000000
+
+// State of the xorshift generator
+uint64_t state = 88172645463325252ULL;
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Declarations
+// Draws the next number from the xorshift generator.
+uint64_t draw();
+
+// Draws a number uniformly from [0, n).
+uint64_t below(uint64_t n);
+
+// Writes a list of 'n' integers of the given kind.
+//   Pre:  'kind' is random, sorted, reversed, few or sawtooth.
+//   Post: Returns false if the kind is not a list.
+bool writeList(const char *kind, long n);
+
+// Writes an undirected graph of 'n' vertices of the given kind.
+//   Pre:  'kind' is graph or scalefree.
+//   Post: Returns false if the kind is not a graph.
+bool writeGraph(const char *kind, long n);
+
+// Writes a weighted, directed graph of 'n' vertices.
+void writeWeighted(long n);
+
+// Writes a polygon of 'n' points of the given kind.
+//   Pre:  'kind' is polygon or cloud.
+//   Post: Returns false if the kind is not a polygon.
+bool writePolygon(const char *kind, long n);
+
+// Prints out instructions on the use of the program.
+void usage();
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv) {
+  long n;         // Number of values, vertices or points
+  bool known;     // Whether the kind was recognized
+
+  if (argc < 3) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  n = atol(argv[2]);
+  if (n < 1) {
+    printf("The size must be at least one.\n");
+    return EXIT_FAILURE;
+  }
+  if (argc > 3) {
+    state ^= strtoull(argv[3], NULL, 10) * 0x9E3779B97F4A7C15ULL;
+  }
+  if (state == 0) { state = 1; }
+
+  if (strcmp(argv[1], "weighted") == 0) {
+    writeWeighted(n);
+    known = true;
+  }
+  else {
+    known = writeList(argv[1], n) || writeGraph(argv[1], n) ||
+      writePolygon(argv[1], n);
+  }
+
+  if (!known) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+// Draws the next number from the xorshift generator.
+uint64_t draw() {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Draws a number uniformly from [0, n).
+uint64_t below(uint64_t n) {
+  return draw() % n;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes a list of 'n' integers of the given kind.
+//   Pre:  'kind' is random, sorted, reversed, few or sawtooth.
+//   Post: Returns false if the kind is not a list.
+bool writeList(const char *kind, long n) {
+  double step = 2147483647.0 / n; // Spacing of a sorted list
+
+  if (strcmp(kind, "random") == 0) {
+    for (long i = 0; i < n; ++i) {
+      printf("%lu\n", (unsigned long)below(1UL << 31));
+    }
+  }
+  else if (strcmp(kind, "sorted") == 0) {
+    for (long i = 0; i < n; ++i) { printf("%ld\n", (long)(i * step)); }
+  }
+  else if (strcmp(kind, "reversed") == 0) {
+    for (long i = n - 1; i >= 0; --i) { printf("%ld\n", (long)(i * step)); }
+  }
+  else if (strcmp(kind, "few") == 0) {
+    for (long i = 0; i < n; ++i) {
+      printf("%lu\n", (unsigned long)below(FEW_VALUES));
+    }
+  }
+  else if (strcmp(kind, "sawtooth") == 0) {
+    for (long i = 0; i < n; ++i) { printf("%ld\n", i % TOOTH); }
+  }
+  else { return false; }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes an undirected graph of 'n' vertices of the given kind.
+//   Pre:  'kind' is graph or scalefree.
+//   Post: Returns false if the kind is not a graph.
+bool writeGraph(const char *kind, long n) {
+  vector<long> ends;  // Each edge's endpoints, so picks follow degree
+
+  if (strcmp(kind, "graph") == 0) {
+    printf("%ld\n", n);
+    for (long v = 1; v < n; ++v) { printf("(%ld,%ld)\n", v - 1, v); }
+    for (long e = 0; (n > 1) && (e < DEGREE * n); ++e) {
+      long u = below(n), v = below(n);
+      if (u != v) { printf("(%ld,%ld)\n", u, v); }
+    }
+  }
+  else if (strcmp(kind, "scalefree") == 0) {
+    printf("%ld\n", n);
+    for (long v = 1; v < n; ++v) {
+      // The second vertex can only join the first; later ones pick their
+      //   neighbors in proportion to degree
+      for (int k = 0; k < ((v == 1) ? 1 : ATTACH); ++k) {
+	long u = (v == 1) ? 0 : ends[below(ends.size())];
+	if (u == v) { continue; }
+	printf("(%ld,%ld)\n", u, v);
+	ends.push_back(u);
+	ends.push_back(v);
+      }
+    }
+  }
+  else { return false; }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes a weighted, directed graph of 'n' vertices.
+void writeWeighted(long n) {
+  printf("%ld\n", n);
+  for (long e = 0; (n > 1) && (e < DEGREE * n); ++e) {
+    long u = below(n), v = below(n);
+    if (u != v) {
+      printf("%ld,%ld,%lu\n", u, v, (unsigned long)(1 + below(9)));
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes a polygon of 'n' points of the given kind.
+//   Pre:  'kind' is polygon or cloud.
+//   Post: Returns false if the kind is not a polygon.
+bool writePolygon(const char *kind, long n) {
+  vector<long> order; // Order the points are joined in
+  double angle;       // Of each point of a convex polygon
+
+  if (strcmp(kind, "polygon") == 0) {
+    for (long i = 0; i < n; ++i) {
+      angle = 2 * M_PI * i / n;
+      printf("(%ld,%ld)\n", (long)(RADIUS + RADIUS * cos(angle)),
+	     (long)(RADIUS + RADIUS * sin(angle)));
+    }
+    for (long i = 0; i < n; ++i) { order.push_back(i); }
+  }
+  else if (strcmp(kind, "cloud") == 0) {
+    for (long i = 0; i < n; ++i) {
+      printf("(%lu,%lu)\n", (unsigned long)below(2UL * RADIUS),
+	     (unsigned long)below(2UL * RADIUS));
+    }
+    // Join the points in a random order (Fisher-Yates)
+    for (long i = 0; i < n; ++i) { order.push_back(i); }
+    for (long i = n - 1; i > 0; --i) { swap(order[i], order[below(i + 1)]); }
+  }
+  else { return false; }
+
+  printf("-\n");
+  for (long i = 0; (n > 1) && (i < n); ++i) {
+    printf("(%ld,%ld)\n", order[i], order[(i + 1) % n]);
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints out instructions on the use of the program.
+void usage() {
+  printf("Usage: generate <kind> <size> [seed]\n"
+	 "Lists:\t\trandom, sorted, reversed, few, sawtooth\n"
+	 "Graphs:\t\tgraph, scalefree\n"
+	 "Weighted:\tweighted\n"
+	 "Polygons:\tpolygon, cloud\n\n");
+}
+////////////////////////////////////////////////////////////////////////////////
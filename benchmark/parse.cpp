@@ -0,0 +1,329 @@
+////////////////////////////////////////////////////////////////////////////////
+// File:   parse.cpp
+// Author: Patrick Vargas               (patrick.vargas@colorado.edu)
+//
+// Description
+//------------------------------------------------------------------------------
+//     This program times the two ways the sorting programs have read a list
+//   of integers, on the same file: the way they read it now, checking the
+//   file a vector register at a time with validBlock() and converting eight
+//   digits at a time with parseDigits(), and the way they first read it,
+//   checking each entry with isValid() and then converting it again with
+//   atoi(). It reports the time of each, per value, and the speedup.
+//
+//     validBlock(), parseDigits() and scanList() are those of mergeSort, and
+//   isValid() that of the original programs, so the times are of the same
+//   code the programs run.
+//
+// Invariant
+//------------------------------------------------------------------------------
+//     parse [-j] <file> reads a list from ./generate, one integer per line.
+//   Each way is run PARSE_REPEAT times on the file, already in memory, and
+//   the best time kept. With -j the times are printed as JSON on standard
+//   error, in the form the programs use, the new way as the ingest phase and
+//   the old as the atoi phase.
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Number of bytes validated ahead of the parser in scanList()
+#define SCAN_CHUNK 65536
+
+// Runs of each way; the best is kept
+#define PARSE_REPEAT 5
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Declarations
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned.
+const char *parseDigits(const char *next, const char *end, unsigned int &value);
+
+// Scans a memory-mapped list of integers in place, without copying.
+//   Pre:  'next' and 'end' bound the contents of the file; 'list' has been
+//         reserved with enough room for the expected number of entries.
+//   Post: Each whitespace separated entry is appended to 'list'. Returns
+//         false if an entry contains anything other than digits.
+bool scanList(const char *next, const char *end, vector<int> &list);
+
+// Checks a block of the file a whole vector register at a time.
+//   Pre:  'next' and 'end' bound the block to be checked.
+//   Post: Returns true if the block holds only digits and whitespace.
+bool validBlock(const char *next, const char *end);
+
+// Reads the list as the programs first did: each entry is copied out, checked
+//   by isValid() and converted by atoi().
+//   Pre:  'next' and 'end' bound the contents of the file.
+//   Post: Each entry is appended to 'list'. Returns false if one contains
+//         anything other than digits.
+bool scanTokens(const char *next, const char *end, vector<int> &list);
+
+// Tests each number in vector, and checks each character is a digit.
+//   Pre:  A string to be checked.
+//   Post: Returns true if string is all digits; false otherwise.
+bool isValid(const string& expr);
+
+// Seconds on the monotonic clock.
+double now();
+
+// Prints out instructions on the use of the program.
+void usage();
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv) {
+  bool json = false;  // Print the times as JSON
+  int fd;             // The list
+  struct stat info;   // For its size
+  const char *data;   // Its contents, mapped
+  vector<int> fast, slow; // The list read each way
+  double start;       // When a run started
+  double best[2] = { 0, 0 }; // Best time of the new way and the old
+  volatile char touch = 0;   // Reads of each page, before timing
+  bool valid = true;  // Whether the file was read
+
+  if ((argc > 1) && (strcmp(argv[1], "-j") == 0)) {
+    json = true;
+    --argc;
+    ++argv;
+  }
+  if (argc != 2) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  fd = open(argv[1], O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &info) < 0) || (info.st_size == 0)) {
+    printf("Unable to open \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  data = (const char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    printf("Unable to read \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  // Fault the whole file in first, so neither way pays for it
+  for (off_t i = 0; i < info.st_size; i += 4096) { touch += data[i]; }
+
+  for (int run = 0; valid && (run < PARSE_REPEAT); ++run) {
+    fast.clear();
+    fast.reserve(info.st_size / 2 + 1);
+    start = now();
+    valid = scanList(data, data + info.st_size, fast);
+    start = now() - start;
+    if ((run == 0) || (start < best[0])) { best[0] = start; }
+
+    slow.clear();
+    slow.reserve(info.st_size / 2 + 1);
+    start = now();
+    valid = valid && scanTokens(data, data + info.st_size, slow);
+    start = now() - start;
+    if ((run == 0) || (start < best[1])) { best[1] = start; }
+  }
+  munmap((void *)data, info.st_size);
+
+  if (!valid) {
+    printf("File contains invalid characters.\n");
+    return EXIT_FAILURE;
+  }
+  if (fast != slow) {
+    printf("The two ways read different lists.\n");
+    return EXIT_FAILURE;
+  }
+  if (best[0] <= 0) { best[0] = 1e-9; }
+
+  printf("Values:\t\t%lu\n"
+	 "validBlock():\t%.6f s, %.2f ns/value\n"
+	 "isValid():\t%.6f s, %.2f ns/value\n"
+	 "Speedup:\t%.2fx\n",
+	 (unsigned long)fast.size(),
+	 best[0], best[0] * 1e9 / (fast.size() ? fast.size() : 1),
+	 best[1], best[1] * 1e9 / (fast.size() ? fast.size() : 1),
+	 best[1] / best[0]);
+  if (json) {
+    fprintf(stderr, "{\"tool\": \"parse\", \"phases\": ["
+	    "{\"name\": \"ingest\", \"seconds\": %.6f}, "
+	    "{\"name\": \"atoi\", \"seconds\": %.6f}]}\n", best[0], best[1]);
+  }
+  return EXIT_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+// Converts the run of digits at 'next', eight characters at a time.
+const char *parseDigits(const char *next, const char *end, unsigned int &value) {
+  static const unsigned int scale[9] = { 1, 10, 100, 1000, 10000, 100000,
+					  1000000, 10000000, 100000000 };
+  uint64_t chunk, stop; // Eight characters and the non-digits among them
+  int digits;           // Leading digits in the chunk
+
+  value = 0;
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while ((end - next) >= 8) {
+    memcpy(&chunk, next, 8);
+    chunk ^= 0x3030303030303030ULL; // '0' through '9' become 0 through 9
+
+    // High bit of a byte is set wherever it is not a digit
+    stop = (((chunk & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | chunk)
+      & 0x8080808080808080ULL;
+    digits = stop ? (__builtin_ctzll(stop) >> 3) : 8;
+    if (digits == 0) { return next; }
+
+    // Shift out the rest so the digits are led by zeros, then combine pairs
+    chunk <<= 8 * (8 - digits);
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+    value = value * scale[digits] + (unsigned int)chunk;
+    next += digits;
+    if (digits < 8) { return next; }
+  }
+#endif
+
+  // Tail of the file, one character at a time
+  for (; (next < end) && isdigit((unsigned char)*next); ++next) {
+    value = value * 10 + (*next - '0');
+  }
+  return next;
+}
+
+// Scans a memory-mapped list of integers in place, without copying.
+bool scanList(const char *next, const char *end, vector<int> &list) {
+  const char *checked = next; // Validated up to here
+  const char *limit;          // End of the next chunk to validate
+  unsigned int value;         // Unsigned, so overflow wraps like atoi()
+
+  while (next < end) {
+    // Keep validation a chunk ahead of the parser
+    if (next >= checked) {
+      limit = ((end - checked) > SCAN_CHUNK) ? (checked + SCAN_CHUNK) : end;
+      if (!validBlock(checked, limit)) { return false; }
+      checked = limit;
+    }
+
+    // Skip the whitespace between entries
+    if (!isdigit((unsigned char)*next)) { ++next; continue; }
+
+    next = parseDigits(next, end, value);
+    list.push_back((int)value);
+  }
+  return (checked >= end) || validBlock(checked, end);
+}
+
+// Checks a block of the file a whole vector register at a time.
+bool validBlock(const char *next, const char *end) {
+  // Digits are '0' plus 0 through 9; whitespace is ' ' or '\t' plus 0
+  // through 4. Subtracting the base and taking the unsigned minimum with the
+  // span leaves matching bytes unchanged.
+#if defined(__AVX2__)
+  __m256i wide, digit, space;
+
+  for (; (end - next) >= 32; next += 32) {
+    wide = _mm256_loadu_si256((const __m256i *)next);
+    digit = _mm256_sub_epi8(wide, _mm256_set1_epi8('0'));
+    digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)),
+			      digit);
+    space = _mm256_sub_epi8(wide, _mm256_set1_epi8('\t'));
+    space = _mm256_cmpeq_epi8(_mm256_min_epu8(space, _mm256_set1_epi8(4)),
+			      space);
+    space = _mm256_or_si256(space,
+			    _mm256_cmpeq_epi8(wide, _mm256_set1_epi8(' ')));
+    if (_mm256_movemask_epi8(_mm256_or_si256(digit, space)) != -1) {
+      return false;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i block, digits, spaces;
+
+  for (; (end - next) >= 16; next += 16) {
+    block = _mm_loadu_si128((const __m128i *)next);
+    digits = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+    digits = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    spaces = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    spaces = _mm_cmpeq_epi8(_mm_min_epu8(spaces, _mm_set1_epi8(4)), spaces);
+    spaces = _mm_or_si128(spaces, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+    if (_mm_movemask_epi8(_mm_or_si128(digits, spaces)) != 0xFFFF) {
+      return false;
+    }
+  }
+#endif
+
+  // Whatever is left, or everything without vector support
+  for (; next < end; ++next) {
+    if (!isdigit((unsigned char)*next) && !isspace((unsigned char)*next)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the list as the programs first did.
+bool scanTokens(const char *next, const char *end, vector<int> &list) {
+  const char *start;  // First character of an entry
+  string number;      // The entry, copied out as 'input >> number' did
+
+  while (next < end) {
+    if (isspace((unsigned char)*next)) { ++next; continue; }
+
+    for (start = next; (next < end) && !isspace((unsigned char)*next); ++next);
+    number.assign(start, next - start);
+    if (!isValid(number)) { return false; }
+    list.push_back(atoi(number.c_str()));
+  }
+  return true;
+}
+
+// Tests each number in vector, and checks each character is a digit.
+bool isValid(const string& expr) {
+  char next;
+  bool failed = false;
+
+  for (unsigned int i = 0; !failed && (i < expr.length()); ++i) {
+    next = expr[i];
+    if (!(isdigit(next))) { failed = true; }
+  }
+  return !failed;
+}
+
+// Seconds on the monotonic clock.
+double now() {
+  struct timespec clock;
+
+  clock_gettime(CLOCK_MONOTONIC, &clock);
+  return clock.tv_sec + clock.tv_nsec / 1e9;
+}
+
+// Prints out instructions on the use of the program.
+void usage() {
+  printf("Usage: parse [-j] <list>\n"
+	 "Times reading a list of integers with validBlock() and\n"
+	 "parseDigits() against isValid() and atoi(), on the same file.\n"
+	 "-j also prints the times as JSON on standard error.\n");
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,213 @@
+#!/bin/sh
+################################################################################
+# File:   run.sh
+# Author: Patrick Vargas               (patrick.vargas@colorado.edu)
+#
+# Description
+#-------------------------------------------------------------------------------
+#     Runs each program of the repository over inputs from ./generate at
+#   several sizes and reports, for each run, the time of its ingest phase and
+#   of its main phase, in seconds and in nanoseconds per element, along with
+#   how the time grows with size: the exponent k in time ~ n^k between each
+#   size and the one before. The times are taken from the JSON the programs
+#   print with -j, the best of BENCH_REPEAT runs.
+#
+#     A run the program cannot handle (an input beyond its limits, or more
+#   memory than BENCH_MEMORY) is reported as n/a.
+#
+#     The parse rows time ./parse on a random list: the ingest phase reads it
+#   as the sorting programs now do, with validBlock() and parseDigits(), and
+#   the atoi phase as they first did, with isValid() and atoi(). The speedup
+#   of the one over the other follows the table.
+#
+# Usage
+#-------------------------------------------------------------------------------
+#   run.sh [-o <file>] [-c <baseline>]
+#     -o <file>      Also write the results to a file, to serve as a baseline
+#     -c <baseline>  Compare with a baseline, and fail if any phase of at
+#                    least BENCH_FLOOR seconds is more than BENCH_THRESHOLD
+#                    percent slower per element, or has no time where the
+#                    baseline has one
+#
+#   The sizes may be set with BUBBLE_SIZES, SORT_SIZES, GRAPH_SIZES,
+#   FLOYD_SIZES, HULL_SIZES and PARSE_SIZES.
+################################################################################
+
+BUBBLE_SIZES=${BUBBLE_SIZES:-"1000 3000 10000"}
+SORT_SIZES=${SORT_SIZES:-"10000 100000 1000000"}
+GRAPH_SIZES=${GRAPH_SIZES:-"1000 10000 100000"}
+FLOYD_SIZES=${FLOYD_SIZES:-"100 300 1000"}
+HULL_SIZES=${HULL_SIZES:-"1000 10000 100000"}
+PARSE_SIZES=${PARSE_SIZES:-"100000 1000000"}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_MEMORY=${BENCH_MEMORY:-4096}      # MB a run may use
+BENCH_TIMEOUT=${BENCH_TIMEOUT:-300}     # Seconds a run may take
+BENCH_THRESHOLD=${BENCH_THRESHOLD:-25}  # Percent slower that fails -c
+BENCH_FLOOR=${BENCH_FLOOR:-0.001}       # Shortest phase -c will judge
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+GENERATE=$HERE/generate
+OUTPUT=
+BASELINE=
+
+while getopts "o:c:" flag; do
+  case $flag in
+    o) OUTPUT=$OPTARG ;;
+    c) BASELINE=$OPTARG ;;
+    *) sed -n '/^# Usage/,/^####/p' "$0"; exit 1 ;;
+  esac
+done
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/bench.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+RESULTS=$WORK/results
+
+if command -v timeout > /dev/null 2>&1; then LIMIT="timeout $BENCH_TIMEOUT"
+else LIMIT=; fi
+
+################################################################################
+# Writes the input of a kind and size, once.
+#   input <kind> <size>
+input() {
+  file=$WORK/$1.$2.txt
+  [ -f "$file" ] || "$GENERATE" "$1" "$2" > "$file"
+  echo "$file"
+}
+
+################################################################################
+# Runs a program once on an input and prints the JSON of its phases.
+#   once <tool> <flags> <file> <size>
+once() {
+  (
+    cd "$WORK" || exit 1
+    rm -f output.txt output.bin # Truncating the last run's output is slow
+    ulimit -v $((BENCH_MEMORY * 1024)) 2> /dev/null
+    case $1 in
+      bubbleSort)       $LIMIT "$HERE/../bubbleSort/swap" $2 -j "$3" ;;
+      mergeSort)        $LIMIT "$HERE/../mergeSort/merge" $2 -j "$3" ;;
+      floydWarshall)    $LIMIT "$HERE/../floydWarshall/trans" $2 -j "$3" ;;
+      depthFirstSearch) printf '%s\n0\n%s\n0\nquit\n' "$3" $(($4 - 1)) |
+			$LIMIT "$HERE/../depthFirstSearch/graph" $2 -j ;;
+      quickHull)        printf '%s\nquit\n' "$3" |
+			$LIMIT "$HERE/../quickHull/poly" $2 -j ;;
+      parse)            $LIMIT "$HERE/parse" $2 -j "$3" ;;
+    esac
+  ) 2>&1 > /dev/null < /dev/null | grep '^{"tool"'
+}
+
+################################################################################
+# Times a program on an input, best of BENCH_REPEAT, and records its ingest
+#   and main phases.
+#   measure <tool> <algorithm> <flags> <kind> <size> <main phase>
+measure() {
+  file=$(input "$4" "$5")
+  best=
+  repeat=0
+  while [ $repeat -lt "$BENCH_REPEAT" ]; do
+    json=$(once "$1" "$3" "$file" "$5")
+    best="$best$json
+"
+    repeat=$((repeat + 1))
+  done
+  for phase in ingest "$6"; do
+    seconds=$(echo "$best" |
+	      sed -n "s/.*\"name\": \"$phase\", \"seconds\": \([0-9.]*\).*/\1/p" |
+	      sort -g | head -n 1)
+    echo "$1 $2 $4 $5 $phase ${seconds:-n/a}" >> "$RESULTS"
+  done
+  printf '.' >&2
+}
+
+################################################################################
+: > "$RESULTS"
+for kind in random sorted reversed few sawtooth; do
+  for n in $BUBBLE_SIZES; do
+    measure bubbleSort bubble "" $kind $n sort
+    measure bubbleSort lastswap "-l" $kind $n sort
+    measure bubbleSort shaker "-c" $kind $n sort
+    measure bubbleSort transpose "-p 0" $kind $n sort
+  done
+  for n in $SORT_SIZES; do
+    measure mergeSort merge "" $kind $n sort
+    measure mergeSort bottomup "-i" $kind $n sort
+    measure mergeSort adaptive "-a" $kind $n sort
+    measure mergeSort radix "-r" $kind $n sort
+    measure mergeSort parallel "-p 4" $kind $n sort
+  done
+done
+for kind in graph scalefree; do
+  for n in $GRAPH_SIZES; do
+    measure depthFirstSearch dfs "" $kind $n search
+    measure depthFirstSearch bfs "-b" $kind $n search
+  done
+done
+for n in $FLOYD_SIZES; do
+  measure floydWarshall floyd "" weighted $n floyd
+  measure floydWarshall warshall "" weighted $n warshall
+done
+for kind in polygon cloud; do
+  for n in $HULL_SIZES; do measure quickHull quickhull "" $kind $n hull; done
+done
+for n in $PARSE_SIZES; do measure parse digits "" random $n atoi; done
+echo >&2
+
+# Per-element times, and the growth exponent from the size before
+awk '
+  BEGIN { printf "%-16s %-9s %-9s %9s %-9s %11s %11s %6s\n", "# tool",
+	  "algorithm", "input", "n", "phase", "seconds", "ns/elem", "k" }
+  {
+    key = $1 " " $2 " " $3 " " $5
+    ns = ($6 == "n/a") ? "n/a" : sprintf("%.2f", $6 * 1e9 / $4)
+    k = "-"
+    if ((key in last) && ($6 != "n/a") && (last[key] != "n/a") &&
+	(last[key] > 0) && ($6 > 0)) {
+      k = sprintf("%.2f", log($6 / last[key]) / log($4 / size[key]))
+    }
+    last[key] = $6
+    size[key] = $4
+    printf "%-16s %-9s %-9s %9d %-9s %11s %11s %6s\n", $1, $2, $3, $4, $5,
+	   $6, ns, k
+  }' "$RESULTS" > "$RESULTS.table"
+
+# Speedup of the vector parser over isValid() and atoi(), as comments so a
+#   comparison passes over them
+awk '
+  ($1 == "parse") && ($5 == "ingest") { fast[$4] = $6 }
+  ($1 == "parse") && ($5 == "atoi") && ($4 in fast) && ($6 != "n/a") &&
+    (fast[$4] != "n/a") && (fast[$4] > 0) {
+    printf "# parse speedup at %d values: %.2fx over isValid() and atoi()\n",
+	   $4, $6 / fast[$4]
+  }' "$RESULTS" >> "$RESULTS.table"
+
+cat "$RESULTS.table"
+if [ -n "$OUTPUT" ]; then
+  {
+    echo "# Benchmark baseline: $(uname -srm), $(date -u +%Y-%m-%d)"
+    echo "# $(grep -m 1 'model name' /proc/cpuinfo 2> /dev/null | cut -d: -f2-)"
+    cat "$RESULTS.table"
+  } > "$OUTPUT"
+fi
+
+# Compare per-element times with the baseline
+if [ -n "$BASELINE" ]; then
+  awk -v threshold="$BENCH_THRESHOLD" -v floor="$BENCH_FLOOR" '
+    /^#/ { next }
+    FNR == NR { base[$1 " " $2 " " $3 " " $4 " " $5] = $7; next }
+    {
+      key = $1 " " $2 " " $3 " " $4 " " $5
+      if (!(key in base) || (base[key] == "n/a")) { next }
+      if ($7 == "n/a") {
+	printf "MISSING %s: n/a, was %s ns/elem\n", key, base[key]
+	failed = 1
+	next
+      }
+      change = 100 * ($7 / base[key] - 1)
+      if ((change > threshold) && ($6 >= floor)) {
+	printf "REGRESSION %s: %s ns/elem, was %s (%+.0f%%)\n", key, $7,
+	       base[key], change
+	failed = 1
+      }
+    }
+    END { exit failed }' "$BASELINE" "$RESULTS.table" || exit 1
+  echo "No regressions against $BASELINE."
+fi
@@ -14,6 +14,24 @@
 //   reached, the same procedure is applied again, going to n - 1, where 
 //   n = number of elements in the vector.
 //
+//     Two variants cut the passes on nearly sorted lists. With -l each pass
+//   ends where the one before made its last swap, since everything past it
+//   is already in place. With -c the passes go forward and backward in turn
+//   (cocktail shaker sort), so a small value near the end, which a forward
+//   pass moves only one place, reaches the front in a single backward pass.
+//
+//     With -p the list is sorted by odd-even transposition instead, the same
+//   exchange of neighbors done in phases: even phases compare the pairs
+//   (0, 1), (2, 3), ... and odd phases the pairs (1, 2), (3, 4), .... The pairs
+//   of a phase are independent, so they are split between threads, which
+//   wait for each other at a barrier between phases, and each thread
+//   compare-exchanges four pairs at once in a vector register.
+//
+//     The bubble sorts are templates over the type of key and the order it is
+//   sorted in, compiled for 32 and 64-bit ints, unsigned 64-bit ints, and
+//   records that carry a payload along with their key. The program itself
+//   sorts ints.
+//
 // Invariant
 //------------------------------------------------------------------------------
 //     The input to this program is a file name of a list of integers,
@@ -35,43 +53,456 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
+#include <glob.h>
 #include <iostream>
+#include <pthread.h>
+#include <stdint.h>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
-ifstream input;
 ofstream output;
+
+// Number of bytes validated ahead of the parser in scanList()
+#define SCAN_CHUNK 65536
+
+// LSD radix sort: bits per digit, passes to cover 32 bits, and ints gathered
+//   per bucket (one 64-byte cache line) before they are written out together.
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES 3
+#define COMBINE 16
+
+// Odd-even transposition sort: fewest pairs a thread takes in each phase, so
+//   short lists are not spread over threads that would only wait for others
+#define TRANSPOSE_GRAIN 4096
+
+// Sorting network: most ints sorted at once by sortNetwork()
+#define NETWORK_SIZE 32
+
+// Buffered writer: bytes gathered before each write() of the sorted list
+#define WRITE_BUFFER (1 << 20)
+
+// Bytes read from a stream at a time, into each of two buffers
+#define STREAM_CHUNK (1 << 20)
+
+// Profile: hardware counters read around each phase, named in counterNames
+#define COUNTERS 4
+
+// Batch sort: memory held by all files at once, in MB, and the memory a file
+//   is taken to need, per byte of it
+#define BATCH_BUDGET 1024
+#define BATCH_FACTOR 5
+
+// Binary list format: magic number at the start of the header
+#define BINARY_MAGIC "SORT"
+
+// The binary list format is little-endian; swap on big-endian hosts
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define LITTLE32(x) __builtin_bswap32(x)
+#define LITTLE64(x) __builtin_bswap64(x)
+#else
+#define LITTLE32(x) (x)
+#define LITTLE64(x) (x)
+#endif
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Global variables for outputting information. Each thread of a batch sorts
+//   a file of its own, so each keeps its own.
+__thread long long compare = 0; // Number of comparisons made
+__thread long long swaps = 0;   // Number of swaps performed
+__thread long long passes = 0;  // Number of passes over the list
+__thread int length = 0;  // Size of List
+
+// Names of the hardware counters of a profile, as reported
+const char *counterNames[COUNTERS] = { "cycles", "instructions",
+				       "branch-misses", "llc-misses" };
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Structs and Such
+// Header of the binary list format. The values follow as raw little-endian
+//   ints of the given width; at 16 bytes the header keeps them aligned, so a
+//   mapped file can be read in place.
+struct binaryHeader {
+  char magic[4];  // BINARY_MAGIC
+  uint32_t width; // Bytes per value: 4 (int32) or 8 (int64)
+  uint64_t count; // Number of values
+};
+
+// Wall time and hardware counters of one phase of the program. A phase run
+//   more than once adds up.
+struct phase {
+  const char *name;          // As reported
+  double seconds;            // Wall time
+  long long count[COUNTERS]; // Counted events; -1 where unavailable
+};
+
+// Timing of a run: the counters, the phase under way and those seen so far.
+struct profile {
+  int fd[COUNTERS];          // From perf_event_open(), or -1
+  long long base[COUNTERS];  // Counts when the current phase started
+  struct timespec start;     // Time when it started
+  size_t current;            // Its place in 'phases'
+  vector<phase> phases;      // In the order first started
+};
+
+// Two buffers for reading a stream: a reader thread fills one while the
+//   other is parsed, and they trade places at each chunk.
+struct stream {
+  int fd;                 // Where the list comes from
+  char *buffer[2];        // STREAM_CHUNK bytes each
+  ssize_t fill[2];        // Bytes read into each; 0 at the end, < 0 on error
+  bool full[2];           // Filled and waiting to be parsed
+  pthread_mutex_t lock;   // Guards 'fill' and 'full'
+  pthread_cond_t changed; // Signalled as a buffer is filled or given back
+};
+
+// A key with a payload carried along with it, such as where it came from.
+typedef pair<int64_t, int64_t> record;
+
+// Orders records, or any pairs, by their keys alone.
+struct byKey {
+  template <class Pair>
+  bool operator()(const Pair& a, const Pair& b) const {
+    return a.first < b.first;
+  }
+};
+
+// One thread of an odd-even transposition sort, with counts of its own so
+//   the threads never share a cache line while counting.
+struct transposer {
+  pthread_t thread;
+  struct transposition *sort; // Shared by every thread
+  int id;                     // Which share of each phase this thread takes
+  long long compare;          // Compares made by this thread
+  long long swaps;            // Swaps made by this thread
+  int swapped[3];             // Swaps in the last three phases, by phase % 3
+} __attribute__((aligned(64)));
+
+// An odd-even transposition sort under way.
+struct transposition {
+  int *list;                  // Being sorted
+  int n;                      // Its length
+  int threads;                // Number sharing each phase
+  pthread_barrier_t phase;    // Passed by every thread at the end of a phase
+  transposer *team;           // The threads, 'threads' of them
+};
+
+// Shared by the threads of a batch sort: the files still to be sorted, the
+//   memory they may hold between them, and the totals for the summary.
+struct batch {
+  vector<string> names;   // Input files
+  size_t next;            // Next file to be handed out
+  size_t budget, held;    // Bytes the files may hold at once, and do hold
+  bool radix, network;    // Choice of sort, as on the command line
+  bool shaker, bounded;
+  bool binary;            // Binary output
+  long long values;       // Values sorted
+  long long bytes;        // Bytes read
+  int failed;             // Files that could not be sorted
+  pthread_mutex_t lock;   // Guards all of the above that changes
+  pthread_cond_t freed;   // Signalled as a file gives back its memory
+};
+
+// A buffered writer over a file descriptor, for writing the sorted list a
+//   megabyte at a time instead of a line at a time.
+struct writer {
+  int fd;       // Where the buffer goes
+  char *buffer; // WRITE_BUFFER bytes
+  size_t fill;  // Bytes waiting to be written
+  bool binary;  // Raw ints rather than lines of text
+};
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Global variables for outputting information
-int compare = 0; // Number of comparisons made
-int swaps = 0;   // Number of swaps performed
-int length = 0;  // Size of List
+// Sorting network building blocks, inline so the registers never leave.
+//
+// Puts the smaller of a and b in a and the larger in b, without a branch.
+inline void exchange(int& a, int& b) {
+  int low = min(a, b);
+  b = max(a, b);
+  a = low;
+}
+
+#if defined(__AVX2__)
+// Compare-exchanges each lane of v with the same lane of p, a permutation of
+//   v; the lanes set in 'take' keep the larger value.
+template <int take>
+inline __m256i exchange8(__m256i v, __m256i p) {
+  return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p),
+			    take);
+}
+
+// Lanes of v in the given order.
+inline __m256i lanes(__m256i v, int a, int b, int c, int d,
+		     int e, int f, int g, int h) {
+  return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(a, b, c, d,
+							  e, f, g, h));
+}
+
+// Sorts a bitonic register: compare-exchange at distances 4, 2 and 1.
+inline __m256i clean8(__m256i v) {
+  v = exchange8<0xF0>(v, lanes(v, 4, 5, 6, 7, 0, 1, 2, 3));
+  v = exchange8<0xCC>(v, lanes(v, 2, 3, 0, 1, 6, 7, 4, 5));
+  v = exchange8<0xAA>(v, lanes(v, 1, 0, 3, 2, 5, 4, 7, 6));
+  return v;
+}
+
+// Sorts the eight lanes of a register: pairs and quads are sorted up and
+//   down alternately, leaving one bitonic sequence to clean.
+inline __m256i sort8(__m256i v) {
+  v = exchange8<0x66>(v, lanes(v, 1, 0, 3, 2, 5, 4, 7, 6));
+  v = exchange8<0x3C>(v, lanes(v, 2, 3, 0, 1, 6, 7, 4, 5));
+  v = exchange8<0x5A>(v, lanes(v, 1, 0, 3, 2, 5, 4, 7, 6));
+  return clean8(v);
+}
+
+// Merges two sorted registers; a gets the smallest eight, b the largest.
+inline void merge16(__m256i& a, __m256i& b) {
+  __m256i back = lanes(b, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i low = _mm256_min_epi32(a, back);
+
+  b = clean8(_mm256_max_epi32(a, back));
+  a = clean8(low);
+}
+
+// Merges the sorted sixteen in a, b with the sorted sixteen in c, d.
+inline void merge32(__m256i& a, __m256i& b, __m256i& c, __m256i& d) {
+  __m256i backC = lanes(c, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i backD = lanes(d, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i low1 = _mm256_min_epi32(a, backD), high1 = _mm256_max_epi32(a, backD);
+  __m256i low2 = _mm256_min_epi32(b, backC), high2 = _mm256_max_epi32(b, backC);
+
+  // Each half is now bitonic; clean it at distance eight, then within
+  a = clean8(_mm256_min_epi32(low1, low2));
+  b = clean8(_mm256_max_epi32(low1, low2));
+  c = clean8(_mm256_min_epi32(high1, high2));
+  d = clean8(_mm256_max_epi32(high1, high2));
+}
+#endif
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Declarations
 //
 // Sorts vector using a bubble sort implementaion, as described above.
-//   Pre:  A vector of ints.
-//   Post: A vector of ints, sorted in ascending order.
-void BubbleSort(vector<int> &numbers);
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void BubbleSort(vector<Key> &numbers, Less before);
+
+// Sorts vector by bubble sort, ending each pass at the last swap of the pass
+//   before it, past which the list is already sorted.
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void lastSwapSort(vector<Key> &numbers, Less before);
 
-// Open file and import list into a vector.
+// Sorts vector by cocktail shaker sort: bubble sort passes alternate between
+//   forward and backward, and each is bounded by the last swap of its kind.
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void cocktailSort(vector<Key> &numbers, Less before);
+
+// Sorts vector by odd-even transposition with a team of threads, which share
+//   the pairs of each phase and meet at a barrier after it.
+//   Pre:  A vector of ints and the number of threads.
+//   Post: A vector of ints, sorted in ascending order. The compares and swaps
+//         of every thread are added to the globals.
+void oddEvenSort(vector<int> &numbers, int count);
+
+// Body of each thread of oddEvenSort(); runs phases until an even and an odd
+//   phase in a row make no swaps.
+void* transposeLoop(void* arg);
+
+// Compare-exchanges the pairs (list[2k], list[2k + 1]) for k < pairs, four
+//   pairs at a time with AVX2.
+//   Post: Returns the number of swaps made.
+int transposePairs(int *list, int pairs);
+
+// Open file and import list into a vector, from text or the binary format.
 //   Pre:  The name of the file containing the list of numbers to be sorted.
 //   Post: A vector of the newly imported list of numbers.
 vector<int> importFile(string file_name);
 
-// Tests each number in vector, and checks each character is a digit.
-//   Pre:  A string to be checked.
-//   Post: Returns true if string is all digits; false otherwise.
-bool isValid(const string &expr);
+// Maps a file into memory for reading from front to back.
+//   Pre:  The name of the file to map.
+//   Post: Returns the contents of the file and stores its size in 'size', or
+//         returns NULL if the file is empty. Exits if it cannot be read.
+const char *mapFile(string file_name, size_t &size);
+
+// Reads a list from a stream, such as standard input. Chunks are read by a
+//   second thread into one buffer while the other is parsed; a binary list
+//   is known by its magic number and its values are taken raw.
+//   Pre:  A file descriptor open for reading.
+//   Post: A vector of the newly imported list of numbers.
+vector<int> readStream(int fd);
+
+// Body of the reader thread of readStream(); fills the buffers in turn.
+void* fillStream(void* arg);
+
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned.
+const char *parseDigits(const char *next, const char *end, unsigned int &value);
+
+// Sorts the vector master by least significant digit radix sort, with
+//   11-bit digits. One read pass counts every digit; each scatter pass goes
+//   through cache-line buffers so writes to the buckets are combined.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order.
+void radixSort(vector<int>& master);
+
+// Sorts a block of at most NETWORK_SIZE ints with a bitonic sorting network.
+//   With AVX2 the block is sorted in four registers of eight ints each;
+//   otherwise the same network is run with branchless compare-exchanges.
+//   Pre:  list[0, n) with n <= NETWORK_SIZE.
+//   Post: list[0, n) is in ascending order.
+void sortNetwork(int* list, int n);
+
+// Scans a memory-mapped list of integers in place, without copying.
+//   Pre:  'next' and 'end' bound the contents of the file; 'list' has been
+//         reserved with enough room for the expected number of entries.
+//   Post: Each whitespace separated entry is appended to 'list'. Returns
+//         false if an entry contains anything other than digits.
+bool scanList(const char *next, const char *end, vector<int> &list);
+
+// Checks a block of the file a whole vector register at a time.
+//   Pre:  'next' and 'end' bound the block to be checked.
+//   Post: Returns true if the block holds only digits and whitespace.
+bool validBlock(const char *next, const char *end);
+
+// Tests for the binary list format by its magic number.
+bool isBinary(const char *data, size_t size);
+
+// Checks the header of a binary list against the size of the file, without
+//   exiting.
+//   Post: Returns NULL with the number of values in 'count', or what is wrong
+//         with the file if the width is unknown or the file is truncated.
+const char *checkBinary(const char *data, size_t size, size_t &count);
+
+// Checks the header of a binary list against the size of the file.
+//   Post: Returns the number of values. Exits if the width is unknown or the
+//         file is truncated.
+size_t binaryCount(const char *data, size_t size);
+
+// Copies values from a binary list into a vector.
+//   Pre:  'data' holds a binary list checked by binaryCount().
+//   Post: Values [first, first + count) are appended to 'list'. Exits if a
+//         64-bit value does not fit in an int.
+void readBinary(const char *data, size_t first, size_t count,
+		vector<int> &list);
+
+// Copies values from a binary list into a vector, without exiting.
+//   Pre:  'data' holds a binary list checked by checkBinary().
+//   Post: Values [first, first + count) are appended to 'list'; returns
+//         false if a 64-bit value does not fit in an int.
+bool copyBinary(const char *data, size_t first, size_t count,
+		vector<int> &list);
+
+// Copies raw little-endian values, 4 or 8 bytes wide, into a vector.
+//   Post: 'count' values are appended to 'list'. Exits if a 64-bit value
+//         does not fit in an int.
+void readValues(const char *values, size_t count, uint32_t width,
+		vector<int> &list);
+
+// Copies raw little-endian values, 4 or 8 bytes wide, into a vector, without
+//   exiting.
+//   Post: 'count' values are appended to 'list'; returns false if a 64-bit
+//         value does not fit in an int.
+bool copyValues(const char *values, size_t count, uint32_t width,
+		vector<int> &list);
+
+// Creates output.bin for a binary list.
+//   Post: Returns the file descriptor. Exits if it cannot be opened.
+int createBinary();
+
+// Starts a binary list of 'count' values on a buffered writer: the header is
+//   written, and the values after it go out as raw ints.
+void writeHeader(writer& out, size_t count);
+
+// Flushes 'output' and opens output.txt again to append the list after it.
+//   Post: Returns the new file descriptor. Exits if it cannot be opened.
+int appendOutput();
+
+// Sorts many files at once, each on a thread of its own, into a file named
+//   after it with ".sorted" added. Files wait for memory while those being
+//   sorted would need more than BATCH_BUDGET between them.
+//   Pre:  The files and choice of sort, and the number of threads.
+//   Post: Each file is sorted and a summary of the throughput is printed.
+void batchSort(batch& job, int count);
+
+// Lists the files of a batch: the names in a manifest, one per line, or
+//   the matches of a wildcard pattern.
+//   Post: The names are added to 'names'. Exits if none are found.
+void listBatch(string source, vector<string>& names);
+
+// Body of each batch thread; sorts files until none are left.
+void* batchLoop(void* arg);
+
+// Sorts one file of a batch, reporting rather than exiting on bad input.
+//   Pre:  The batch and the name of the file.
+//   Post: Returns false if the file could not be sorted; 'length' holds the
+//         number of values sorted.
+bool sortFile(batch& job, const string& name, size_t& length);
+
+// Starts a buffered writer of text on a file descriptor.
+void openWriter(writer& out, int fd);
+
+// Adds an int to a buffered writer: as text on a line of its own, or as a raw
+//   little-endian int for a binary list.
+void writeInt(writer& out, int value);
+
+// Writes out whatever a buffered writer holds. Exits if the write fails.
+void flushWriter(writer& out);
+
+// Flushes a buffered writer and frees its buffer; the descriptor stays open.
+void closeWriter(writer& out);
+
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting);
+
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name);
+
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof);
+
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd);
+
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json);
 
 // Prints out instructions on the use of command line options.
 void usage();
@@ -81,17 +512,60 @@ void usage();
 int main(int argc, char **argv) {
   char c;               // Used for line parsing
   bool verbose = false; // For Diagnostic information.
+  bool radix = false;   // Radix sort instead
+  bool bounded = false; // Passes end at the last swap
+  bool shaker = false;  // Cocktail shaker sort
+  bool transpose = false; // Odd-even transposition sort
+  int count = 0;        // Threads for the odd-even transposition or batch
+  bool network = false; // Sorting network for short lists
+  bool binary = false;  // Binary output
+  bool stream = false;  // Standard input to standard output
+  bool json = false;    // Profile as JSON
+  string manifest;      // Files to sort in a batch
+  batch job;            // The batch sort
   string file_name;
   vector<int> master;
+  writer list, echo;    // Buffered output of the list, and its verbose echo
+  int sorted = STDOUT_FILENO; // Standard output, when streaming
+  profile prof;         // Time and counters of each phase
 
   printf("Welcome to Aperature Laboratories, Department of Software!\n");
 
   // Parse the line
-  while ((c = getopt(argc, argv, "hv")) != EOF) {
+  while ((c = getopt(argc, argv, "Bchjlm:np:rsv")) != EOF) {
     switch (c) {
+    case 'B': // Binary output.
+      binary = true;
+      break;
+    case 'c': // Cocktail shaker sort.
+      shaker = true;
+      break;
     case 'h': // Help message on command line options.
       usage();
       break;
+    case 'j': // Profile as JSON.
+      json = true;
+      break;
+    case 'l': // Each pass ends at the last swap of the one before.
+      bounded = true;
+      break;
+    case 'm': // Batch of files, from a manifest or a pattern.
+      manifest = optarg;
+      break;
+    case 'n': // Sorting network for short lists, which keeps no counters.
+      network = true;
+      break;
+    case 'p': // Odd-even transposition sort, in parallel.
+      transpose = true;
+      count = atoi(optarg);
+      if (count < 1) { count = sysconf(_SC_NPROCESSORS_ONLN); }
+      break;
+    case 'r': // Radix sort, which makes no compares or swaps.
+      radix = true;
+      break;
+    case 's': // Stream from standard input to standard output.
+      stream = true;
+      break;
     case 'v': // Print Diagnostic information.
       verbose = true;
       break;
@@ -100,8 +574,35 @@ int main(int argc, char **argv) {
     }
   }
   if (verbose) { printf("Verbose turned on.\n"); }
+  openProfile(prof, verbose || json);
+
+  // A batch sorts each of its files straight to its own output, one file to
+  //   a thread, so -p sets the threads rather than asking for a parallel sort
+  if (!manifest.empty()) {
+    listBatch(manifest, job.names);
+    job.radix = radix;
+    job.network = network;
+    job.shaker = shaker;
+    job.bounded = bounded;
+    job.binary = binary;
+    if (count == 0) { count = sysconf(_SC_NPROCESSORS_ONLN); }
+    startPhase(prof, "batch");
+    batchSort(job, count);
+    endPhase(prof);
+    if (verbose) { reportProfile(prof, false); }
+    if (json) { reportProfile(prof, true); }
+    printf("Good Bye!\n");
+    return (job.failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
 
-  if (optind == argc) { // No command line arguments
+  // Only the sorted list goes to standard output when streaming; messages,
+  //   even those still buffered, are sent to standard error instead
+  if (stream) {
+    sorted = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    file_name = "(standard input)";
+  }
+  else if (optind == argc) { // No command line arguments
     printf("Please enter the name of the input file: ");
     getline(cin, file_name);
   }
@@ -109,14 +610,20 @@ int main(int argc, char **argv) {
     file_name = argv[optind];
   }
 
-  // Imput file into a vector
-  master = importFile(file_name);
+  // Imput file into a vector. A stream leaves 'output' closed, so the header
+  //   lines written to it are dropped.
+  startPhase(prof, "ingest");
+  if (stream) { master = readStream(STDIN_FILENO); }
+  else {
+    master = importFile(file_name);
 
-  output.open("output.txt");
-  if (output.fail()) {
-    printf("Output file opening failed.\nGood Bye!\n");
-    exit(EXIT_FAILURE);
+    output.open("output.txt");
+    if (output.fail()) {
+      printf("Output file opening failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
   }
+  endPhase(prof);
  
   // Output file name
   if (verbose) { cout << "File Name:\t" << file_name << "\n"; }
@@ -128,19 +635,59 @@ int main(int argc, char **argv) {
   output << "Length:\t\t" << length << "\n";
 
   // Sort the list
-  BubbleSort(master);
+  startPhase(prof, "sort");
+  if (radix) { radixSort(master); }
+  else if (network && (length > 0) && (length <= NETWORK_SIZE)) {
+    sortNetwork(&master[0], length);
+  }
+  else if (transpose) { oddEvenSort(master, count); }
+  else if (shaker) { cocktailSort(master, less<int>()); }
+  else if (bounded) { lastSwapSort(master, less<int>()); }
+  else { BubbleSort(master, less<int>()); }
+  endPhase(prof);
+
+  // Test if list is actually sorted
+  startPhase(prof, "verify");
+  for (int i = 0; i < (length - 1); ++i) {
+    if (master[i] > master[i + 1]) {
+      printf("Sorting algorithm failed!\n");
+      break;
+    }
+  }
+  endPhase(prof);
 
   // Output information of the sort.
-  if (verbose) { printf("Compares:\t%i\nSwaps:\t\t%i\n\n", compare, swaps); }
+  if (verbose) {
+    printf("Compares:\t%lld\nSwaps:\t\t%lld\nPasses:\t\t%lld\n\n", compare,
+	   swaps, passes);
+  }
   output << "Compares:\t" << compare << "\n"
-	 << "Swaps:\t\t" << swaps << "\n\n";
+	 << "Swaps:\t\t" << swaps << "\n"
+	 << "Passes:\t\t" << passes << "\n\n";
 
+  // Write the list through large buffers rather than a line at a time
+  startPhase(prof, "output");
+  if (stream) { openWriter(list, sorted); }
+  else if (binary) { openWriter(list, createBinary()); }
+  else { openWriter(list, appendOutput()); }
+  if (binary) { writeHeader(list, length); }
+  if (verbose) {
+    fflush(stdout);
+    openWriter(echo, STDOUT_FILENO);
+  }
   for (int i = 0; i < length; ++i) {
-    if (verbose) { printf("%i\n", master[i]); }
-    output << master[i] << endl;
+    if (verbose) { writeInt(echo, master[i]); }
+    writeInt(list, master[i]);
   }
+  if (verbose) { closeWriter(echo); }
+  closeWriter(list);
+  close(list.fd);
 
   output.close();
+  endPhase(prof);
+
+  if (verbose) { reportProfile(prof, false); }
+  if (json) { reportProfile(prof, true); }
   printf("Good Bye!\n");
   return EXIT_SUCCESS;
 }
@@ -150,17 +697,20 @@ int main(int argc, char **argv) {
 // Definitions
 //
 // Sorts vector using a bubble sort implementaion, as described above.
-//   Pre:  A vector of ints.
-//   Post: A vector of ints, sorted in ascending order.
-void BubbleSort(vector<int> &numbers) {
-  int temp;              // For swap
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void BubbleSort(vector<Key> &numbers, Less before) {
+  long n = numbers.size();
+  Key temp;              // For swap
   bool made_swap = true; // For unnecessary compares when algorithm finishes
 
-  for (int i = 0; (i < (length - 1)) && (made_swap); ++i) {
+  for (long i = 0; (i < (n - 1)) && (made_swap); ++i) {
     made_swap = false;
-    for (int j = 0; j < (length - 1 - i); ++j) {
+    ++passes;
+    for (long j = 0; j < (n - 1 - i); ++j) {
       ++compare;
-      if (numbers[j + 1] < numbers[j]) { 
+      if (before(numbers[j + 1], numbers[j])) { 
 	temp = numbers[j];
 	numbers[j] = numbers[j + 1];
 	numbers[j + 1] = temp;
@@ -171,56 +721,1257 @@ void BubbleSort(vector<int> &numbers) {
   }
 }
 
-// Open file and import list into a vector.
+// Sorts vector by bubble sort, ending each pass at the last swap of the pass
+//   before it, past which the list is already sorted.
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void lastSwapSort(vector<Key> &numbers, Less before) {
+  Key temp;    // For swap
+  long bound;  // Pairs (j, j + 1) with j < bound are compared
+  long last;   // Where the last swap of a pass was made
+
+  bound = (long)numbers.size() - 1;
+
+  while (bound > 0) {
+    last = 0;
+    ++passes;
+    for (long j = 0; j < bound; ++j) {
+      ++compare;
+      if (before(numbers[j + 1], numbers[j])) {
+	temp = numbers[j];
+	numbers[j] = numbers[j + 1];
+	numbers[j + 1] = temp;
+	++swaps;
+	last = j;
+      }
+    }
+    bound = last;
+  }
+}
+
+// Sorts vector by cocktail shaker sort: bubble sort passes alternate between
+//   forward and backward, and each is bounded by the last swap of its kind.
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void cocktailSort(vector<Key> &numbers, Less before) {
+  Key temp;               // For swap
+  long low = 0;           // Pairs (j, j + 1) with low <= j < high are compared
+  long high = (long)numbers.size() - 1;
+  long last;              // Where the last swap of a pass was made
+
+  while (low < high) {
+    // Forward, carrying the largest value up to 'high'
+    last = low;
+    ++passes;
+    for (long j = low; j < high; ++j) {
+      ++compare;
+      if (before(numbers[j + 1], numbers[j])) {
+	temp = numbers[j];
+	numbers[j] = numbers[j + 1];
+	numbers[j + 1] = temp;
+	++swaps;
+	last = j;
+      }
+    }
+    high = last;
+    if (low >= high) { break; }
+
+    // Backward, carrying the smallest value down to 'low'
+    last = high;
+    ++passes;
+    for (long j = high - 1; j >= low; --j) {
+      ++compare;
+      if (before(numbers[j + 1], numbers[j])) {
+	temp = numbers[j];
+	numbers[j] = numbers[j + 1];
+	numbers[j + 1] = temp;
+	++swaps;
+	last = j;
+      }
+    }
+    low = last + 1;
+  }
+}
+
+// The bubble sorts, compiled for each type of key
+template void BubbleSort(vector<int32_t> &, less<int32_t>);
+template void BubbleSort(vector<int64_t> &, less<int64_t>);
+template void BubbleSort(vector<uint64_t> &, less<uint64_t>);
+template void BubbleSort(vector<record> &, byKey);
+template void lastSwapSort(vector<int32_t> &, less<int32_t>);
+template void lastSwapSort(vector<int64_t> &, less<int64_t>);
+template void lastSwapSort(vector<uint64_t> &, less<uint64_t>);
+template void lastSwapSort(vector<record> &, byKey);
+template void cocktailSort(vector<int32_t> &, less<int32_t>);
+template void cocktailSort(vector<int64_t> &, less<int64_t>);
+template void cocktailSort(vector<uint64_t> &, less<uint64_t>);
+template void cocktailSort(vector<record> &, byKey);
+
+// Sorts vector by odd-even transposition with a team of threads, which share
+//   the pairs of each phase and meet at a barrier after it.
+//   Pre:  A vector of ints and the number of threads.
+//   Post: A vector of ints, sorted in ascending order. The compares and swaps
+//         of every thread are added to the globals.
+void oddEvenSort(vector<int> &numbers, int count) {
+  transposition sort;
+
+  if (length < 2) { return; }
+
+  // No more threads than there are grains of pairs to share
+  sort.list = &numbers[0];
+  sort.n = length;
+  sort.threads = max(1, min(count, (length / 2) / TRANSPOSE_GRAIN));
+  sort.team = new transposer[sort.threads];
+  pthread_barrier_init(&sort.phase, NULL, sort.threads);
+
+  // The main thread is the first of the team
+  for (int i = 0; i < sort.threads; ++i) {
+    sort.team[i].sort = &sort;
+    sort.team[i].id = i;
+    sort.team[i].compare = 0;
+    sort.team[i].swaps = 0;
+  }
+  for (int i = 1; i < sort.threads; ++i) {
+    pthread_create(&sort.team[i].thread, NULL, transposeLoop, &sort.team[i]);
+  }
+  transposeLoop(&sort.team[0]);
+  for (int i = 1; i < sort.threads; ++i) {
+    pthread_join(sort.team[i].thread, NULL);
+  }
+
+  // Add up the counts once, rather than sharing the globals while sorting
+  for (int i = 0; i < sort.threads; ++i) {
+    compare += sort.team[i].compare;
+    swaps += sort.team[i].swaps;
+  }
+  pthread_barrier_destroy(&sort.phase);
+  delete [] sort.team;
+}
+
+// Body of each thread of oddEvenSort(); runs phases until an even and an odd
+//   phase in a row make no swaps.
+void* transposeLoop(void* arg) {
+  transposer *self = (transposer*)arg;
+  transposition *sort = self->sort;
+  long long pairs, first, last;  // Pairs of the phase, and this thread's share
+  int made;                      // Swaps made by this thread in the phase
+  bool quiet;                    // No swaps in this phase or the one before
+
+  for (int p = 0; ; ++p) {
+    pairs = (sort->n - (p & 1)) / 2;
+    first = pairs * self->id / sort->threads;
+    last = pairs * (self->id + 1) / sort->threads;
+    made = transposePairs(sort->list + (p & 1) + 2 * first, last - first);
+    self->compare += last - first;
+    self->swaps += made;
+    self->swapped[p % 3] = made;
+    if (self->id == 0) { ++passes; }
+    pthread_barrier_wait(&sort->phase);
+
+    // Every thread reads the same counts, so all of them stop together. A
+    //   thread writes the next phase's slot only after every thread has
+    //   passed the next barrier, and so is done reading these two.
+    if (p == 0) { continue; }
+    quiet = true;
+    for (int i = 0; i < sort->threads; ++i) {
+      if ((sort->team[i].swapped[p % 3] != 0) ||
+	  (sort->team[i].swapped[(p - 1) % 3] != 0)) {
+	quiet = false;
+      }
+    }
+    if (quiet) { break; }
+  }
+  return NULL;
+}
+
+// Compare-exchanges the pairs (list[2k], list[2k + 1]) for k < pairs, four
+//   pairs at a time with AVX2.
+//   Post: Returns the number of swaps made.
+int transposePairs(int *list, int pairs) {
+  int made = 0;
+  int k = 0;
+
+#if defined(__AVX2__)
+  for (; k + 4 <= pairs; k += 4) {
+    __m256i v = _mm256_loadu_si256((__m256i*)(list + 2 * k));
+    __m256i p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+
+    // The first of each pair is greater than the second where it swaps
+    made += __builtin_popcount(_mm256_movemask_ps(
+      _mm256_castsi256_ps(_mm256_cmpgt_epi32(v, p))) & 0x55);
+    _mm256_storeu_si256((__m256i*)(list + 2 * k), exchange8<0xAA>(v, p));
+  }
+#endif
+  for (; k < pairs; ++k) {
+    if (list[2 * k + 1] < list[2 * k]) { ++made; }
+    exchange(list[2 * k], list[2 * k + 1]);
+  }
+  return made;
+}
+
+// Sorts the vector master by least significant digit radix sort, with
+//   11-bit digits. One read pass counts every digit; each scatter pass goes
+//   through cache-line buffers so writes to the buckets are combined.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order.
+void radixSort(vector<int>& master) {
+  const unsigned int sign = 0x80000000u; // Flipped so negatives sort first
+  const unsigned int mask = RADIX_BUCKETS - 1;
+  int n = master.size();
+  int shift, digit;
+  unsigned int key, total, next;
+  unsigned int *from, *into, *temp, *start;
+  vector<unsigned int> count(RADIX_PASSES * RADIX_BUCKETS, 0);
+  vector<unsigned int> combine(RADIX_BUCKETS * COMBINE);
+  vector<int> fill(RADIX_BUCKETS);
+
+  if (n < 2) { return; }
+  vector<int> scratch(n);
+  from = (unsigned int*)&master[0];
+  into = (unsigned int*)&scratch[0];
+
+  // Count the digits of every pass in a single read of the list
+  for (int i = 0; i < n; ++i) {
+    key = from[i] ^ sign;
+    for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+      ++count[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & mask)];
+    }
+  }
+
+  for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+    shift = pass * RADIX_BITS;
+    start = &count[pass * RADIX_BUCKETS];
+
+    // Nothing moves if every key has the same digit
+    if (start[((from[0] ^ sign) >> shift) & mask] == (unsigned int)n) {
+      continue;
+    }
+
+    // Turn the counts into where each bucket starts
+    total = 0;
+    for (int b = 0; b < RADIX_BUCKETS; ++b) {
+      next = total + start[b];
+      start[b] = total;
+      total = next;
+    }
+
+    // Scatter, a cache line at a time per bucket; order within a bucket is
+    // kept, so each pass is stable
+    fill.assign(RADIX_BUCKETS, 0);
+    for (int i = 0; i < n; ++i) {
+      digit = ((from[i] ^ sign) >> shift) & mask;
+      combine[digit * COMBINE + fill[digit]++] = from[i];
+      if (fill[digit] == COMBINE) {
+	memcpy(into + start[digit], &combine[digit * COMBINE],
+	       COMBINE * sizeof(int));
+	start[digit] += COMBINE;
+	fill[digit] = 0;
+      }
+    }
+    for (int b = 0; b < RADIX_BUCKETS; ++b) {
+      memcpy(into + start[b], &combine[b * COMBINE], fill[b] * sizeof(int));
+    }
+
+    temp = from; from = into; into = temp;
+  }
+
+  if (from != (unsigned int*)&master[0]) { master.swap(scratch); }
+}
+
+// Sorts a block of at most NETWORK_SIZE ints with a bitonic sorting network.
+//   With AVX2 the block is sorted in four registers of eight ints each;
+//   otherwise the same network is run with branchless compare-exchanges.
+//   Pre:  list[0, n) with n <= NETWORK_SIZE.
+//   Post: list[0, n) is in ascending order.
+void sortNetwork(int* list, int n) {
+  int block[NETWORK_SIZE]; // Padded with the largest int
+  int width, k;
+
+  for (width = 8; width < n; width *= 2) { }
+  for (k = 0; k < width; ++k) { block[k] = (k < n) ? list[k] : INT_MAX; }
+
+#if defined(__AVX2__)
+  __m256i r0, r1, r2, r3;
+
+  r0 = sort8(_mm256_loadu_si256((const __m256i*)block));
+  if (width >= 16) {
+    r1 = sort8(_mm256_loadu_si256((const __m256i*)(block + 8)));
+    merge16(r0, r1);
+    if (width == 32) {
+      r2 = sort8(_mm256_loadu_si256((const __m256i*)(block + 16)));
+      r3 = sort8(_mm256_loadu_si256((const __m256i*)(block + 24)));
+      merge16(r2, r3);
+      merge32(r0, r1, r2, r3);
+      _mm256_storeu_si256((__m256i*)(block + 16), r2);
+      _mm256_storeu_si256((__m256i*)(block + 24), r3);
+    }
+    _mm256_storeu_si256((__m256i*)(block + 8), r1);
+  }
+  _mm256_storeu_si256((__m256i*)block, r0);
+#else
+  int lo, j;
+
+  // Blocks of size k are sorted alternately up and down, then each bitonic
+  // block is cleaned at distances k / 2 down to 1
+  for (k = 2; k <= width; k *= 2) {
+    for (j = k / 2; j > 0; j /= 2) {
+      for (lo = 0; lo < width; ++lo) {
+	if ((lo ^ j) > lo) {
+	  if ((lo & k) == 0) { exchange(block[lo], block[lo ^ j]); }
+	  else { exchange(block[lo ^ j], block[lo]); }
+	}
+      }
+    }
+  }
+#endif
+
+  memcpy(list, block, n * sizeof(int));
+}
+
+// Open file and import list into a vector, from text or the binary format.
 //   Pre:  The name of the file containing the list of numbers to be sorted.
 //   Post: A vector of the newly imported list of numbers.
 vector<int> importFile(string file_name) {
   vector<int> newList;
-  string number;
+  const char *data;   // Mapped contents of the file
+  const char *next;   // For counting lines
+  const char *end;    // One past the last character of the file
+  size_t size;        // Size of the file
+  size_t lines = 0;   // Estimate of the number of entries
 
   // Establish connection to input file
-  input.open(file_name.c_str());
-  if (input.fail()) {
+  data = mapFile(file_name, size);
+  output << file_name << "\n";
+
+  // Nothing to read in an empty file
+  if (data == NULL) { return newList; }
+  end = data + size;
+
+  // A binary list is copied straight across
+  if (isBinary(data, size)) {
+    readBinary(data, 0, binaryCount(data, size), newList);
+    munmap((void *)data, size);
+    return newList;
+  }
+
+  // Pre-size the vector from a quick count of the lines
+  next = data;
+  while ((next = (const char *)memchr(next, '\n', end - next)) != NULL) {
+    ++lines;
+    ++next;
+  }
+  newList.reserve(lines + 1);
+
+  // Import numbers into a vector
+  if (!scanList(data, end, newList)) {
+    printf("File contains invalid characters.\n"
+	   "Good Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  munmap((void *)data, size);
+
+  return newList;
+}
+
+// Maps a file into memory for reading from front to back.
+//   Pre:  The name of the file to map.
+//   Post: Returns the contents of the file and stores its size in 'size', or
+//         returns NULL if the file is empty. Exits if it cannot be read.
+const char *mapFile(string file_name, size_t &size) {
+  struct stat info; // For the size of the file
+  void *data;
+  int fd;
+
+  fd = open(file_name.c_str(), O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &info) < 0)) {
     printf("Unable to open \"%s\".\nGood Bye!\n", file_name.c_str());
     exit(EXIT_FAILURE);
   }
-  output << file_name << "\n";
 
-  // Import numbers into a vector
-  while (input.good()) {
-    input >> number;
-    
-    if (!isValid(number)) { 
-      printf("File contains invalid characters.\n"
-	      "Good Bye!\n");
+  size = info.st_size;
+  if (size == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  // The mapping outlives the descriptor
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    printf("Unable to read \"%s\".\nGood Bye!\n", file_name.c_str());
+    exit(EXIT_FAILURE);
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  return (const char *)data;
+}
+
+// Reads a list from a stream, such as standard input. Chunks are read by a
+//   second thread into one buffer while the other is parsed; a binary list
+//   is known by its magic number and its values are taken raw.
+//   Pre:  A file descriptor open for reading.
+//   Post: A vector of the newly imported list of numbers.
+vector<int> readStream(int fd) {
+  stream input;        // The double buffer shared with the reader
+  pthread_t reader;    // Thread filling the buffers
+  vector<int> newList; // Vector to store input
+  vector<char> carry;  // A number split between two chunks
+  const char *data;    // Chunk being parsed
+  const char *end;     // One past its last byte
+  const char *first;   // End of the number carried into it
+  const char *last;    // Start of the number carried out of it
+  ssize_t size = 0;    // Bytes in the chunk
+  bool started = false; // The first chunk has been seen
+  bool binary = false; // The stream is a binary list
+  binaryHeader header; // Its header
+  uint32_t width = 0;  // Bytes per value of it
+  size_t take;         // Bytes that finish a value carried over
+
+  input.fd = fd;
+  for (int side = 0; side < 2; ++side) {
+    input.buffer[side] = new char[STREAM_CHUNK];
+    input.full[side] = false;
+  }
+  pthread_mutex_init(&input.lock, NULL);
+  pthread_cond_init(&input.changed, NULL);
+  pthread_create(&reader, NULL, fillStream, &input);
+
+  for (int side = 0; ; side ^= 1) {
+    // Wait for the reader to fill this side
+    pthread_mutex_lock(&input.lock);
+    while (!input.full[side]) {
+      pthread_cond_wait(&input.changed, &input.lock);
+    }
+    size = input.fill[side];
+    pthread_mutex_unlock(&input.lock);
+    if (size <= 0) { break; }
+
+    data = input.buffer[side];
+    end = data + size;
+
+    // A binary list is known by the magic number at the start of the stream,
+    //   as it is at the start of a file
+    if (!started) {
+      started = true;
+      if (isBinary(data, size)) {
+	memcpy(&header, data, sizeof(header));
+	width = LITTLE32(header.width);
+	if ((width != 4) && (width != 8)) {
+	  printf("Binary file has values of unknown width.\nGood Bye!\n");
+	  exit(EXIT_FAILURE);
+	}
+	binary = true;
+	data += sizeof(header);
+      }
+    }
+
+    // Finish the value carried over, then take the whole values as they are
+    if (binary) {
+      if (!carry.empty()) {
+	take = min((size_t)(end - data), width - carry.size());
+	carry.insert(carry.end(), data, data + take);
+	data += take;
+	if (carry.size() == width) {
+	  readValues(&carry[0], 1, width, newList);
+	  carry.clear();
+	}
+      }
+      readValues(data, (end - data) / width, width, newList);
+      carry.insert(carry.end(), data + (end - data) / width * width, end);
+    }
+
+    // Finish the number carried over, then parse up to the last whitespace
+    else {
+      for (first = data; (first < end) && !isspace((unsigned char)*first);
+	   ++first);
+      carry.insert(carry.end(), data, first);
+      if (first < end) {
+	for (last = end; !isspace((unsigned char)last[-1]); --last);
+	if ((!carry.empty() &&
+	     !scanList(&carry[0], &carry[0] + carry.size(), newList)) ||
+	    !scanList(first, last, newList)) {
+	  printf("File contains invalid characters.\nGood Bye!\n");
+	  exit(EXIT_FAILURE);
+	}
+	carry.assign(last, end);
+      }
+    }
+
+    // Hand the buffer back to the reader
+    pthread_mutex_lock(&input.lock);
+    input.full[side] = false;
+    pthread_cond_broadcast(&input.changed);
+    pthread_mutex_unlock(&input.lock);
+  }
+  pthread_join(reader, NULL);
+
+  if (size < 0) {
+    printf("Standard input could not be read.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  if (binary) {
+    // Bytes past the values the header counts are left, as in a file
+    if (newList.size() < LITTLE64(header.count)) {
+      printf("Binary file is truncated.\nGood Bye!\n");
       exit(EXIT_FAILURE);
     }
-    newList.push_back(atoi(number.c_str()));
+    newList.resize(LITTLE64(header.count));
+  }
+  else if (!carry.empty() &&
+	   !scanList(&carry[0], &carry[0] + carry.size(), newList)) {
+    printf("File contains invalid characters.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
   }
-  input.close();
 
+  pthread_cond_destroy(&input.changed);
+  pthread_mutex_destroy(&input.lock);
+  delete [] input.buffer[0];
+  delete [] input.buffer[1];
   return newList;
 }
 
-// Tests each number in vector, and checks each character is a digit.
-//   Pre:  A string to be checked.
-//   Post: Returns true if string is all digits; false otherwise.
-bool isValid(const string &expr) {
-  char next;
-  bool failed = false;
+// Body of the reader thread of readStream(); fills the buffers in turn.
+void* fillStream(void* arg) {
+  stream *input = (stream *)arg;
+  ssize_t size;       // Bytes read into the buffer so far
+  ssize_t got;        // Bytes from the last read
 
-  for (unsigned int i = 0; !failed && (i < expr.length()); ++i) {
-    next = expr[i];
-    if (!(isdigit(next))) { failed = true; }
+  // Worth a try: a redirected file is read ahead by the kernel
+  posix_fadvise(input->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  for (int side = 0; ; side ^= 1) {
+    pthread_mutex_lock(&input->lock);
+    while (input->full[side]) {
+      pthread_cond_wait(&input->changed, &input->lock);
+    }
+    pthread_mutex_unlock(&input->lock);
+
+    // Fill the whole chunk, so the buffers trade places less often
+    for (size = 0; size < STREAM_CHUNK; size += got) {
+      got = read(input->fd, input->buffer[side] + size, STREAM_CHUNK - size);
+      if ((got < 0) && (errno == EINTR)) { got = 0; continue; }
+      if (got <= 0) { break; }
+    }
+    if (got < 0) { size = -1; }
+
+    pthread_mutex_lock(&input->lock);
+    input->fill[side] = size;
+    input->full[side] = true;
+    pthread_cond_broadcast(&input->changed);
+    pthread_mutex_unlock(&input->lock);
+    if (size <= 0) { break; }
+  }
+  return NULL;
+}
+
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned.
+const char *parseDigits(const char *next, const char *end, unsigned int &value) {
+  static const unsigned int scale[9] = { 1, 10, 100, 1000, 10000, 100000,
+					  1000000, 10000000, 100000000 };
+  uint64_t chunk, stop; // Eight characters and the non-digits among them
+  int digits;           // Leading digits in the chunk
+
+  value = 0;
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while ((end - next) >= 8) {
+    memcpy(&chunk, next, 8);
+    chunk ^= 0x3030303030303030ULL; // '0' through '9' become 0 through 9
+
+    // High bit of a byte is set wherever it is not a digit
+    stop = (((chunk & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | chunk)
+      & 0x8080808080808080ULL;
+    digits = stop ? (__builtin_ctzll(stop) >> 3) : 8;
+    if (digits == 0) { return next; }
+
+    // Shift out the rest so the digits are led by zeros, then combine pairs
+    chunk <<= 8 * (8 - digits);
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+    value = value * scale[digits] + (unsigned int)chunk;
+    next += digits;
+    if (digits < 8) { return next; }
+  }
+#endif
+
+  // Tail of the file, one character at a time
+  for (; (next < end) && isdigit((unsigned char)*next); ++next) {
+    value = value * 10 + (*next - '0');
+  }
+  return next;
+}
+
+// Scans a memory-mapped list of integers in place, without copying.
+//   Pre:  'next' and 'end' bound the contents of the file; 'list' has been
+//         reserved with enough room for the expected number of entries.
+//   Post: Each whitespace separated entry is appended to 'list'. Returns
+//         false if an entry contains anything other than digits.
+bool scanList(const char *next, const char *end, vector<int> &list) {
+  const char *checked = next; // Validated up to here
+  const char *limit;          // End of the next chunk to validate
+  unsigned int value;         // Unsigned, so overflow wraps like atoi()
+
+  while (next < end) {
+    // Keep validation a chunk ahead of the parser
+    if (next >= checked) {
+      limit = ((end - checked) > SCAN_CHUNK) ? (checked + SCAN_CHUNK) : end;
+      if (!validBlock(checked, limit)) { return false; }
+      checked = limit;
+    }
+
+    // Skip the whitespace between entries
+    if (!isdigit((unsigned char)*next)) { ++next; continue; }
+
+    next = parseDigits(next, end, value);
+    list.push_back((int)value);
+  }
+  return (checked >= end) || validBlock(checked, end);
+}
+
+// Checks a block of the file a whole vector register at a time.
+//   Pre:  'next' and 'end' bound the block to be checked.
+//   Post: Returns true if the block holds only digits and whitespace.
+bool validBlock(const char *next, const char *end) {
+  // Digits are '0' plus 0 through 9; whitespace is ' ' or '\t' plus 0 
+  // through 4. Subtracting the base and taking the unsigned minimum with the
+  // span leaves matching bytes unchanged.
+#if defined(__AVX2__)
+  __m256i wide, digit, space;
+
+  for (; (end - next) >= 32; next += 32) {
+    wide = _mm256_loadu_si256((const __m256i *)next);
+    digit = _mm256_sub_epi8(wide, _mm256_set1_epi8('0'));
+    digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)),
+			      digit);
+    space = _mm256_sub_epi8(wide, _mm256_set1_epi8('\t'));
+    space = _mm256_cmpeq_epi8(_mm256_min_epu8(space, _mm256_set1_epi8(4)),
+			      space);
+    space = _mm256_or_si256(space,
+			    _mm256_cmpeq_epi8(wide, _mm256_set1_epi8(' ')));
+    if (_mm256_movemask_epi8(_mm256_or_si256(digit, space)) != -1) {
+      return false;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i block, digits, spaces;
+
+  for (; (end - next) >= 16; next += 16) {
+    block = _mm_loadu_si128((const __m128i *)next);
+    digits = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+    digits = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    spaces = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    spaces = _mm_cmpeq_epi8(_mm_min_epu8(spaces, _mm_set1_epi8(4)), spaces);
+    spaces = _mm_or_si128(spaces, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+    if (_mm_movemask_epi8(_mm_or_si128(digits, spaces)) != 0xFFFF) {
+      return false;
+    }
+  }
+#endif
+
+  // Whatever is left, or everything without vector support
+  for (; next < end; ++next) {
+    if (!isdigit((unsigned char)*next) && !isspace((unsigned char)*next)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Tests for the binary list format by its magic number.
+bool isBinary(const char *data, size_t size) {
+  return (size >= sizeof(binaryHeader)) &&
+    (memcmp(data, BINARY_MAGIC, 4) == 0);
+}
+
+// Checks the header of a binary list against the size of the file, without
+//   exiting.
+//   Post: Returns NULL with the number of values in 'count', or what is wrong
+//         with the file if the width is unknown or the file is truncated.
+const char *checkBinary(const char *data, size_t size, size_t &count) {
+  binaryHeader header;
+  uint32_t width;
+  uint64_t total;
+
+  memcpy(&header, data, sizeof(header));
+  width = LITTLE32(header.width);
+  total = LITTLE64(header.count);
+
+  if ((width != 4) && (width != 8)) { return "has values of unknown width"; }
+  if ((size - sizeof(header)) / width < total) { return "is truncated"; }
+  count = total;
+  return NULL;
+}
+
+// Checks the header of a binary list against the size of the file.
+//   Post: Returns the number of values. Exits if the width is unknown or the
+//         file is truncated.
+size_t binaryCount(const char *data, size_t size) {
+  const char *problem;
+  size_t count;
+
+  problem = checkBinary(data, size, count);
+  if (problem != NULL) {
+    printf("Binary file %s.\nGood Bye!\n", problem);
+    exit(EXIT_FAILURE);
+  }
+  return count;
+}
+
+// Copies values from a binary list into a vector.
+//   Pre:  'data' holds a binary list checked by binaryCount().
+//   Post: Values [first, first + count) are appended to 'list'. Exits if a
+//         64-bit value does not fit in an int.
+void readBinary(const char *data, size_t first, size_t count,
+		vector<int> &list) {
+  binaryHeader header;
+  uint32_t width;
+
+  memcpy(&header, data, sizeof(header));
+  width = LITTLE32(header.width);
+  readValues(data + sizeof(header) + width * first, count, width, list);
+}
+
+// Copies values from a binary list into a vector, without exiting.
+//   Pre:  'data' holds a binary list checked by checkBinary().
+//   Post: Values [first, first + count) are appended to 'list'; returns
+//         false if a 64-bit value does not fit in an int.
+bool copyBinary(const char *data, size_t first, size_t count,
+		vector<int> &list) {
+  binaryHeader header;
+  uint32_t width;
+
+  memcpy(&header, data, sizeof(header));
+  width = LITTLE32(header.width);
+  return copyValues(data + sizeof(header) + width * first, count, width,
+		    list);
+}
+
+// Copies raw little-endian values, 4 or 8 bytes wide, into a vector.
+//   Post: 'count' values are appended to 'list'. Exits if a 64-bit value
+//         does not fit in an int.
+void readValues(const char *values, size_t count, uint32_t width,
+		vector<int> &list) {
+  if (!copyValues(values, count, width, list)) {
+    printf("Binary file holds a value too large for an int.\n"
+	   "Good Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Copies raw little-endian values, 4 or 8 bytes wide, into a vector, without
+//   exiting.
+//   Post: 'count' values are appended to 'list'; returns false if a 64-bit
+//         value does not fit in an int.
+bool copyValues(const char *values, size_t count, uint32_t width,
+		vector<int> &list) {
+  size_t base = list.size();
+  uint32_t narrow;
+  uint64_t wide;
+  int64_t value;
+
+  list.resize(base + count);
+
+  if (width == 4) {
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(&narrow, values + 4 * i, 4);
+      list[base + i] = (int)LITTLE32(narrow);
+    }
+  }
+  else {
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(&wide, values + 8 * i, 8);
+      value = (int64_t)LITTLE64(wide);
+      if ((value < INT_MIN) || (value > INT_MAX)) { return false; }
+      list[base + i] = (int)value;
+    }
+  }
+  return true;
+}
+
+// Creates output.bin for a binary list.
+//   Post: Returns the file descriptor. Exits if it cannot be opened.
+int createBinary() {
+  int fd;
+
+  fd = open("output.bin", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    printf("Output file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+
+// Starts a binary list of 'count' values on a buffered writer: the header is
+//   written, and the values after it go out as raw ints.
+void writeHeader(writer& out, size_t count) {
+  binaryHeader header;
+
+  memcpy(header.magic, BINARY_MAGIC, 4);
+  header.width = LITTLE32((uint32_t)sizeof(int));
+  header.count = LITTLE64((uint64_t)count);
+
+  memcpy(out.buffer + out.fill, &header, sizeof(header));
+  out.fill += sizeof(header);
+  out.binary = true;
+}
+
+// Flushes 'output' and opens output.txt again to append the list after it.
+//   Post: Returns the new file descriptor. Exits if it cannot be opened.
+int appendOutput() {
+  int fd;
+
+  output.flush();
+  fd = open("output.txt", O_WRONLY | O_APPEND);
+  if (fd < 0) {
+    printf("Output file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts many files at once, each on a thread of its own, into a file named
+//   after it with ".sorted" added. Files wait for memory while those being
+//   sorted would need more than BATCH_BUDGET between them.
+//   Pre:  The files and choice of sort, and the number of threads.
+//   Post: Each file is sorted and a summary of the throughput is printed.
+void batchSort(batch& job, int count) {
+  vector<pthread_t> pool;  // The batch threads
+  struct timespec start;   // When the batch started
+  struct timespec stop;    // And when it finished
+  double seconds;          // Time taken
+
+  job.next = 0;
+  job.budget = (size_t)BATCH_BUDGET << 20;
+  job.held = 0;
+  job.values = job.bytes = 0;
+  job.failed = 0;
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.freed, NULL);
+
+  // No more threads than files
+  if ((size_t)count > job.names.size()) { count = job.names.size(); }
+  pool.resize(count);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < count; ++i) {
+    pthread_create(&pool[i], NULL, batchLoop, &job);
+  }
+  for (int i = 0; i < count; ++i) { pthread_join(pool[i], NULL); }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  if (seconds <= 0) { seconds = 1e-9; }
+
+  printf("Files:\t\t%lu (%i failed)\n"
+	 "Threads:\t%i\n"
+	 "Values:\t\t%lld\n"
+	 "Seconds:\t%.3f\n"
+	 "Throughput:\t%.1f files/s, %.0f values/s, %.1f MB/s\n",
+	 (unsigned long)job.names.size(), job.failed, count, job.values,
+	 seconds, job.names.size() / seconds, job.values / seconds,
+	 job.bytes / seconds / (1 << 20));
+
+  pthread_cond_destroy(&job.freed);
+  pthread_mutex_destroy(&job.lock);
+}
+
+// Lists the files of a batch: the names in a manifest, one per line, or
+//   the matches of a wildcard pattern.
+//   Post: The names are added to 'names'. Exits if none are found.
+void listBatch(string source, vector<string>& names) {
+  ifstream manifest;  // File listing the inputs
+  string line;        // One name from it
+  glob_t matches;     // Files matching a pattern
+
+  if (source.find_first_of("*?[") != string::npos) {
+    if (glob(source.c_str(), 0, NULL, &matches) == 0) {
+      names.insert(names.end(), matches.gl_pathv,
+		   matches.gl_pathv + matches.gl_pathc);
+    }
+    globfree(&matches);
+  }
+  else {
+    manifest.open(source.c_str());
+    if (manifest.fail()) {
+      printf("Manifest file opening failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    while (getline(manifest, line)) {
+      if (!line.empty()) { names.push_back(line); }
+    }
+    manifest.close();
+  }
+
+  if (names.empty()) {
+    printf("No files to sort.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Body of each batch thread; sorts files until none are left.
+void* batchLoop(void* arg) {
+  batch *job = (batch *)arg;
+  string name;        // File being sorted
+  struct stat info;   // For the size of the file
+  size_t need;        // Memory the file is taken to need
+  size_t length;      // Values in the file
+  bool sorted;        // Whether it was sorted
+
+  while (true) {
+    pthread_mutex_lock(&job->lock);
+    if (job->next == job->names.size()) {
+      pthread_mutex_unlock(&job->lock);
+      break;
+    }
+    name = job->names[job->next++];
+    pthread_mutex_unlock(&job->lock);
+
+    if (stat(name.c_str(), &info) < 0) {
+      printf("%s: could not be opened.\n", name.c_str());
+      pthread_mutex_lock(&job->lock);
+      ++job->failed;
+      pthread_mutex_unlock(&job->lock);
+      continue;
+    }
+
+    // Wait for memory; a file larger than the budget runs on its own
+    need = (size_t)info.st_size * BATCH_FACTOR;
+    pthread_mutex_lock(&job->lock);
+    while ((job->held > 0) && (job->held + need > job->budget)) {
+      pthread_cond_wait(&job->freed, &job->lock);
+    }
+    job->held += need;
+    pthread_mutex_unlock(&job->lock);
+
+    length = 0;
+    sorted = sortFile(*job, name, length);
+
+    pthread_mutex_lock(&job->lock);
+    job->held -= need;
+    if (sorted) {
+      job->values += length;
+      job->bytes += info.st_size;
+    }
+    else { ++job->failed; }
+    pthread_cond_broadcast(&job->freed);
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+
+// Sorts one file of a batch, reporting rather than exiting on bad input.
+//   Pre:  The batch and the name of the file.
+//   Post: Returns false if the file could not be sorted; 'length' holds the
+//         number of values sorted.
+bool sortFile(batch& job, const string& name, size_t& length) {
+  struct stat info;   // For the size of the file
+  const char *data;   // The file, mapped into memory
+  const char *problem = NULL; // What is wrong with a binary file, if anything
+  size_t count;       // Values in a binary file
+  vector<int> list;   // Vector to store input
+  writer out;         // Buffered output of the list
+  bool valid = true;  // Whether the file held only digits and whitespace
+  int fd;             // Input, then output file
+
+  // Map the whole file, as importFile() does, but without exiting on failure
+  fd = open(name.c_str(), O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &info) < 0)) {
+    printf("%s: could not be opened.\n", name.c_str());
+    if (fd >= 0) { close(fd); }
+    return false;
+  }
+  data = NULL;
+  if (info.st_size > 0) {
+    data = (const char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+			      fd, 0);
+    if (data == MAP_FAILED) {
+      printf("%s: could not be read.\n", name.c_str());
+      close(fd);
+      return false;
+    }
+    madvise((void *)data, info.st_size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  if (data != NULL) {
+    if (isBinary(data, info.st_size)) {
+      problem = checkBinary(data, info.st_size, count);
+      if ((problem == NULL) && !copyBinary(data, 0, count, list)) {
+	problem = "holds a value too large for an int";
+      }
+    }
+    else { valid = scanList(data, data + info.st_size, list); }
+    munmap((void *)data, info.st_size);
+  }
+  if (problem != NULL) {
+    printf("%s: binary file %s.\n", name.c_str(), problem);
+    return false;
+  }
+  if (!valid) {
+    printf("%s: contains invalid characters.\n", name.c_str());
+    return false;
+  }
+
+  // The counters are this thread's own, so they start over for each file
+  compare = swaps = passes = 0;
+  length = list.size();
+  if (job.radix) { radixSort(list); }
+  else if (job.network && (length > 0) && (length <= NETWORK_SIZE)) {
+    sortNetwork(&list[0], length);
+  }
+  else if (job.shaker) { cocktailSort(list, less<int>()); }
+  else if (job.bounded) { lastSwapSort(list, less<int>()); }
+  else { BubbleSort(list, less<int>()); }
+
+  // Laid out as output.txt is, counts and all
+  fd = open((name + ".sorted").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    printf("%s.sorted: could not be written.\n", name.c_str());
+    return false;
+  }
+  if (!job.binary) {
+    dprintf(fd, "File Name:\t%s\nLength:\t\t%lu\nCompares:\t%lld\n"
+	    "Swaps:\t\t%lld\nPasses:\t\t%lld\n\n", name.c_str(),
+	    (unsigned long)list.size(), compare, swaps, passes);
+  }
+  openWriter(out, fd);
+  if (job.binary) { writeHeader(out, list.size()); }
+  for (size_t i = 0; i < list.size(); ++i) { writeInt(out, list[i]); }
+  closeWriter(out);
+  close(fd);
+
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts a buffered writer of text on a file descriptor.
+void openWriter(writer& out, int fd) {
+  out.fd = fd;
+  out.buffer = new char[WRITE_BUFFER];
+  out.fill = 0;
+  out.binary = false;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds an int to a buffered writer: as text on a line of its own, or as a raw
+//   little-endian int for a binary list.
+void writeInt(writer& out, int value) {
+  static const char pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+  char digits[12];       // Filled from the back
+  int at = sizeof(digits);
+  unsigned int left = (value < 0) ? (0u - (unsigned int)value) : value;
+
+  if (out.fill + sizeof(digits) > WRITE_BUFFER) { flushWriter(out); }
+
+  if (out.binary) {
+    uint32_t raw = LITTLE32((uint32_t)value);
+    memcpy(out.buffer + out.fill, &raw, sizeof(raw));
+    out.fill += sizeof(raw);
+    return;
+  }
+
+  // Two digits at a time from the table, then the last one or two
+  digits[--at] = '\n';
+  while (left >= 100) {
+    const char *pair = pairs + 2 * (left % 100);
+    left /= 100;
+    digits[--at] = pair[1];
+    digits[--at] = pair[0];
+  }
+  if (left >= 10) {
+    digits[--at] = pairs[2 * left + 1];
+    digits[--at] = pairs[2 * left];
+  }
+  else { digits[--at] = '0' + left; }
+  if (value < 0) { digits[--at] = '-'; }
+
+  memcpy(out.buffer + out.fill, digits + at, sizeof(digits) - at);
+  out.fill += sizeof(digits) - at;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes out whatever a buffered writer holds. Exits if the write fails.
+void flushWriter(writer& out) {
+  size_t done = 0;
+  ssize_t wrote;
+
+  while (done < out.fill) {
+    wrote = write(out.fd, out.buffer + done, out.fill - done);
+    if (wrote < 0) {
+      if (errno == EINTR) { continue; }
+      printf("Output file writing failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    done += wrote;
+  }
+  out.fill = 0;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Flushes a buffered writer and frees its buffer; the descriptor stays open.
+void closeWriter(writer& out) {
+  flushWriter(out);
+  delete [] out.buffer;
+  out.buffer = NULL;
+}
+
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting) {
+#ifdef __linux__
+  static const unsigned long long config[COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+  struct perf_event_attr attr;
+#endif
+
+  prof.phases.clear();
+  for (int k = 0; k < COUNTERS; ++k) {
+    prof.fd[k] = -1;
+#ifdef __linux__
+    if (!counting) { continue; }
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[k];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count the threads started later too
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    prof.fd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+}
+
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name) {
+  phase fresh;   // A phase not seen before
+  size_t i;
+
+  for (i = 0; i < prof.phases.size(); ++i) {
+    if (strcmp(prof.phases[i].name, name) == 0) { break; }
+  }
+  if (i == prof.phases.size()) {
+    fresh.name = name;
+    fresh.seconds = 0;
+    for (int k = 0; k < COUNTERS; ++k) {
+      fresh.count[k] = (prof.fd[k] < 0) ? -1 : 0;
+    }
+    prof.phases.push_back(fresh);
+  }
+  prof.current = i;
+
+  for (int k = 0; k < COUNTERS; ++k) { prof.base[k] = readCounter(prof.fd[k]); }
+  clock_gettime(CLOCK_MONOTONIC, &prof.start);
+}
+
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof) {
+  struct timespec stop;
+  phase &done = prof.phases[prof.current];
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  done.seconds += (stop.tv_sec - prof.start.tv_sec) +
+    (stop.tv_nsec - prof.start.tv_nsec) / 1e9;
+  for (int k = 0; k < COUNTERS; ++k) {
+    if (prof.fd[k] >= 0) {
+      done.count[k] += readCounter(prof.fd[k]) - prof.base[k];
+    }
+  }
+}
+
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd) {
+  unsigned long long value[3]; // Count, time enabled and time running
+
+  if ((fd < 0) || (read(fd, value, sizeof(value)) != sizeof(value))) {
+    return 0;
+  }
+  if ((value[2] == 0) || (value[2] >= value[1])) { return value[0]; }
+  return (long long)((double)value[0] * value[1] / value[2]);
+}
+
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json) {
+  if (json) {
+    fflush(stdout);
+    fprintf(stderr, "{\"tool\": \"bubbleSort\", \"phases\": [");
+    for (size_t i = 0; i < prof.phases.size(); ++i) {
+      fprintf(stderr, "%s{\"name\": \"%s\", \"seconds\": %.6f",
+	      i ? ", " : "", prof.phases[i].name, prof.phases[i].seconds);
+      for (int k = 0; k < COUNTERS; ++k) {
+	if (prof.phases[i].count[k] < 0) {
+	  fprintf(stderr, ", \"%s\": null", counterNames[k]);
+	}
+	else {
+	  fprintf(stderr, ", \"%s\": %lld", counterNames[k],
+		  prof.phases[i].count[k]);
+	}
+      }
+      fprintf(stderr, "}");
+    }
+    fprintf(stderr, "]}\n");
+    return;
+  }
+
+  printf("%-10s %12s", "Phase", "Seconds");
+  for (int k = 0; k < COUNTERS; ++k) { printf(" %14s", counterNames[k]); }
+  printf("\n");
+  for (size_t i = 0; i < prof.phases.size(); ++i) {
+    printf("%-10s %12.6f", prof.phases[i].name, prof.phases[i].seconds);
+    for (int k = 0; k < COUNTERS; ++k) {
+      if (prof.phases[i].count[k] < 0) { printf(" %14s", "n/a"); }
+      else { printf(" %14lld", prof.phases[i].count[k]); }
+    }
+    printf("\n");
   }
-  return !failed;
 }
 
 // Prints out instructions on the use of command line options.
 void usage() {
   printf("Flags:\n"
+	 "\t-B\t\tWrite the sorted list to output.bin, in binary\n"
+	 "\t-c\t\tCocktail shaker sort, forward and backward in turn\n"
 	 "\t-h\t\tPrints this message.\n"
-	 "\t-v\t\tPrint diagnostic info\n"
+	 "\t-j\t\tPrint the time and counters of each phase as JSON,\n"
+	 "\t\t\ton standard error\n"
+	 "\t-l\t\tEnd each pass at the last swap of the pass before\n"
+	 "\t-m <list>\tSort each file named in a manifest, or matching a\n"
+	 "\t\t\tquoted pattern, into <file>.sorted; -p sets the\n"
+	 "\t\t\tthreads\n"
+	 "\t-n\t\tSort lists of 32 or fewer with a sorting network\n"
+	 "\t-p <threads>\tOdd-even transposition sort with this many threads,\n"
+	 "\t\t\tor with every processor for 0\n"
+	 "\t-r\t\tRadix sort instead\n"
+	 "\t-s\t\tSort standard input to standard output\n"
+	 "\t-v\t\tPrint diagnostic info, with the time and counters of\n"
+	 "\t\t\teach phase\n"
 	 "<input_file_name> \tIf you would like to supply an input file name,\n"
 	 "\t\t\tyou may do so here, otherwise, the program will ask for it.\n\n");
 }
@@ -9,13 +9,45 @@
 //   path is given to the user, other wise an error message is given. The user
 //   may also request a path of a certain length, if it exists. If any path will
 //   sufice, the user shall swipe 0 for the path length.
+//
+//   The graph is held in compressed sparse row form: one array lists the
+//   neighbors of every vertex, in order of vertex and ascending within each,
+//   and another gives where each vertex's neighbors begin. It is built in two
+//   passes over the edges, one to count the degrees and one to place the
+//   neighbors, so the search looks at a vertex's real neighbors only and the
+//   graph takes space in proportion to its edges rather than its vertices
+//   squared.
+//
+//   With -b, a path of length 0 is instead the shortest path, found breadth
+//   first from both ends at once. Each end grows a level at a time, the
+//   smaller frontier first, and the two stop as soon as they meet. A level is
+//   grown top-down, from the frontier out along its edges, or bottom-up, from
+//   each vertex not yet reached looking for a neighbor in the frontier,
+//   whichever is likely to look at fewer edges (Beamer et al., 2012).
+//
+//   With -e, a path of a given length is found by a search that backtracks
+//   properly, so it finds such a path whenever there is one. It steps only
+//   onto vertices with a walk to the far end of the number of edges left,
+//   known from the shortest walk of each parity found breadth first, and
+//   remembers the vertices it found to be dead ends for a given number of
+//   edges left. Paths of moderate length are met in the
+//   middle: every half path back from the far end is kept, and the search
+//   forward only has to reach one it shares no vertex with. Since keeping
+//   them takes a while, the search first goes forward alone for a time, as
+//   most paths are found that way.
+//
+//   With -m, the paths asked for come from a manifest rather than the
+//   prompts, and the graphs named in it are searched on a pool of threads,
+//   each built once for every path asked of it.
 // 
 // Invariant
 //------------------------------------------------------------------------------
 //   The program will ask for a valid file of a graph definition. The file will
 //   begin with the total number of vertices in the graph, followed by a list
-//   of pairs, in the form (#,#), where # is a digit. Each pair defines an edge.
-//   There may be no more than ten (10) vertices.
+//   of pairs, in the form (#,#), where # is a vertex number of any number of
+//   digits, less than the number of vertices. Each pair defines an edge. The
+//   file is read in place, straight into the graph, without a copy of its
+//   text.
 //
 // References
 //------------------------------------------------------------------------------
@@ -27,55 +59,324 @@
 //
 // Line parsing for flags implementation from UCB Course CSCI 2400, Fall 2011.
 //   and from GNU (gnu.org/software/libc/manual/html_node/Getopt.html)
+//
+// Beamer, S., Asanovic, K. and Patterson, D. (2012) Direction-Optimizing
+//   Breadth-First Search. Proceedings of SC12, pp.1-10.
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Libraries
+#include <algorithm> // sort(), unique(), binary_search()
 #include <cassert>  // Assert statements
 #include <cctype>   // type checking
+#include <climits>  // INT_MAX
 #include <cstdio>   // cin, cout
 #include <cstdlib>  // EXIT_SUCCESS and things
-#include <fstream>  // File Stream
+#include <cstring>  // strcmp(), memset(), memcpy()
+#include <ctime>    // clock_gettime()
+#include <fcntl.h>  // open()
+#include <fstream>  // ifstream, for a manifest
 #include <iostream> // printf() ect...
+#include <map>      // Graphs of a batch by name
+#include <pthread.h> // Batch threads
+#include <sstream>  // istringstream
 #include <stack>    // Stack container
+#include <stdint.h> // uint64_t
 #include <string>   // String class
-#include <unistd.h> 
-#include <queue>    // Queue Container
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h> // Line Parsing
 #include <vector>   // Vector Container
+#ifdef __linux__
+#include <linux/perf_event.h> // Hardware counters
+#include <sys/syscall.h>       // perf_event_open()
+#endif
 
 using namespace std;
-ifstream input;
+
+// Profile: hardware counters read around each phase, named in counterNames
+#define COUNTERS 4
+
+// Breadth first search: a level goes bottom-up once the frontier has more
+//   than 1/BOTTOM_UP_ALPHA of the edges of the vertices not yet reached, and
+//   back top-down once it holds fewer than 1/BOTTOM_UP_BETA of the vertices
+#define BOTTOM_UP_ALPHA 14
+#define BOTTOM_UP_BETA 24
+
+// Batch search: memory held by all graphs at once, in MB; and the memory a
+//   graph is taken to need, per byte of its file and per vertex
+#define BATCH_BUDGET 1024
+#define BATCH_FACTOR 2
+#define BATCH_VERTEX 48
+
+// Largest graph taken: the exact length search keeps a state for each vertex
+//   and parity, so twice the vertices, rounded up to whole words, fit an int
+#define MAX_VERTICES (INT_MAX / 2 - 63)
+
+// Paths of an exact length: dead ends are remembered for the last
+//   MEMO_LENGTHS edges of a path, and paths of MEET_MIN to MEET_MAX edges not
+//   found in MEET_AFTER steps forward are met in the middle, unless there are
+//   more than MEET_HALVES half paths. Each half needs an edge at least, so
+//   MEET_MIN is no less than 2.
+#define MEMO_LENGTHS 64
+#define MEET_MIN 4
+#define MEET_MAX 40
+#define MEET_AFTER (1 << 16)
+#define MEET_HALVES (1 << 18)
+
+// Names of the hardware counters of a profile, as reported
+const char *counterNames[COUNTERS] = { "cycles", "instructions",
+				       "branch-misses", "llc-misses" };
+
+// A graph in compressed sparse row form. The neighbors of vertex v are
+//   neighbor[offset[v]] through neighbor[offset[v + 1] - 1], in ascending
+//   order, and each edge is listed under both of its ends.
+struct csr {
+  int vertices;          // Number of vertices
+  vector<int> offset;    // Where each vertex's neighbors begin; one extra
+  vector<int> neighbor;  // Neighbors of every vertex, one after another
+};
+
+// A graph file mapped into memory and read in place, a record at a time,
+//   with no copy of its text.
+struct edgeReader {
+  const char *data;   // Contents of the file, or NULL if it is empty
+  size_t size;        // Size of the file
+  const char *next;   // Where reading resumes
+  const char *edges;  // Start of the first edge, after the number of vertices
+  const char *end;    // One past the last character
+};
+
+// A vertex on the way down a depth first search, in place of a call of a
+//   recursive search, and how far through its neighbors the search has got.
+struct frame {
+  int vertex;   // The vertex
+  int cursor;   // Place in neighbor of the next neighbor to try
+  bool joined;  // Whether the vertex is next to the one sought
+};
+
+// One end of a bidirectional breadth first search: the tree grown from it
+//   and its last level.
+struct bfsSide {
+  vector<int> parent;           // Next vertex toward this end; -1 if unreached
+  vector<int> frontier;         // The vertices of the last level
+  vector<uint64_t> inFrontier;  // The same, a bit per vertex, when bottom-up
+  long long unexplored;         // Neighbors listed by the unreached vertices
+  bool bottomUp;                // How the last level was grown
+};
+
+// A vertex on a path being grown to an exact length, and how far through its
+//   neighbors the search has got.
+struct exactFrame {
+  int vertex;    // The vertex
+  int cursor;    // Place in neighbor of the next neighbor to try
+  bool blocked;  // Whether a neighbor was passed over for being on the path
+};
+
+// A search for a path of an exact length, from st to fi.
+struct exactSearch {
+  int start, end;                  // st and fi
+  int edges;                       // Length of the path, in edges
+  vector<int> toStart, toEnd;      // Shortest walks to st and to fi, by
+                                   //   parity, from distances()
+  vector< vector<uint64_t> > dead; // Vertices, by edges left, from which the
+                                   //   path cannot be finished, whatever
+                                   //   came before them
+  vector<uint64_t> onPath;         // The vertices on the path, a bit apiece
+  bool meeting;                    // Whether to meet half paths from fi
+  vector<int> halves;              // Their vertices, fi first, less the last
+  vector< pair<int, int> > meets;  // The last vertex of each, and where it
+                                   //   begins in halves
+  long long steps;                 // Vertices stepped onto
+  long long budget;                // Steps forward allowed; -1 if no limit
+  bool gaveUp;                     // Whether the budget ran out
+};
+
+// One graph of a batch search and the paths asked of it, by every line of
+//   the manifest naming its file.
+struct graphJob {
+  string name;             // Graph file
+  vector<string> queries;  // First vertex, second vertex and length, as given
+};
+
+// Shared by the threads of a batch search: the graphs still to be searched,
+//   the memory they may hold between them, and the totals for the summary.
+struct batch {
+  vector<graphJob> graphs; // From the manifest
+  size_t next;             // Next graph to be handed out
+  size_t budget, held;     // Bytes the graphs may hold at once, and do hold
+  bool shortest, exact;    // Choice of search, as on the command line
+  long long paths;         // Paths searched for
+  long long found;         // And found
+  long long bytes;         // Bytes read
+  int failed;              // Graphs that could not be searched
+  pthread_mutex_t lock;    // Guards all of the above that changes
+  pthread_cond_t freed;    // Signalled as a graph gives back its memory
+};
+
+// Wall time and hardware counters of one phase of the program. A phase run
+//   more than once adds up.
+struct phase {
+  const char *name;          // As reported
+  double seconds;            // Wall time
+  long long count[COUNTERS]; // Counted events; -1 where unavailable
+};
+
+// Timing of a run: the counters, the phase under way and those seen so far.
+struct profile {
+  int fd[COUNTERS];          // From perf_event_open(), or -1
+  long long base[COUNTERS];  // Counts when the current phase started
+  struct timespec start;     // Time when it started
+  size_t current;            // Its place in 'phases'
+  vector<phase> phases;      // In the order first started
+};
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Declarations
 // 
-// Pre:  A stack, a vector, an adjacency matrix, and several other numbers
+// Pre:  A stack holding the start vertex, the graph, and several other numbers
 //       are given as input.
 // Post: A path is found and loaded into the path stack, using the Depth First
-//       Search algorithm.
-void dfs(stack<int>& path, vector<int>& visited, vector< vector<int> >& adj, 
+//       Search algorithm. The search keeps its own stack of frames rather
+//       than recursing, so no path is too deep for it, and marks the vertices
+//       it has visited in a bitset, a bit apiece.
+void dfs(stack<int>& path, const csr& adj,
 	 int st, const int& fi, const int& ln, const int& size);
 
-// Pre:  A queue with the loaded graph, the adjacency matrix and the total 
-//       number of verticies.
-// Post: An adjacency matrix is created and stored in adj. If there is any
-//       error what-so-ever, the function returns false.
-bool createMatrix(queue<string>& graph, vector< vector<int> >& adj, int size);
+// Pre:  The loaded graph file, the graph to build and the total number of
+//       verticies.
+// Post: The graph is built in adj, in compressed sparse row form, reading the
+//       edges twice: once to count each vertex's neighbors and once to place
+//       them. Graphs of more than MAX_VERTICES vertices are refused. If there
+//       is any error what-so-ever, the function returns false.
+bool createGraph(edgeReader& graph, csr& adj, int size);
+
+// Pre:  The graph and two vertices of it.
+// Post: Returns true if there is an edge between the two.
+bool hasEdge(const csr& adj, int x, int y);
 
-// Pre:  The adjacency matrix, the start and end verticies, number of vertices
+// Pre:  The graph, the start and end verticies, number of vertices
 //       and the length of the path.
 // Post: Function does all the overhead work for the dfs function. Function 
 //       returns a stack with the path found.
-stack<int> findPath(vector< vector<int> >& adj, int st, 
+stack<int> findPath(const csr& adj, int st,
 		const int& size, const int& fi, const int& ln);
 
-// Pre:  The name of the input file, the number of vertices and a queue to
-//       store the input.
-// Post: The file is opened, the number of verticies are stored in size and
-//       the input is stored in the queue. If anything what-so-ever goes wrong
-//       the function returns false.
-bool loadGraph(string fp, int& size, queue<string>& graph);
+// Pre:  The graph, the start and end vertices, and a count of the vertices
+//       reached.
+// Post: Returns a stack with the shortest path from st to fi, st on top, or
+//       -1 if there is none, found by a bidirectional breadth first search.
+//       The vertices it reached, from either end, are added to 'reached'.
+stack<int> shortestPath(const csr& adj, int st, int fi, long long& reached);
+
+// Pre:  The graph, its number of vertices, the start and end vertices, the
+//       length of the path, the search chosen and a count of vertices.
+// Post: Returns a stack with the path found, st on top, or -1 if there is
+//       none: the shortest with -b and a length of 0, one found by
+//       exactPath() with -e and any other length, or else by findPath().
+//       The vertices reached or stepped onto are added to 'reached'.
+stack<int> searchPath(const csr& adj, int size, int st, int fi, int ln,
+		      bool shortest, bool exact, long long& reached);
+
+// Pre:  The two ends of a breadth first search that have not yet met.
+// Post: The near end is grown by a level, top-down or bottom-up, whichever
+//       looks at fewer edges. Returns the first vertex reached by both ends,
+//       or -1 if they still have not met.
+int growLevel(const csr& adj, bfsSide& near, const bfsSide& far,
+	      long long& reached);
+
+// Pre:  The graph, the start and end vertices, the number of vertices of the
+//       path and a count of steps.
+// Post: Returns a stack with a simple path of exactly ln vertices from st to
+//       fi, st on top, or -1 if there is none. The vertices the search
+//       stepped onto are added to 'steps'.
+stack<int> exactPath(const csr& adj, int st, int fi, int ln, long long& steps);
+
+// Pre:  The graph and a vertex of it.
+// Post: dist[2v] and dist[2v + 1] hold the length of the shortest walk of
+//       even and of odd length from 'from' to v, found breadth first, or -1
+//       if there is none. Going back and forth along an edge, there are walks
+//       of every longer length of the same parity too.
+void distances(const csr& adj, int from, vector<int>& dist);
+
+// Pre:  The search, a path holding the vertex to grow it from, on the path,
+//       and the number of edges to grow it by. Going forward it holds st,
+//       going backward fi.
+// Post: Grows the path depth first over every simple path of that many
+//       edges that could be part of the whole. Going forward, returns true
+//       with the path complete, from st to fi, once one ends at fi or meets a
+//       half path. Going backward, keeps each one as a half path, and returns
+//       true only if there are too many of them. Otherwise returns false with
+//       the path as it was, having set gaveUp if the budget ran out.
+bool growPath(const csr& adj, exactSearch& s, vector<int>& path, int length,
+	      bool backward);
+
+// Pre:  The search, a path forward from st, and the vertex it has reached
+//       halfway.
+// Post: If a half path from fi ends at m and shares no vertex with the path,
+//       the two are joined into the path and returns true. 'blocked' is set
+//       if a half path was passed over for sharing a vertex.
+bool joinHalf(exactSearch& s, vector<int>& path, int m, bool& blocked);
+
+// Pre:  The name of the input file, the number of vertices and a reader for
+//       the file.
+// Post: The file is mapped, the number of verticies are stored in size and
+//       the reader is left at the first edge. If anything what-so-ever goes
+//       wrong the function returns false.
+bool loadGraph(string fp, int& size, edgeReader& graph);
+
+// Maps a graph file into memory for reading.
+//   Pre:  The name of the file and the reader to open.
+//   Post: Returns false if the file cannot be read.
+bool openEdges(string fp, edgeReader& in);
+
+// Reads the next record of a graph file: the characters up to a space or the
+//   end of a line, holding numbers of any width separated by commas, and
+//   perhaps within parentheses, as in (u,v) or u,v,w.
+//   Pre:  Room for 'fields' numbers in 'value'.
+//   Post: Returns 1 with the numbers stored in 'value', 0 at the end of the
+//         file, or -1 if the record is not 'fields' numbers of that form.
+int nextRecord(edgeReader& in, int fields, int *value);
+
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned. A run too long for an int stops early
+//         with 'value' above INT_MAX.
+const char *parseDigits(const char *next, const char *end, uint64_t &value);
+
+// Goes back to the first edge of a graph file, to read the edges again.
+void rewindEdges(edgeReader& in);
+
+// Unmaps a graph file.
+void closeEdges(edgeReader& in);
+
+// Pre:  The graphs with the paths asked of them, the choice of search and
+//       the number of threads.
+// Post: Each graph is searched, a thread apiece, for every path asked of it
+//       and the paths are written to a file named after it with ".paths"
+//       added. Graphs wait for memory while those being searched would need
+//       more than BATCH_BUDGET between them. A summary of the throughput is
+//       printed.
+void batchSearch(batch& job, int count);
+
+// Pre:  The name of a manifest, each line of it a graph file, the first and
+//       second vertex and the length of the path, as asked for one at a time
+//       otherwise.
+// Post: The graphs are added to 'graphs', each with the paths asked of it,
+//       in the order first named. Lines that are not a file and three
+//       numbers are reported and passed over. Exits if there are none.
+void listBatch(string source, vector<graphJob>& graphs);
+
+// Body of each batch thread; searches graphs until none are left.
+void* batchLoop(void* arg);
+
+// Pre:  The batch, a graph of it, built, and its number of vertices.
+// Post: Every path asked of the graph is searched for and written to its
+//       ".paths" file, a line apiece. Returns false if the file could not be
+//       written.
+bool searchFile(batch& job, const graphJob& graph, const csr& adj, int size);
 
 // Pre:  A string with the user input is passed in.
 // Post: If the command givin is equal to 'quit' or 'exit', not case sensitive,
@@ -87,75 +388,164 @@ bool isQuit(const string& expr);
 //       true.
 bool isValid(const string& expr);
 
-// Pre:  The adjacency matrix and the results stack.
-// Post: The adjacency matrix is cleared, the input file is closed and the path
-//       stack is is cleared.
-void tidyUp(vector< vector<int> >& adj, stack<int>& results);
-////////////////////////////////////////////////////////////////////////////////
+// Pre:  The graph, the results stack and the graph file.
+// Post: The graph is cleared and its memory given back, the input file is
+//       closed and the path stack is is cleared.
+void tidyUp(csr& adj, stack<int>& results, edgeReader& graph);
+
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting);
+
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name);
+
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof);
+
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd);
 
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json);
+
+// Prints out instructions on the use of command line options.
+void usage();
 ////////////////////////////////////////////////////////////////////////////////
-int main() {
 
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv) {
+  char c;                 // Used for line parsing
+  bool verbose = false;   // For Diagnostic information.
+  bool json = false;      // Profile as JSON
+  profile prof;           // Time and counters of each phase
+  bool loaded;            // Whether the graph was read
+  bool shortest = false;  // Find paths of length 0 breadth first
+  bool exact = false;     // Find paths of a length by exactPath()
+  long long reached;      // Vertices reached or stepped onto by them
   int size;
   string command, dec, start, finish, length; 
   stack<int> results;
-  queue<string> graph;
-  vector< vector<int> > adj;
+  edgeReader graph = { NULL, 0, NULL, NULL, NULL };
+  csr adj;
   int st, fi, ln;
+  string manifest;        // Paths to search for in a batch
+  int count = 0;          // Threads for the batch
+  batch job;              // The batch search
 
   printf("Welcome to ACME Inc., Department of Software!\n");
 
+  // Parse the line
+  while ((c = getopt(argc, argv, "behjm:p:v")) != EOF) {
+    switch (c) {
+    case 'b': // Shortest paths, breadth first.
+      shortest = true;
+      break;
+    case 'e': // Paths of an exact length, pruned and met in the middle.
+      exact = true;
+      break;
+    case 'h': // Help message on command line options.
+      usage();
+      break;
+    case 'j': // Profile as JSON.
+      json = true;
+      break;
+    case 'm': // Batch of paths, from a manifest.
+      manifest = optarg;
+      break;
+    case 'p': // Threads for the batch.
+      count = atoi(optarg);
+      if (count < 1) { count = 1; }
+      break;
+    case 'v': // Print Diagnostic information.
+      verbose = true;
+      break;
+    default:
+      usage();
+    }
+  }
+  if (verbose) { printf("Verbose turned on.\n"); }
+
+  // A batch searches each of its graphs straight to its own output
+  if (!manifest.empty()) {
+    listBatch(manifest, job.graphs);
+    job.shortest = shortest;
+    job.exact = exact;
+    if (count == 0) { count = sysconf(_SC_NPROCESSORS_ONLN); }
+    batchSearch(job, count);
+    printf("Thank you!\n");
+    return (job.failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+  openProfile(prof, verbose || json);
+
   do {
     printf("Please enter the name of the input file: ");
     cin >> command;
     
     if (!isQuit(command)) {
-      if(loadGraph(command, size, graph)) {
-	if(createMatrix(graph, adj, size)) {
-	  
-	  // Recieve inputs
-	  printf("Please enter the first vertex: ");
-	  cin >> start;
-	  assert(cin);
-
-	  printf("And the second vertex: ");
-	  cin >> finish;
-	  assert(cin);
-
-	  printf("And the length of the path: ");
-	  cin >> length;
-	  assert(cin);
-	  
-	  // Convert to numbers
-	  st = atoi(start.c_str());
-	  fi = atoi(finish.c_str());
-	  ln = atoi(length.c_str());
-	  
-	  // Perform DFS
-	  results = findPath(adj, st, size, fi, ln);
-	  
-	  // Report search
-	  if(results.top() < 0) {
-	    printf("Unable to find path. Please try again.\n");
-	  }
-	  else {
-	    printf("Path Found: ");
-	    while(!results.empty()) {
-	      if(results.size() == 1) {
-		printf("%i\n", results.top());
-	      }
-	      else { printf("%i, ", results.top());}
-	      results.pop();
+      startPhase(prof, "ingest");
+      loaded = loadGraph(command, size, graph) &&
+	createGraph(graph, adj, size);
+      endPhase(prof);
+      if (loaded) {
+	
+	// Recieve inputs
+	printf("Please enter the first vertex: ");
+	cin >> start;
+	assert(cin);
+
+	printf("And the second vertex: ");
+	cin >> finish;
+	assert(cin);
+
+	printf("And the length of the path: ");
+	cin >> length;
+	assert(cin);
+	
+	// Convert to numbers
+	st = atoi(start.c_str());
+	fi = atoi(finish.c_str());
+	ln = atoi(length.c_str());
+	
+	// Perform DFS, or BFS for the shortest path
+	startPhase(prof, "search");
+	reached = 0;
+	results = searchPath(adj, size, st, fi, ln, shortest, exact, reached);
+	endPhase(prof);
+	
+	// Report search
+	startPhase(prof, "output");
+	if (verbose && shortest && (ln == 0)) {
+	  printf("Vertices reached: %lld of %i\n", reached, size);
+	}
+	if (verbose && exact && (ln != 0)) {
+	  printf("Vertices stepped onto: %lld\n", reached);
+	}
+	if(results.top() < 0) {
+	  printf("Unable to find path. Please try again.\n");
+	}
+	else {
+	  printf("Path Found: ");
+	  while(!results.empty()) {
+	    if(results.size() == 1) {
+	      printf("%i\n", results.top());
 	    }
+	    else { printf("%i, ", results.top());}
+	    results.pop();
 	  }
 	}
+	endPhase(prof);
       }
     }
     // Clean up
-    tidyUp(adj, results);
+    tidyUp(adj, results, graph);
   }
   while(!isQuit(command));
-  
+
+  if (verbose) { reportProfile(prof, false); }
+  if (json) { reportProfile(prof, true); }
   printf("Thank you!\n");
   
   return EXIT_SUCCESS;
@@ -164,113 +554,168 @@ int main() {
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
-bool createMatrix(queue<string>& graph, vector< vector<int> >& adj, int size) {
-  stack<char> paren;
-  string temp, tempx, tempy;
-  int x, y;
-  vector<int> row;
+bool createGraph(edgeReader& graph, csr& adj, int size) {
+  int edge[2];       // Ends of the edge being read
+  int found;         // Whether it was read, from nextRecord()
+  int at;            // Where the next neighbor goes when compacting
 
-  // Zero out adjacency matrix
-  for(int i = 0; i < size; ++i) {
-    row.push_back(0);
-  }
-  for (int i = 0; i < size; ++i) {
-    adj.push_back(row);
+  if (size > MAX_VERTICES) {
+    printf("Graph of %i vertices is larger than %i.\n", size, MAX_VERTICES);
+    return false;
   }
 
-  // Create adjacency matrix while checking for bad input
-  while(!graph.empty()) {
-    temp = graph.front();
-    graph.pop();
-
-    //printf("%s ", temp.c_str());
-    
-    if(!(isdigit(temp[1]) &&
-	 isdigit(temp[3]))) {
-      printf("Invalid character in graph.\n");
+  // First pass: count each vertex's neighbors while checking for bad input
+  adj.vertices = size;
+  adj.offset.assign(size + 1, 0);
+  while ((found = nextRecord(graph, 2, edge)) > 0) {
+    if ((edge[0] >= size) || (edge[1] >= size)) {
+      printf("Edge (%i,%i) names a vertex not in the graph.\n",
+	     edge[0], edge[1]);
       return false;
     }
+    ++adj.offset[edge[0] + 1];
+    ++adj.offset[edge[1] + 1];
+  }
+  if (found < 0) {
+    printf("Invalid character in graph.\n");
+    return false;
+  }
+  for (int v = 0; v < size; ++v) {
+    if (adj.offset[v + 1] > (INT_MAX - adj.offset[v])) {
+      printf("Graph has too many edges.\n");
+      return false;
+    }
+    adj.offset[v + 1] += adj.offset[v];
+  }
 
-    tempx = temp[1];
-    tempy = temp[3];
-    x = atoi(tempx.c_str());
-    y = atoi(tempy.c_str());
-
-    //printf("%i %i\n", x, y);
-
-    adj[x][y] = 1;
-    adj[y][x] = 1;
+  // Second pass: read the edges again, placing each under both of its ends
+  vector<int> next(adj.offset.begin(), adj.offset.end() - 1);
+  adj.neighbor.resize(adj.offset[size]);
+  rewindEdges(graph);
+  while (nextRecord(graph, 2, edge) > 0) {
+    adj.neighbor[next[edge[0]]++] = edge[1];
+    adj.neighbor[next[edge[1]]++] = edge[0];
+  }
 
-    // Reset varibles
-    x = y = 0;
-    temp.clear();
-    tempx.clear();
-    tempy.clear();
+  // Put each vertex's neighbors in order, dropping edges given twice
+  at = 0;
+  for (int v = 0; v < size; ++v) {
+    vector<int>::iterator first = adj.neighbor.begin() + adj.offset[v];
+    vector<int>::iterator last = adj.neighbor.begin() + adj.offset[v + 1];
+    sort(first, last);
+    last = unique(first, last);
+    adj.offset[v] = at;
+    at = copy(first, last, adj.neighbor.begin() + at) - adj.neighbor.begin();
   }
+  adj.offset[size] = at;
+  adj.neighbor.resize(at);
 
   return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-void dfs(stack<int>& path, vector<int>& visited, vector< vector<int> >& adj, 
+bool hasEdge(const csr& adj, int x, int y) {
+  return binary_search(adj.neighbor.begin() + adj.offset[x],
+		       adj.neighbor.begin() + adj.offset[x + 1], y);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+void dfs(stack<int>& path, const csr& adj,
 	 int st, const int& fi, const int& ln, const int& size) {
-  for(int i = 0; i < size; ++i) {
-    visited[st] = 1;
+  vector<uint64_t> visited((size + 63) / 64, 0); // A bit per vertex
+  vector<frame> frames;  // The vertices on the way down, deepest last
+  frame next;            // A vertex to go down to
+  bool done, descend;    // What to do with the deepest vertex
+  int v, e, last, i;
 
-    if(path.top() != fi) {
-      if (ln == 0) {
+  next.vertex = st;
+  next.cursor = adj.offset[st];
+  next.joined = hasEdge(adj, st, fi);
+  visited[st >> 6] |= 1ULL << (st & 63);
+  frames.push_back(next);
+
+  // Only neighbors are visited, in ascending order. The checks on the path
+  //   are made before each of them, and once more after the last if any
+  //   vertex of the graph follows it, just as a scan of every vertex would.
+  while (!frames.empty()) {
+    v = frames.back().vertex;
+    e = frames.back().cursor;
+    last = adj.offset[v + 1];
+    done = descend = false;
+
+    if ((e == last) && ((size == 0) || ((e > adj.offset[v]) &&
+					(adj.neighbor[e - 1] == size - 1)))) {
+      done = true;
+    }
+    else {
+      i = (e < last) ? adj.neighbor[e] : -1;
+      descend = (i >= 0) && !(visited[i >> 6] & (1ULL << (i & 63)));
+
+      // Reached end
+      if (path.top() == fi) { done = true; }
+      else if (ln == 0) {
 	// Base Case
-	if(adj[st][fi] == 1) {
+	if (frames.back().joined) {
 	  path.push(fi);
-	  return;
-	}
-	// Recursive call
-	else if ((adj[st][i] == 1) && (visited[i] == 0)) {
-	  path.push(i);
-	  dfs(path, visited, adj, i, fi, ln, size);
+	  done = true;
 	}
-	// Dead end
-	else if ((i == (size + 1)) && (!path.empty())) { path.pop(); }      
       }
       else {
 	// Base case
-	if ((adj[st][fi] == 1) && (int)(path.size() + 1) == ln) { 
+	if (frames.back().joined && (int)(path.size() + 1) == ln) { 
 	  path.push(fi);
-	  return;
+	  done = true;
 	}
 	// Path too long
 	else if ((int)(path.size() + 1) > ln) { 
 	  path.pop();
-	  break;
+	  done = true;
 	}
-	// Recursive call
-	else if((adj[st][i] == 1) && (visited[i] == 0)) { 
-	  path.push(i);
-	  dfs(path, visited, adj, i, fi, ln, size);
+	// Dead end, at the last vertex of the graph
+	else if (!descend && ((i < 0) || (i == (size - 1))) &&
+		 (!path.empty())) {
+	  path.pop();
 	}
-	// Dead end
-	else if ((i == (size - 1)) && (!path.empty())) { path.pop(); }
       }
+      if (done) { descend = false; }
+    }
+
+    // Go down to the neighbor, in place of a recursive call
+    if (descend) {
+      path.push(i);
+      next.vertex = i;
+      next.cursor = adj.offset[i];
+      next.joined = hasEdge(adj, i, fi);
+      visited[i >> 6] |= 1ULL << (i & 63);
+      frames.push_back(next);
+    }
+    // Move on to the next neighbor
+    else if (!done && (e < last)) { ++frames.back().cursor; }
+    // Done with this vertex: back up to the one before, which moves on
+    //   from the neighbor it came down to
+    else {
+      frames.pop_back();
+      if (!frames.empty()) { ++frames.back().cursor; }
     }
-    // Reached end
-    else { return; }
   }
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-stack<int> findPath(vector< vector<int> >& adj, int st, 
+stack<int> findPath(const csr& adj, int st,
 		const int& size, const int& fi, const int& ln) {
-  vector<int> visited;
   stack<int> path, rev;
-  
-  for(int i = 0; i < size; ++i) {
-    visited.push_back(0);
-  }
 
+  // Vertices not in the graph have no path
+  if ((st < 0) || (st >= size) || (fi < 0) || (fi >= size)) {
+    rev.push(-1);
+    return rev;
+  }
+  
   path.push(st);
-  dfs(path, visited, adj, st, fi, ln, size);
+  dfs(path, adj, st, fi, ln, size);
 
   // Check for unavailible path
   if (ln != 0) {
@@ -320,35 +765,847 @@ bool isValid(const string& expr) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-bool loadGraph(string fp, int& size, queue<string>& graph) {
-  string extract;
+stack<int> shortestPath(const csr& adj, int st, int fi, long long& reached) {
+  int size = adj.vertices;
+  bfsSide from, to;   // Grown from st and from fi
+  bfsSide *end[2] = { &from, &to };
+  int meet, v;
+  stack<int> rev;
+  vector<int> tail;   // The path from the meeting vertex on to fi
+
+  // Vertices not in the graph have no path
+  if ((st < 0) || (st >= size) || (fi < 0) || (fi >= size)) {
+    rev.push(-1);
+    return rev;
+  }
+
+  for (int k = 0; k < 2; ++k) {
+    v = (k == 0) ? st : fi;
+    end[k]->parent.assign(size, -1);
+    end[k]->parent[v] = v;
+    end[k]->frontier.assign(1, v);
+    end[k]->inFrontier.assign((size + 63) / 64, 0);
+    end[k]->unexplored = (long long)adj.offset[size] -
+      (adj.offset[v + 1] - adj.offset[v]);
+    end[k]->bottomUp = false;
+  }
+  reached += (st == fi) ? 1 : 2;
+
+  // Grow the end with the smaller frontier until the two meet
+  meet = (st == fi) ? st : -1;
+  while ((meet < 0) && !from.frontier.empty() && !to.frontier.empty()) {
+    if (from.frontier.size() <= to.frontier.size()) {
+      meet = growLevel(adj, from, to, reached);
+    }
+    else { meet = growLevel(adj, to, from, reached); }
+  }
+  if (meet < 0) {
+    rev.push(-1);
+    return rev;
+  }
+
+  // Stack the path from fi back to the meeting vertex, then on to st
+  for (v = meet; v != fi; v = to.parent[v]) { tail.push_back(to.parent[v]); }
+  for (int k = (int)tail.size() - 1; k >= 0; --k) { rev.push(tail[k]); }
+  rev.push(meet);
+  for (v = meet; v != st; v = from.parent[v]) { rev.push(from.parent[v]); }
+
+  return rev;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+int growLevel(const csr& adj, bfsSide& near, const bfsSide& far,
+	      long long& reached) {
+  vector<int> next;        // The new level
+  long long edges = 0;     // Neighbors listed by the frontier
+  int meet = -1;
+  int u, w;
+
+  for (size_t k = 0; k < near.frontier.size(); ++k) {
+    u = near.frontier[k];
+    edges += adj.offset[u + 1] - adj.offset[u];
+  }
+
+  // Bottom-up pays off once the frontier is a large part of the graph
+  if (!near.bottomUp) {
+    near.bottomUp = (edges > near.unexplored / BOTTOM_UP_ALPHA);
+  }
+  else {
+    near.bottomUp = ((long long)near.frontier.size() * BOTTOM_UP_BETA >=
+		     adj.vertices);
+  }
+
+  if (!near.bottomUp) {
+    // Top-down: every edge out of the frontier
+    for (size_t k = 0; (meet < 0) && (k < near.frontier.size()); ++k) {
+      u = near.frontier[k];
+      for (int e = adj.offset[u]; (meet < 0) && (e < adj.offset[u + 1]); ++e) {
+	w = adj.neighbor[e];
+	if (near.parent[w] >= 0) { continue; }
+	near.parent[w] = u;
+	near.unexplored -= adj.offset[w + 1] - adj.offset[w];
+	next.push_back(w);
+	if (far.parent[w] >= 0) { meet = w; }
+      }
+    }
+  }
+  else {
+    // Bottom-up: every vertex not yet reached, until it finds a neighbor in
+    //   the frontier
+    for (size_t k = 0; k < near.frontier.size(); ++k) {
+      u = near.frontier[k];
+      near.inFrontier[u >> 6] |= 1ULL << (u & 63);
+    }
+    for (int v = 0; (meet < 0) && (v < adj.vertices); ++v) {
+      if (near.parent[v] >= 0) { continue; }
+      for (int e = adj.offset[v]; e < adj.offset[v + 1]; ++e) {
+	w = adj.neighbor[e];
+	if (near.inFrontier[w >> 6] & (1ULL << (w & 63))) {
+	  near.parent[v] = w;
+	  near.unexplored -= adj.offset[v + 1] - adj.offset[v];
+	  next.push_back(v);
+	  if (far.parent[v] >= 0) { meet = v; }
+	  break;
+	}
+      }
+    }
+    for (size_t k = 0; k < near.frontier.size(); ++k) {
+      u = near.frontier[k];
+      near.inFrontier[u >> 6] &= ~(1ULL << (u & 63));
+    }
+  }
+
+  reached += next.size();
+  near.frontier.swap(next);
+  return meet;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+stack<int> exactPath(const csr& adj, int st, int fi, int ln, long long& steps) {
+  int size = adj.vertices;
+  exactSearch s;
+  vector<int> path, back;  // Forward from st, and backward from fi
+  stack<int> rev;
+  bool found = false;
+  int d;                   // Shortest walk from st to fi of the path's parity
+
+  // Vertices not in the graph have no path, nor does a simple path have more
+  //   vertices than the graph
+  if ((st < 0) || (st >= size) || (fi < 0) || (fi >= size) ||
+      (ln < 1) || (ln > size)) {
+    rev.push(-1);
+    return rev;
+  }
+  if (st == fi) {
+    rev.push((ln == 1) ? st : -1);
+    return rev;
+  }
+
+  // No path if there is not even a walk of that length to fi
+  s.start = st;
+  s.end = fi;
+  s.edges = ln - 1;
+  distances(adj, fi, s.toEnd);
+  d = s.toEnd[2 * st + (s.edges & 1)];
+  if ((d < 0) || (d > s.edges)) {
+    rev.push(-1);
+    return rev;
+  }
+  s.onPath.assign((size + 63) / 64, 0);
+  s.dead.resize(min(s.edges, MEMO_LENGTHS));
+  s.steps = 0;
+
+  s.meeting = false;
+  s.budget = ((s.edges >= MEET_MIN) && (s.edges <= MEET_MAX)) ? MEET_AFTER : -1;
+  s.gaveUp = false;
+
+  // Search forward alone first
+  path.push_back(st);
+  s.onPath[st >> 6] |= 1ULL << (st & 63);
+  found = growPath(adj, s, path, s.edges, false);
+
+  // Keep every half path back from fi, to be met by the search from st
+  if (s.gaveUp) {
+    distances(adj, st, s.toStart);
+    back.push_back(fi);
+    s.onPath[fi >> 6] |= 1ULL << (fi & 63);
+    s.meeting = !growPath(adj, s, back, s.edges / 2, true);
+    for (size_t k = 0; k < back.size(); ++k) {
+      s.onPath[back[k] >> 6] &= ~(1ULL << (back[k] & 63));
+    }
+    sort(s.meets.begin(), s.meets.end());
+
+    // Meet them, or if there were too many to keep, go all the way to fi
+    s.budget = -1;
+    if (!s.meeting) { found = growPath(adj, s, path, s.edges, false); }
+    else if (!s.meets.empty()) {
+      found = growPath(adj, s, path, s.edges - s.edges / 2, false);
+    }
+  }
+  steps += s.steps;
+
+  if (!found) {
+    rev.push(-1);
+    return rev;
+  }
+  for (int k = (int)path.size() - 1; k >= 0; --k) { rev.push(path[k]); }
+  return rev;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+void distances(const csr& adj, int from, vector<int>& dist) {
+  vector<int> queue;  // The end of each walk, as 2v plus its parity, in the
+                      //   order reached
+  int u, y;
+
+  dist.assign(2 * adj.vertices, -1);
+  dist[2 * from] = 0;
+  queue.push_back(2 * from);
+  for (size_t k = 0; k < queue.size(); ++k) {
+    u = queue[k] >> 1;
+    for (int e = adj.offset[u]; e < adj.offset[u + 1]; ++e) {
+      y = 2 * adj.neighbor[e] + ((queue[k] & 1) ^ 1);
+      if (dist[y] < 0) {
+	dist[y] = dist[queue[k]] + 1;
+	queue.push_back(y);
+      }
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+bool growPath(const csr& adj, exactSearch& s, vector<int>& path, int length,
+	      bool backward) {
+  const vector<int>& bound = backward ? s.toStart : s.toEnd;
+  int far = backward ? s.start : s.end;  // May only come last
+  vector<exactFrame> frames;  // The vertices this call has added, and the
+                              //   one it grows from
+  exactFrame next, done;
+  int v, w, left;             // Edges left to the far end, from w
+  int d;                      // Shortest walk there of the same parity
+  bool blocked;
+  size_t base = path.size();  // Where this call began
+
+  next.vertex = path.back();
+  next.cursor = adj.offset[next.vertex];
+  next.blocked = false;
+  frames.push_back(next);
+
+  while (!frames.empty()) {
+    v = frames.back().vertex;
+    if (frames.back().cursor < adj.offset[v + 1]) {
+      w = adj.neighbor[frames.back().cursor++];
+      left = s.edges - (int)path.size();
+
+      // Passed over whatever came before: with no walk of the length left
+      //   to the far end, reaching it too soon, or a dead end
+      d = bound[2 * w + (left & 1)];
+      if ((d < 0) || (d > left) || ((w == far) && (left > 0))) { continue; }
+      if (!backward && (left < (int)s.dead.size()) && !s.dead[left].empty() &&
+	  (s.dead[left][w >> 6] & (1ULL << (w & 63)))) {
+	continue;
+      }
+      // Passed over because of what came before
+      if (s.onPath[w >> 6] & (1ULL << (w & 63))) {
+	frames.back().blocked = true;
+	continue;
+      }
+      ++s.steps;
+      if (!backward && (s.budget >= 0) && (s.steps > s.budget)) {
+	s.gaveUp = true;
+	break;
+      }
+
+      // w ends this stretch of the path
+      if ((int)frames.size() == length) {
+	if (backward) {
+	  s.meets.push_back(make_pair(w, (int)s.halves.size()));
+	  s.halves.insert(s.halves.end(), path.end() - length, path.end());
+	  if ((int)s.meets.size() > MEET_HALVES) { return true; }
+	}
+	else if (!s.meeting) {
+	  path.push_back(w);
+	  return true;
+	}
+	else {
+	  blocked = false;
+	  if (joinHalf(s, path, w, blocked)) { return true; }
+	  if (blocked) { frames.back().blocked = true; }
+	}
+	continue;
+      }
+
+      // Go down to w
+      path.push_back(w);
+      s.onPath[w >> 6] |= 1ULL << (w & 63);
+      next.vertex = w;
+      next.cursor = adj.offset[w];
+      next.blocked = false;
+      frames.push_back(next);
+    }
+    else {
+      // Done with v, but not the vertex grown from: back up to the one
+      //   before. Unless it was passed over because of what came before, v
+      //   is a dead end with this many edges left.
+      done = frames.back();
+      frames.pop_back();
+      if (frames.empty()) { break; }
+      left = s.edges - ((int)path.size() - 1);
+      if (!backward && !done.blocked && (left < (int)s.dead.size())) {
+	if (s.dead[left].empty()) {
+	  s.dead[left].assign((adj.vertices + 63) / 64, 0);
+	}
+	s.dead[left][v >> 6] |= 1ULL << (v & 63);
+      }
+      if (done.blocked) { frames.back().blocked = true; }
+      s.onPath[v >> 6] &= ~(1ULL << (v & 63));
+      path.pop_back();
+    }
+  }
+
+  // Back to the path as it was, if the budget ran out part way
+  while (path.size() > base) {
+    s.onPath[path.back() >> 6] &= ~(1ULL << (path.back() & 63));
+    path.pop_back();
+  }
+  return false;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+bool joinHalf(exactSearch& s, vector<int>& path, int m, bool& blocked) {
+  vector< pair<int, int> >::iterator at;
+  int half = s.edges / 2;  // Edges of each half path
+  const int *h;
+  bool clear;
+
+  at = lower_bound(s.meets.begin(), s.meets.end(), make_pair(m, -1));
+  for (; (at != s.meets.end()) && (at->first == m); ++at) {
+    h = &s.halves[at->second];
+    // Those nearest m are the likeliest to be on the path too
+    clear = true;
+    for (int k = half - 1; clear && (k >= 0); --k) {
+      clear = !(s.onPath[h[k] >> 6] & (1ULL << (h[k] & 63)));
+    }
+    if (clear) {
+      path.push_back(m);
+      for (int k = half - 1; k >= 0; --k) { path.push_back(h[k]); }
+      return true;
+    }
+    blocked = true;
+  }
+  return false;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+stack<int> searchPath(const csr& adj, int size, int st, int fi, int ln,
+		      bool shortest, bool exact, long long& reached) {
+  if (shortest && (ln == 0)) { return shortestPath(adj, st, fi, reached); }
+  if (exact && (ln != 0)) { return exactPath(adj, st, fi, ln, reached); }
+  return findPath(adj, st, size, fi, ln);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+void batchSearch(batch& job, int count) {
+  vector<pthread_t> pool;  // The batch threads
+  struct timespec start;   // When the batch started
+  struct timespec stop;    // And when it finished
+  double seconds;          // Time taken
+
+  job.next = 0;
+  job.budget = (size_t)BATCH_BUDGET << 20;
+  job.held = 0;
+  job.paths = job.found = job.bytes = 0;
+  job.failed = 0;
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.freed, NULL);
+
+  // No more threads than graphs
+  if ((size_t)count > job.graphs.size()) { count = job.graphs.size(); }
+  pool.resize(count);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < count; ++i) {
+    pthread_create(&pool[i], NULL, batchLoop, &job);
+  }
+  for (int i = 0; i < count; ++i) { pthread_join(pool[i], NULL); }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  if (seconds <= 0) { seconds = 1e-9; }
+
+  printf("Graphs:\t\t%lu (%i failed)\n"
+	 "Paths:\t\t%lld (%lld found)\n"
+	 "Threads:\t%i\n"
+	 "Seconds:\t%.3f\n"
+	 "Throughput:\t%.1f graphs/s, %.1f paths/s, %.1f MB/s\n",
+	 (unsigned long)job.graphs.size(), job.failed, job.paths, job.found,
+	 count, seconds, job.graphs.size() / seconds, job.paths / seconds,
+	 job.bytes / seconds / (1 << 20));
+
+  pthread_cond_destroy(&job.freed);
+  pthread_mutex_destroy(&job.lock);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+void listBatch(string source, vector<graphJob>& graphs) {
+  ifstream manifest;        // File listing the paths
+  string line;              // One path from it
+  string name, st, fi, ln;  // The fields of the line
+  map<string, size_t> seen; // Where each graph is in 'graphs'
+  map<string, size_t>::iterator at;
+  int number = 0;           // Line number, for reporting
 
+  manifest.open(source.c_str());
+  if (manifest.fail()) {
+    printf("Manifest file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  while (getline(manifest, line)) {
+    ++number;
+    istringstream fields(line);
+    if (!(fields >> name)) { continue; }
+    if (!(fields >> st >> fi >> ln) || !isValid(st) || !isValid(fi) ||
+	!isValid(ln)) {
+      printf("Line %i of the manifest is not a file and three numbers.\n",
+	     number);
+      continue;
+    }
+
+    // Every path asked of a graph is searched for once it is built
+    at = seen.find(name);
+    if (at == seen.end()) {
+      at = seen.insert(make_pair(name, graphs.size())).first;
+      graphs.push_back(graphJob());
+      graphs.back().name = name;
+    }
+    graphs[at->second].queries.push_back(st + " " + fi + " " + ln);
+  }
+  manifest.close();
+
+  if (graphs.empty()) {
+    printf("No paths to search for.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+void* batchLoop(void* arg) {
+  batch *job = (batch *)arg;
+  const graphJob *graph;    // Graph being searched
+  edgeReader in = { NULL, 0, NULL, NULL, NULL };
+  stack<int> none;          // For tidyUp()
+  csr adj;                  // The graph, built
+  int size;                 // Its number of vertices
+  size_t need;              // Memory it is taken to need
+  size_t bytes;             // Size of its file
+  bool searched;            // Whether it was searched
+
+  while (true) {
+    pthread_mutex_lock(&job->lock);
+    if (job->next == job->graphs.size()) {
+      pthread_mutex_unlock(&job->lock);
+      break;
+    }
+    graph = &job->graphs[job->next++];
+    pthread_mutex_unlock(&job->lock);
+
+    // Wait for memory, once the header gives the number of vertices; a
+    //   graph larger than the budget runs on its own
+    searched = loadGraph(graph->name, size, in);
+    need = 0;
+    if (searched) {
+      need = in.size * BATCH_FACTOR + (size_t)size * BATCH_VERTEX;
+      pthread_mutex_lock(&job->lock);
+      while ((job->held > 0) && (job->held + need > job->budget)) {
+	pthread_cond_wait(&job->freed, &job->lock);
+      }
+      job->held += need;
+      pthread_mutex_unlock(&job->lock);
+
+      searched = createGraph(in, adj, size) &&
+	searchFile(*job, *graph, adj, size);
+    }
+    if (!searched) { printf("%s: could not be searched.\n",
+			    graph->name.c_str()); }
+
+    // The graph is freed before its memory is given back to the batch
+    bytes = in.size;
+    tidyUp(adj, none, in);
+
+    pthread_mutex_lock(&job->lock);
+    job->held -= need;
+    if (searched) { job->bytes += bytes; }
+    else { ++job->failed; }
+    pthread_cond_broadcast(&job->freed);
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+bool searchFile(batch& job, const graphJob& graph, const csr& adj, int size) {
+  FILE *out;              // The ".paths" file
+  stack<int> results;     // Path found
+  long long reached;      // Vertices reached, unused here
+  long long found = 0;    // Paths found
+  int st, fi, ln;
+
+  out = fopen((graph.name + ".paths").c_str(), "w");
+  if (out == NULL) { return false; }
+
+  for (size_t q = 0; q < graph.queries.size(); ++q) {
+    istringstream fields(graph.queries[q]);
+    fields >> st >> fi >> ln;
+
+    reached = 0;
+    results = searchPath(adj, size, st, fi, ln, job.shortest, job.exact,
+			 reached);
+    fprintf(out, "%s: ", graph.queries[q].c_str());
+    if (results.top() < 0) { fprintf(out, "Unable to find path.\n"); }
+    else {
+      ++found;
+      fprintf(out, "Path Found: ");
+      while (!results.empty()) {
+	fprintf(out, (results.size() == 1) ? "%i\n" : "%i, ", results.top());
+	results.pop();
+      }
+    }
+  }
+  fclose(out);
+
+  pthread_mutex_lock(&job.lock);
+  job.paths += graph.queries.size();
+  job.found += found;
+  pthread_mutex_unlock(&job.lock);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+bool loadGraph(string fp, int& size, edgeReader& graph) {
   if (isQuit(fp)) { return false; }
 
-  input.open(fp.c_str());
-  if (input.fail()) {
+  if (!openEdges(fp, graph)) {
     printf("Error loading file <%s>. Please try again.\n", fp.c_str());
     return false;
   }
 
-  input >> size;
+  if (nextRecord(graph, 1, &size) <= 0) {
+    printf("The file does not begin with the number of vertices.\n");
+    return false;
+  }
+  graph.edges = graph.next;
+
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Maps a graph file into memory for reading.
+//   Pre:  The name of the file and the reader to open.
+//   Post: Returns false if the file cannot be read.
+bool openEdges(string fp, edgeReader& in) {
+  int fd;
+  struct stat info;
 
-  while(input.good()) {
-    input >> extract;
-    graph.push(extract);
+  in.data = NULL;
+  in.size = 0;
+  fd = open(fp.c_str(), O_RDONLY);
+  if (fd < 0) { return false; }
+  if (fstat(fd, &info) < 0) {
+    close(fd);
+    return false;
   }
 
+  in.size = info.st_size;
+  if (in.size > 0) {
+    in.data = (const char *)mmap(NULL, in.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (in.data == MAP_FAILED) {
+      in.data = NULL;
+      close(fd);
+      return false;
+    }
+    madvise((void *)in.data, in.size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  in.next = in.edges = in.data;
+  in.end = in.data + in.size;
   return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-void tidyUp(vector< vector<int> >& adj, stack<int>& results) {
+// Reads the next record of a graph file: the characters up to a space or the
+//   end of a line, holding numbers of any width separated by commas, and
+//   perhaps within parentheses, as in (u,v) or u,v,w.
+//   Pre:  Room for 'fields' numbers in 'value'.
+//   Post: Returns 1 with the numbers stored in 'value', 0 at the end of the
+//         file, or -1 if the record is not 'fields' numbers of that form.
+int nextRecord(edgeReader& in, int fields, int *value) {
+  const char *next = in.next, *end = in.end;
+  bool paren;         // Whether the record is within parentheses
+  int field = 0;      // Numbers read so far
+  uint64_t number;    // The one being read
+
+  while ((next < end) && isspace((unsigned char)*next)) { ++next; }
+  in.next = next;
+  if (next == end) { return 0; }
+
+  paren = (*next == '(');
+  if (paren) { ++next; }
+  for (;;) {
+    if ((field == fields) || (next == end) ||
+	!isdigit((unsigned char)*next)) { return -1; }
+    next = parseDigits(next, end, number);
+    if (number > INT_MAX) { return -1; }
+    value[field++] = (int)number;
+
+    if ((next == end) || (*next != ',')) { break; }
+    ++next;
+  }
+  if (paren) {
+    if ((next == end) || (*next != ')')) { return -1; }
+    ++next;
+  }
+  if ((field != fields) ||
+      ((next < end) && !isspace((unsigned char)*next))) { return -1; }
+
+  in.next = next;
+  return 1;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned. A run too long for an int stops early
+//         with 'value' above INT_MAX.
+const char *parseDigits(const char *next, const char *end, uint64_t &value) {
+  static const unsigned int scale[9] = { 1, 10, 100, 1000, 10000, 100000,
+					  1000000, 10000000, 100000000 };
+  uint64_t chunk, stop; // Eight characters and the non-digits among them
+  int digits;           // Leading digits in the chunk
+
+  value = 0;
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while ((end - next) >= 8) {
+    memcpy(&chunk, next, 8);
+    chunk ^= 0x3030303030303030ULL; // '0' through '9' become 0 through 9
+
+    // High bit of a byte is set wherever it is not a digit
+    stop = (((chunk & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | chunk)
+      & 0x8080808080808080ULL;
+    digits = stop ? (__builtin_ctzll(stop) >> 3) : 8;
+    if (digits == 0) { return next; }
+
+    // Shift out the rest so the digits are led by zeros, then combine pairs
+    chunk <<= 8 * (8 - digits);
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+    value = value * scale[digits] + chunk;
+    next += digits;
+    if ((digits < 8) || (value > INT_MAX)) { return next; }
+  }
+#endif
+
+  // Tail of the file, one character at a time
+  for (; (next < end) && isdigit((unsigned char)*next); ++next) {
+    value = value * 10 + (*next - '0');
+    if (value > INT_MAX) { return next + 1; }
+  }
+  return next;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+// Goes back to the first edge of a graph file, to read the edges again.
+void rewindEdges(edgeReader& in) {
+  in.next = in.edges;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Unmaps a graph file.
+void closeEdges(edgeReader& in) {
+  if (in.data != NULL) { munmap((void *)in.data, in.size); }
+  in.data = NULL;
+  in.size = 0;
+  in.next = in.edges = in.end = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+void tidyUp(csr& adj, stack<int>& results, edgeReader& graph) {
   // Close file
-  input.close();
+  closeEdges(graph);
   // Clear Stack
   while(!results.empty()) { results.pop(); }
-  // Empty adjacency matrix
-  adj.clear();
+  // Empty graph; clear() would keep the capacity of the largest graph yet
+  adj.vertices = 0;
+  vector<int>().swap(adj.offset);
+  vector<int>().swap(adj.neighbor);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting) {
+#ifdef __linux__
+  static const unsigned long long config[COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+  struct perf_event_attr attr;
+#endif
+
+  prof.phases.clear();
+  for (int k = 0; k < COUNTERS; ++k) {
+    prof.fd[k] = -1;
+#ifdef __linux__
+    if (!counting) { continue; }
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[k];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count the threads started later too
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    prof.fd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name) {
+  phase fresh;   // A phase not seen before
+  size_t i;
+
+  for (i = 0; i < prof.phases.size(); ++i) {
+    if (strcmp(prof.phases[i].name, name) == 0) { break; }
+  }
+  if (i == prof.phases.size()) {
+    fresh.name = name;
+    fresh.seconds = 0;
+    for (int k = 0; k < COUNTERS; ++k) {
+      fresh.count[k] = (prof.fd[k] < 0) ? -1 : 0;
+    }
+    prof.phases.push_back(fresh);
+  }
+  prof.current = i;
+
+  for (int k = 0; k < COUNTERS; ++k) { prof.base[k] = readCounter(prof.fd[k]); }
+  clock_gettime(CLOCK_MONOTONIC, &prof.start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof) {
+  struct timespec stop;
+  phase &done = prof.phases[prof.current];
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  done.seconds += (stop.tv_sec - prof.start.tv_sec) +
+    (stop.tv_nsec - prof.start.tv_nsec) / 1e9;
+  for (int k = 0; k < COUNTERS; ++k) {
+    if (prof.fd[k] >= 0) {
+      done.count[k] += readCounter(prof.fd[k]) - prof.base[k];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd) {
+  unsigned long long value[3]; // Count, time enabled and time running
+
+  if ((fd < 0) || (read(fd, value, sizeof(value)) != sizeof(value))) {
+    return 0;
+  }
+  if ((value[2] == 0) || (value[2] >= value[1])) { return value[0]; }
+  return (long long)((double)value[0] * value[1] / value[2]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json) {
+  if (json) {
+    fflush(stdout);
+    fprintf(stderr, "{\"tool\": \"depthFirstSearch\", \"phases\": [");
+    for (size_t i = 0; i < prof.phases.size(); ++i) {
+      fprintf(stderr, "%s{\"name\": \"%s\", \"seconds\": %.6f",
+	      i ? ", " : "", prof.phases[i].name, prof.phases[i].seconds);
+      for (int k = 0; k < COUNTERS; ++k) {
+	if (prof.phases[i].count[k] < 0) {
+	  fprintf(stderr, ", \"%s\": null", counterNames[k]);
+	}
+	else {
+	  fprintf(stderr, ", \"%s\": %lld", counterNames[k],
+		  prof.phases[i].count[k]);
+	}
+      }
+      fprintf(stderr, "}");
+    }
+    fprintf(stderr, "]}\n");
+    return;
+  }
+
+  printf("%-10s %12s", "Phase", "Seconds");
+  for (int k = 0; k < COUNTERS; ++k) { printf(" %14s", counterNames[k]); }
+  printf("\n");
+  for (size_t i = 0; i < prof.phases.size(); ++i) {
+    printf("%-10s %12.6f", prof.phases[i].name, prof.phases[i].seconds);
+    for (int k = 0; k < COUNTERS; ++k) {
+      if (prof.phases[i].count[k] < 0) { printf(" %14s", "n/a"); }
+      else { printf(" %14lld", prof.phases[i].count[k]); }
+    }
+    printf("\n");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints out instructions on the use of command line options.
+void usage() {
+  printf("Flags:\n"
+	 "\t-b\t\tFind the shortest path, breadth first from both ends,\n"
+	 "\t\t\twhen the length asked for is 0\n"
+	 "\t-e\t\tFind paths of the length asked for by a search pruned\n"
+	 "\t\t\tby distance and dead ends, met in the middle\n"
+	 "\t-h\t\tPrints this message.\n"
+	 "\t-j\t\tPrint the time and counters of each phase as JSON,\n"
+	 "\t\t\ton standard error\n"
+	 "\t-m <list>\tSearch for each path of a manifest, a line apiece\n"
+	 "\t\t\tof a file, two vertices and a length, into\n"
+	 "\t\t\t<file>.paths; -p sets the threads\n"
+	 "\t-p <threads>\tThreads for -m, or every processor by default\n"
+	 "\t-v\t\tPrint diagnostic info, with the time and counters of\n"
+	 "\t\t\teach phase\n\n");
 }
 ////////////////////////////////////////////////////////////////////////////////
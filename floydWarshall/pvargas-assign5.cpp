@@ -30,7 +30,9 @@
 // non-negative integer representing the total number of vertices in the graph.
 // Following this are the vertices and their weighted edges, one per line. The
 // format is u,v,w where there is an edge of weight w from u to v, such that u,
-// v, and w are all single digit, non-negative integers.
+// v, and w are non-negative integers of any number of digits, u and v are
+// less than the number of vertices, and w is small enough that no path can
+// reach infinity. The file is read in place, without a copy of its text.
 //
 // References
 //------------------------------------------------------------------------------
@@ -48,20 +50,64 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
+#include <cctype>   // isdigit(), isspace()
+#include <climits>  // INT_MAX
 #include <cstdio>   // cin, cout
 #include <cstdlib>  // EXIT_SUCCESS and things
-#include <fstream>  // File I/O
+#include <cstring>  // strcmp(), memset(), memcpy()
+#include <ctime>    // clock_gettime()
+#include <fcntl.h>  // open()
 #include <iostream> // printf() etc...
-#include <queue>    // Queue Container
+#include <stdint.h> // uint64_t
 #include <string>   // String class
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
 #include <unistd.h> // Line Parsing
 #include <vector>   // Vector Containter
+#ifdef __linux__
+#include <linux/perf_event.h> // Hardware counters
+#include <sys/syscall.h>       // perf_event_open()
+#endif
 
 using namespace std;
-ifstream input;
 
-#define INF 100       // Iinfinity value for Floyd's Algorithm
+#define INF (INT_MAX / 2) // Iinfinity value for Floyd's Algorithm; twice it
+                          //   still fits in an int
 bool verbose = false; // For Diagnostic information.
+
+// Profile: hardware counters read around each phase, named in counterNames
+#define COUNTERS 4
+
+// Names of the hardware counters of a profile, as reported
+const char *counterNames[COUNTERS] = { "cycles", "instructions",
+				       "branch-misses", "llc-misses" };
+
+// Wall time and hardware counters of one phase of the program. A phase run
+//   more than once adds up.
+struct phase {
+  const char *name;          // As reported
+  double seconds;            // Wall time
+  long long count[COUNTERS]; // Counted events; -1 where unavailable
+};
+
+// Timing of a run: the counters, the phase under way and those seen so far.
+struct profile {
+  int fd[COUNTERS];          // From perf_event_open(), or -1
+  long long base[COUNTERS];  // Counts when the current phase started
+  struct timespec start;     // Time when it started
+  size_t current;            // Its place in 'phases'
+  vector<phase> phases;      // In the order first started
+};
+
+// A graph file mapped into memory and read in place, a record at a time,
+//   with no copy of its text.
+struct edgeReader {
+  const char *data;   // Contents of the file, or NULL if it is empty
+  size_t size;        // Size of the file
+  const char *next;   // Where reading resumes
+  const char *edges;  // Start of the first edge, after the number of vertices
+  const char *end;    // One past the last character
+};
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -72,16 +118,36 @@ bool verbose = false; // For Diagnostic information.
 // Post: The distance matrix of the all-pairs, shortest-path problem.
 vector< vector<int> > distFloyd(vector< vector<int> > adj, int size);
 
-// Tests each number in vector, and checks each character is a digit.
-//   Pre:  A string to be checked.
-//   Post: Returns true if string is all digits; false otherwise.
-bool isValid(const string &expr);
-
-// Opens file and throws information into a queue to be processed.
-// Pre:  The name of the input file.
-// Post: The file is opened, the input is stored in the queue. The queue is
-//       then returned. 
-queue<string> loadGraph(string fp);
+// Opens the file to be processed.
+// Pre:  The name of the input file and a reader for it.
+// Post: The file is mapped and the reader is left at its start.
+void loadGraph(string fp, edgeReader& graph);
+
+// Maps a graph file into memory for reading.
+//   Pre:  The name of the file and the reader to open.
+//   Post: Returns false if the file cannot be read.
+bool openEdges(string fp, edgeReader& in);
+
+// Reads the next record of a graph file: the characters up to a space or the
+//   end of a line, holding numbers of any width separated by commas, and
+//   perhaps within parentheses, as in (u,v) or u,v,w.
+//   Pre:  Room for 'fields' numbers in 'value'.
+//   Post: Returns 1 with the numbers stored in 'value', 0 at the end of the
+//         file, or -1 if the record is not 'fields' numbers of that form.
+int nextRecord(edgeReader& in, int fields, int *value);
+
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned. A run too long for an int stops early
+//         with 'value' above INT_MAX.
+const char *parseDigits(const char *next, const char *end, uint64_t &value);
+
+// Goes back to the first edge of a graph file, to read the edges again.
+void rewindEdges(edgeReader& in);
+
+// Unmaps a graph file.
+void closeEdges(edgeReader& in);
 
 // Returns the smaller of the two integers.
 int min(int a, int b) { if(a < b) return a; else return b; }
@@ -100,15 +166,15 @@ void printDist(vector< vector<int> > dist, int size);
 // Post: None.
 void printMatrix(vector< vector<int> > mat, int size);
 
-// Same as printMatrix but formatted for verbose.
+// Same as printMatrix but formatted for verbose, with infinity shown as X.
 void printMatrixVerb(vector< vector<int> > mat, int size);
 
 // Process the input from the file.
-// Pre:  A queue containing all the information from the file and an empty
-//       integer for the number of vertices.
+// Pre:  The loaded graph file and an empty integer for the number of
+//       vertices.
 // Post: The total number of vertices is stored in 'size' and returns a
 //       weighted, directed adjacency matrix.
-vector< vector<int> > processInput(queue<string> graph, int& size);
+vector< vector<int> > processInput(edgeReader& graph, int& size);
 
 // Creates and returns the transitive matrix of a graph, or Warshall's
 //   algorithm
@@ -116,6 +182,24 @@ vector< vector<int> > processInput(queue<string> graph, int& size);
 // Post: The transitive matrix.
 vector< vector<int> > transWarshall(vector< vector<int> > adj, int size);
 
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting);
+
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name);
+
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof);
+
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd);
+
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json);
+
 // Prints out instructions on the use of command line options.
 void usage();
 ////////////////////////////////////////////////////////////////////////////////
@@ -127,15 +211,21 @@ int main(int argc, char **argv) {
   int size;                               // Total number of vertices
   vector< vector<int> > adj, trans, dist; // Adjacency, Transitive and All-Pairs
                                           // Shortest-Path Distance matrices
+  bool json = false;                      // Profile as JSON
+  profile prof;                           // Time and counters of each phase
+  edgeReader graph;                       // The input file, mapped
  
   printf("Welcome to Warehouse 13, Department of Software!\n");
 
   // Parse the line
-  while ((c = getopt(argc, argv, "hv")) != EOF) {
+  while ((c = getopt(argc, argv, "hjv")) != EOF) {
     switch (c) {
     case 'h': // Help message on command line options.
       usage();
       break;
+    case 'j': // Profile as JSON.
+      json = true;
+      break;
     case 'v': // Print Diagnostic information.
       verbose = true;
       break;
@@ -146,6 +236,7 @@ int main(int argc, char **argv) {
   if (verbose)
     printf("Verbose turned on.\n" \
 	   "Normal Output\t\t\t\tVerbose Output\n"); 
+  openProfile(prof, verbose || json);
   
   if (optind == argc) { // No command line arguments
     printf("Please enter the name of the input file: ");
@@ -154,20 +245,36 @@ int main(int argc, char **argv) {
   else { fp = argv[optind]; } // File given on command line
 
   // Imput file and process
-  adj = processInput(loadGraph(fp), size);
+  startPhase(prof, "ingest");
+  loadGraph(fp, graph);
+  adj = processInput(graph, size);
+  closeEdges(graph);
+  endPhase(prof);
+  startPhase(prof, "output");
   printf("Weighted, Directed Adjaceny Matrix\n");
   printMatrix(adj, size);
+  endPhase(prof);
 
   // Print shortest distance matrix
+  startPhase(prof, "floyd");
   dist = distFloyd(adj, size);
+  endPhase(prof);
+  startPhase(prof, "output");
   printf("Shortest-Distance Matrix\n");
   printDist(dist, size);
+  endPhase(prof);
 
   // Print transitive matrix
+  startPhase(prof, "warshall");
   trans = transWarshall(adj, size);
+  endPhase(prof);
+  startPhase(prof, "output");
   printf("Transitive Matrix\n");
   printMatrix(trans, size);
-    
+  endPhase(prof);
+
+  if (verbose) { reportProfile(prof, false); }
+  if (json) { reportProfile(prof, true); }
   printf("Good Bye!\n");
   return EXIT_SUCCESS;
 }
@@ -207,45 +314,152 @@ vector< vector<int> > distFloyd(vector< vector<int> > adj, int size) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Tests each number in vector, and checks each character is a digit.
-//   Pre:  A string to be checked.
-//   Post: Returns true if string is all digits; false otherwise.
-bool isValid(const string &expr) {
-  char next;
-  bool failed = false;
+// Opens the file to be processed.
+// Pre:  The name of the input file and a reader for it.
+// Post: The file is mapped and the reader is left at its start.
+void loadGraph(string fp, edgeReader& graph) {
+  if (!openEdges(fp, graph)) {
+    printf("Error loading file <%s>. Good Bye!\n", fp.c_str());
+    exit(EXIT_FAILURE);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Maps a graph file into memory for reading.
+//   Pre:  The name of the file and the reader to open.
+//   Post: Returns false if the file cannot be read.
+bool openEdges(string fp, edgeReader& in) {
+  int fd;
+  struct stat info;
+
+  in.data = NULL;
+  in.size = 0;
+  fd = open(fp.c_str(), O_RDONLY);
+  if (fd < 0) { return false; }
+  if (fstat(fd, &info) < 0) {
+    close(fd);
+    return false;
+  }
 
-  for (unsigned int i = 0; !failed && (i < expr.length()); ++i) {
-    next = expr[i];
-    if (!(isdigit(next))) { failed = true; }
+  in.size = info.st_size;
+  if (in.size > 0) {
+    in.data = (const char *)mmap(NULL, in.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (in.data == MAP_FAILED) {
+      in.data = NULL;
+      close(fd);
+      return false;
+    }
+    madvise((void *)in.data, in.size, MADV_SEQUENTIAL);
   }
-  return !failed;
+  close(fd);
+
+  in.next = in.edges = in.data;
+  in.end = in.data + in.size;
+  return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Opens file and throws information into a queue to be processed.
-// Pre:  The name of the input file.
-// Post: The file is opened, the input is stored in the queue and the queue is
-//       then returned. 
-queue<string> loadGraph(string fp) {
-  queue<string> graph;
-  string extract;
+// Reads the next record of a graph file: the characters up to a space or the
+//   end of a line, holding numbers of any width separated by commas, and
+//   perhaps within parentheses, as in (u,v) or u,v,w.
+//   Pre:  Room for 'fields' numbers in 'value'.
+//   Post: Returns 1 with the numbers stored in 'value', 0 at the end of the
+//         file, or -1 if the record is not 'fields' numbers of that form.
+int nextRecord(edgeReader& in, int fields, int *value) {
+  const char *next = in.next, *end = in.end;
+  bool paren;         // Whether the record is within parentheses
+  int field = 0;      // Numbers read so far
+  uint64_t number;    // The one being read
+
+  while ((next < end) && isspace((unsigned char)*next)) { ++next; }
+  in.next = next;
+  if (next == end) { return 0; }
+
+  paren = (*next == '(');
+  if (paren) { ++next; }
+  for (;;) {
+    if ((field == fields) || (next == end) ||
+	!isdigit((unsigned char)*next)) { return -1; }
+    next = parseDigits(next, end, number);
+    if (number > INT_MAX) { return -1; }
+    value[field++] = (int)number;
+
+    if ((next == end) || (*next != ',')) { break; }
+    ++next;
+  }
+  if (paren) {
+    if ((next == end) || (*next != ')')) { return -1; }
+    ++next;
+  }
+  if ((field != fields) ||
+      ((next < end) && !isspace((unsigned char)*next))) { return -1; }
+
+  in.next = next;
+  return 1;
+}
+////////////////////////////////////////////////////////////////////////////////
 
-  input.open(fp.c_str());
-  if (input.fail()) {
-    printf("Error loading file <%s>. Good Bye!\n", fp.c_str());
-    exit(EXIT_FAILURE);
+////////////////////////////////////////////////////////////////////////////////
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned. A run too long for an int stops early
+//         with 'value' above INT_MAX.
+const char *parseDigits(const char *next, const char *end, uint64_t &value) {
+  static const unsigned int scale[9] = { 1, 10, 100, 1000, 10000, 100000,
+					  1000000, 10000000, 100000000 };
+  uint64_t chunk, stop; // Eight characters and the non-digits among them
+  int digits;           // Leading digits in the chunk
+
+  value = 0;
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while ((end - next) >= 8) {
+    memcpy(&chunk, next, 8);
+    chunk ^= 0x3030303030303030ULL; // '0' through '9' become 0 through 9
+
+    // High bit of a byte is set wherever it is not a digit
+    stop = (((chunk & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | chunk)
+      & 0x8080808080808080ULL;
+    digits = stop ? (__builtin_ctzll(stop) >> 3) : 8;
+    if (digits == 0) { return next; }
+
+    // Shift out the rest so the digits are led by zeros, then combine pairs
+    chunk <<= 8 * (8 - digits);
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+    value = value * scale[digits] + chunk;
+    next += digits;
+    if ((digits < 8) || (value > INT_MAX)) { return next; }
   }
+#endif
 
-  while(input.good()) {
-    input >> extract;
-    graph.push(extract);
+  // Tail of the file, one character at a time
+  for (; (next < end) && isdigit((unsigned char)*next); ++next) {
+    value = value * 10 + (*next - '0');
+    if (value > INT_MAX) { return next + 1; }
   }
+  return next;
+}
+////////////////////////////////////////////////////////////////////////////////
 
-  return graph;
+// Goes back to the first edge of a graph file, to read the edges again.
+void rewindEdges(edgeReader& in) {
+  in.next = in.edges;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// Unmaps a graph file.
+void closeEdges(edgeReader& in) {
+  if (in.data != NULL) { munmap((void *)in.data, in.size); }
+  in.data = NULL;
+  in.size = 0;
+  in.next = in.edges = in.end = NULL;
+}
 ////////////////////////////////////////////////////////////////////////////////
 // Creates a size by size two-dimensional vector.
 vector< vector<int> > newMatrix(int size) {
@@ -286,12 +500,13 @@ void printMatrix(vector< vector<int> > mat, int size) {
     printf("\n");
   }
 }
-// Same as printMatrix but formatted for verbose.
+// Same as printMatrix but formatted for verbose, with infinity shown as X.
 void printMatrixVerb(vector< vector<int> > mat, int size) {
   for (int i = 0; i < size; ++i) {
     printf("\n\t\t\t\t\t");
     for (int j = 0; j < size; ++j)
-      printf("%2i ", mat[i][j]);
+      if (mat[i][j] == INF) printf(" X ");
+      else printf("%2i ", mat[i][j]);
   } 
   printf("\n");
 }
@@ -299,30 +514,25 @@ void printMatrixVerb(vector< vector<int> > mat, int size) {
 
 ////////////////////////////////////////////////////////////////////////////////
 // Process the input from the file.
-// Pre:  A queue containing all the information from the file and an empty
-//       integer for the number of vertices.
+// Pre:  The loaded graph file and an empty integer for the number of
+//       vertices.
 // Post: The total number of vertices is stored in 'size' and returns a
 //       weighted, directed adjacency matrix.
-vector< vector<int> >  processInput(queue<string> graph, int& size) {
-  string temp, tempu, tempv, tempw;
-  int u, v, w;
-  vector<int> row;
+vector< vector<int> >  processInput(edgeReader& graph, int& size) {
+  int edge[3];  // u, v and w
+  int found;    // Whether the edge was read, from nextRecord()
   vector< vector<int> > adj;
 
-  // Check for empty queue
-  if(graph.empty()) {
+  // Import number of vertices, checking for an empty file
+  found = nextRecord(graph, 1, &size);
+  if (found == 0) {
     printf("Error processing input. Good bye!\n");
     exit(EXIT_FAILURE);
   }
-  
-  // Import number of vertices
-  temp = graph.front();
-  graph.pop();
-  if(!isValid(temp)) {
+  if (found < 0) {
     printf("First number is not the number of vertices. Good  bye! \n");
     exit(EXIT_FAILURE);
   }
-  size = atoi(temp.c_str());
   if (verbose)
     printf("\t\t\t\t\tSize: %i\n", size);
   
@@ -330,46 +540,34 @@ vector< vector<int> >  processInput(queue<string> graph, int& size) {
   adj = newMatrix(size);
     
   // Create adjacency matrix while checking for bad input
-  while(!graph.empty()) {
-    temp = graph.front();
-    graph.pop();
-
+  while ((found = nextRecord(graph, 3, edge)) > 0) {
     if (verbose)
-      printf("\t\t\t\t\t%s \t", temp.c_str());
-    
-    if(!(isdigit(temp[0]) &&
-	 isdigit(temp[2]) &&
-	 isdigit(temp[4]))) {
-      printf("Invalid character in graph. Good bye!\n");
+      printf("\t\t\t\t\t%i,%i,%i \t(%i, %i) :%i \n", edge[0], edge[1],
+	     edge[2], edge[0], edge[1], edge[2]);
+
+    if ((edge[0] >= size) || (edge[1] >= size)) {
+      printf("Edge %i,%i names a vertex not in the graph. Good bye!\n",
+	     edge[0], edge[1]);
+      exit(EXIT_FAILURE);
+    }
+    // A path has fewer edges than vertices, so this keeps every path short
+    //   of infinity
+    if (edge[2] >= INF / size) {
+      printf("Weight %i of edge %i,%i is too large. Good bye!\n", edge[2],
+	     edge[0], edge[1]);
       exit(EXIT_FAILURE);
     }
-
-    // Extract information
-    tempu = temp[0];
-    tempv = temp[2];
-    tempw = temp[4];
-    u = atoi(tempu.c_str());
-    v = atoi(tempv.c_str());
-    w = atoi(tempw.c_str());
-
-    if(verbose)
-      printf("(%i, %i) :%i \n", u, v, w);
 
     // Set information
-    adj[u][v] = w;
-    
-    // Reset varibles
-    u = v = w = 0;
-    temp.clear();
-    tempu.clear();
-    tempv.clear();
-    tempw.clear();
+    adj[edge[0]][edge[1]] = edge[2];
+  }
+  if (found < 0) {
+    printf("Invalid character in graph. Good bye!\n");
+    exit(EXIT_FAILURE);
   }
 
   return adj;
 }
-////////////////////////////////////////////////////////////////////////////////
-
 ////////////////////////////////////////////////////////////////////////////////
 // Creates and returns the transitive matrix of a graph, or Warshall's
 //   algorithm
@@ -391,12 +589,145 @@ vector< vector<int> > transWarshall(vector< vector<int> > adj, int size) {
 }
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting) {
+#ifdef __linux__
+  static const unsigned long long config[COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+  struct perf_event_attr attr;
+#endif
+
+  prof.phases.clear();
+  for (int k = 0; k < COUNTERS; ++k) {
+    prof.fd[k] = -1;
+#ifdef __linux__
+    if (!counting) { continue; }
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[k];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count the threads started later too
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    prof.fd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name) {
+  phase fresh;   // A phase not seen before
+  size_t i;
+
+  for (i = 0; i < prof.phases.size(); ++i) {
+    if (strcmp(prof.phases[i].name, name) == 0) { break; }
+  }
+  if (i == prof.phases.size()) {
+    fresh.name = name;
+    fresh.seconds = 0;
+    for (int k = 0; k < COUNTERS; ++k) {
+      fresh.count[k] = (prof.fd[k] < 0) ? -1 : 0;
+    }
+    prof.phases.push_back(fresh);
+  }
+  prof.current = i;
+
+  for (int k = 0; k < COUNTERS; ++k) { prof.base[k] = readCounter(prof.fd[k]); }
+  clock_gettime(CLOCK_MONOTONIC, &prof.start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof) {
+  struct timespec stop;
+  phase &done = prof.phases[prof.current];
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  done.seconds += (stop.tv_sec - prof.start.tv_sec) +
+    (stop.tv_nsec - prof.start.tv_nsec) / 1e9;
+  for (int k = 0; k < COUNTERS; ++k) {
+    if (prof.fd[k] >= 0) {
+      done.count[k] += readCounter(prof.fd[k]) - prof.base[k];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd) {
+  unsigned long long value[3]; // Count, time enabled and time running
+
+  if ((fd < 0) || (read(fd, value, sizeof(value)) != sizeof(value))) {
+    return 0;
+  }
+  if ((value[2] == 0) || (value[2] >= value[1])) { return value[0]; }
+  return (long long)((double)value[0] * value[1] / value[2]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json) {
+  if (json) {
+    fflush(stdout);
+    fprintf(stderr, "{\"tool\": \"floydWarshall\", \"phases\": [");
+    for (size_t i = 0; i < prof.phases.size(); ++i) {
+      fprintf(stderr, "%s{\"name\": \"%s\", \"seconds\": %.6f",
+	      i ? ", " : "", prof.phases[i].name, prof.phases[i].seconds);
+      for (int k = 0; k < COUNTERS; ++k) {
+	if (prof.phases[i].count[k] < 0) {
+	  fprintf(stderr, ", \"%s\": null", counterNames[k]);
+	}
+	else {
+	  fprintf(stderr, ", \"%s\": %lld", counterNames[k],
+		  prof.phases[i].count[k]);
+	}
+      }
+      fprintf(stderr, "}");
+    }
+    fprintf(stderr, "]}\n");
+    return;
+  }
+
+  printf("%-10s %12s", "Phase", "Seconds");
+  for (int k = 0; k < COUNTERS; ++k) { printf(" %14s", counterNames[k]); }
+  printf("\n");
+  for (size_t i = 0; i < prof.phases.size(); ++i) {
+    printf("%-10s %12.6f", prof.phases[i].name, prof.phases[i].seconds);
+    for (int k = 0; k < COUNTERS; ++k) {
+      if (prof.phases[i].count[k] < 0) { printf(" %14s", "n/a"); }
+      else { printf(" %14lld", prof.phases[i].count[k]); }
+    }
+    printf("\n");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // Prints out instructions on the use of command line options.
 void usage() {
   printf("Flags:\n"
 	 "\t-h\t\tPrints this message.\n"
-	 "\t-v\t\tPrint diagnostic info\n"
+	 "\t-j\t\tPrint the time and counters of each phase as JSON,\n"
+	 "\t\t\ton standard error\n"
+	 "\t-v\t\tPrint diagnostic info, with the time and counters of\n"
+	 "\t\t\teach phase\n"
 	 "<input_file_name> \tIf you would like to supply an input file name,\n"
 	 "\t\t\tyou may do so here, otherwise, the program will ask for it.\n\n");
 }
@@ -12,10 +12,28 @@
 //   the divide-and-conquor technique, the mergeSort() function
 //   first splits the list in two and passes each half into the mergeSort()
 //   function again. This continues until each half contains only one item.
+//   Rather than copying each half into new vectors, the halves are sorted back
+//   and forth between the list and a single scratch copy of it.
 //   
 //     From there, the merge() function takes over. This function compares the
 //   the two halves, and writes them to the original vector in the sorted order.
 //
+//     mergeSort() and merge() are templates over the type of key and the order
+//   it is sorted in, compiled for 32 and 64-bit ints, unsigned 64-bit ints,
+//   and records that carry a payload along with their key. Ints in ascending
+//   order keep the sorting network and the vector merges; other keys are
+//   merged a value at a time.
+//
+//     With -k the program merges files that are each sorted already. Each
+//   file is checked a window at a time and merged in place from its mapping;
+//   only windows out of order are sorted and spilled to a temporary file.
+//   When there are more runs than the memory budget can buffer, they are
+//   merged in groups over more than one pass. The merged list is cut into a
+//   slice for each thread at values sampled from the runs, and each thread
+//   merges its part of every run through a loser tree of its own, reading
+//   each through a buffer as the external sort does, into a temporary file
+//   that is copied to the output in turn.
+//
 // Invariant
 //------------------------------------------------------------------------------
 //     The input to this program is a file name of a list of integers,
@@ -40,41 +58,742 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
+#include <glob.h>
 #include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
-ifstream input;
 ofstream output;
+
+// Number of bytes validated ahead of the parser in scanList()
+#define SCAN_CHUNK 65536
+
+// Bottom-up merge sort: length of the runs formed by sortBlock(), and the
+//   number of ints (256 KB, about an L2 cache) merged in place before the
+//   passes over the whole list.
+#define RUN_SIZE NETWORK_SIZE
+#define CACHE_TILE 65536
+
+// Parallel merge sort: default number of ints below which a range is sorted
+//   by one thread.
+#define GRAIN 16384
+
+// External merge sort: fewest ints buffered for each run during the merge
+#define RUN_BUFFER 4096
+
+// Merge of sorted files: memory for the windows over the files, and then
+//   for the buffers of the merge, in MB, unless -e says otherwise; and the
+//   samples per slice taken to pick where the slices are cut
+#define SHARD_BUDGET 256
+#define SHARD_SAMPLES 64
+
+// Batch sort: memory held by all files at once, in MB, unless -e says
+//   otherwise; and the memory a file is taken to need, per byte of it
+#define BATCH_BUDGET 1024
+#define BATCH_FACTOR 5
+
+// Adaptive merge sort: wins in a row before a merge starts galloping, and
+//   the most a natural run is extended to by insertion sort.
+#define MIN_GALLOP 7
+#define MIN_MERGE 64
+
+// LSD radix sort: bits per digit, passes to cover 32 bits, and ints gathered
+//   per bucket (one 64-byte cache line) before they are written out together.
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES 3
+#define COMBINE 16
+
+// Sorting network: most ints sorted at once by sortNetwork()
+#define NETWORK_SIZE 32
+
+// Branchless merge: how far ahead of each run to prefetch, in ints
+#define PREFETCH_AHEAD 64
+
+// Buffered writer: bytes gathered before each write() of the sorted list
+#define WRITE_BUFFER (1 << 20)
+
+// Bytes read from a stream at a time, into each of two buffers
+#define STREAM_CHUNK (1 << 20)
+
+// Profile: hardware counters read around each phase, named in counterNames
+#define COUNTERS 4
+
+// Binary list format: magic number at the start of the header
+#define BINARY_MAGIC "SORT"
+
+// The binary list format is little-endian; swap on big-endian hosts
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define LITTLE32(x) __builtin_bswap32(x)
+#define LITTLE64(x) __builtin_bswap64(x)
+#else
+#define LITTLE32(x) (x)
+#define LITTLE64(x) (x)
+#endif
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Structs and Such
+// A piece of work for the thread pool. A sort task sorts from[lo, hi) into
+//   'into'; a merge task merges from[lo, hi) with from[top, end) into 'into',
+//   starting at 'out'.
+struct task {
+  void (*work)(task*, int); // What to do, given the worker running it
+  int *from, *into;         // Arrays to sort or merge between
+  int lo, hi;               // Range to sort, or the bottom run to merge
+  int top, end;             // The top run to merge
+  int out;                  // Where the merged piece begins
+  int finished;             // Set once the work is done
+};
+
+// A worker thread and the deque of tasks it has spawned. The owner takes
+//   from the back; idle workers steal from the front.
+struct worker {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  deque<task*> tasks;
+};
+
+// Header of the binary list format. The values follow as raw little-endian
+//   ints of the given width; at 16 bytes the header keeps them aligned, so a
+//   mapped file can be read in place.
+struct binaryHeader {
+  char magic[4];  // BINARY_MAGIC
+  uint32_t width; // Bytes per value: 4 (int32) or 8 (int64)
+  uint64_t count; // Number of values
+};
+
+// A key with a payload carried along with it, such as where it came from.
+typedef pair<int64_t, int64_t> record;
+
+// Orders records, or any pairs, by their keys alone.
+struct byKey {
+  template <class Pair>
+  bool operator()(const Pair& a, const Pair& b) const {
+    return a.first < b.first;
+  }
+};
+
+// Wall time and hardware counters of one phase of the program. A phase run
+//   more than once adds up.
+struct phase {
+  const char *name;          // As reported
+  double seconds;            // Wall time
+  long long count[COUNTERS]; // Counted events; -1 where unavailable
+};
+
+// Timing of a run: the counters, the phase under way and those seen so far.
+struct profile {
+  int fd[COUNTERS];          // From perf_event_open(), or -1
+  long long base[COUNTERS];  // Counts when the current phase started
+  struct timespec start;     // Time when it started
+  size_t current;            // Its place in 'phases'
+  vector<phase> phases;      // In the order first started
+};
+
+// Two buffers for reading a stream: a reader thread fills one while the
+//   other is parsed, and they trade places at each chunk.
+struct stream {
+  int fd;                 // Where the list comes from
+  char *buffer[2];        // STREAM_CHUNK bytes each
+  ssize_t fill[2];        // Bytes read into each; 0 at the end, < 0 on error
+  bool full[2];           // Filled and waiting to be parsed
+  pthread_mutex_t lock;   // Guards 'fill' and 'full'
+  pthread_cond_t changed; // Signalled as a buffer is filled or given back
+};
+
+// A buffered writer over a file descriptor, for writing the sorted list a
+//   megabyte at a time instead of a line at a time.
+struct writer {
+  int fd;       // Where the buffer goes
+  char *buffer; // WRITE_BUFFER bytes
+  size_t fill;  // Bytes waiting to be written
+  bool binary;  // Raw ints rather than lines of text
+};
+
+// A sorted run on a temporary file, spilled by externalSort() or by a merge
+//   of sorted files, or a sorted stretch of a file to be merged, read in
+//   place. It is read back through a large buffer during the k-way merge; a
+//   thread merging a slice reads its piece of the run the same way, through
+//   a buffer of its own.
+struct run {
+  FILE *file;         // Temporary file, removed once closed; or NULL
+  const char *data;   // Otherwise the mapped file to be merged
+  int shard;          // Which of the files to be merged that is
+  bool text;          // The file is text, rather than a binary list
+  vector<int> buffer; // Values read ahead from the file
+  size_t next, fill;  // Position in and amount read into the buffer
+  off_t at, stop;     // Next byte of the file to read, and one past the run;
+		      //   values rather than bytes of a binary list
+  size_t count;       // Values in the run, for a merge of sorted files
+  bool done;          // Set once every value has been merged
+};
+
+// A merge of sorted files: the files, the runs to merge from them, and the
+//   temporary file windows out of order and merged passes are spilled to.
+struct merger {
+  vector<string> names;  // The files, in order
+  vector<run> runs;      // Their runs, in the order of the files
+  FILE *spill;           // Runs that are not read in place
+  size_t length;         // Values in all of the files
+  vector<pair<const char *, size_t> > maps; // Files mapped for a pass
+};
+
+// One thread's part of a merge of sorted files, or one group of a pass: the
+//   piece of each run it merges, and the temporary file it goes to.
+struct slice {
+  pthread_t thread;
+  vector<run> pieces;    // One per run, in the order of the files
+  size_t each;           // Values buffered for each piece
+  size_t length;         // Values merged
+  bool binary;           // Raw ints rather than lines of text
+  bool spill;            // Native ints, a run on the spill file
+  FILE *out;             // The slice, as it goes in the output
+  int first, last;       // Its first and last values
+  bool failed;           // Set if it did not come out in order
+};
+
+// Shared by the threads of a batch sort: the files still to be sorted, the
+//   memory they may hold between them, and the totals for the summary.
+struct batch {
+  vector<string> names;   // Input files
+  size_t next;            // Next file to be handed out
+  size_t budget, held;    // Bytes the files may hold at once, and do hold
+  bool radix, adaptive;   // Choice of sort, as on the command line
+  bool iterative, binary;
+  long long values;       // Values sorted
+  long long bytes;        // Bytes read
+  int failed;             // Files that could not be sorted
+  pthread_mutex_t lock;   // Guards all of the above that changes
+  pthread_cond_t freed;   // Signalled as a file gives back its memory
+};
+
+// The thread pool, alive for the duration of parallelSort()
+worker *workers = NULL; // Worker 0 is the main thread
+int threads = 1;        // Number of workers
+int grain = GRAIN;      // Ranges at most this long are not split further
+int stopping = 0;       // Set once the sort is done
+
+// Merge with conditional moves instead of branches, chosen at run time so the
+//   two can be compared on the same data
+bool branchless = false;
+
+// Names of the hardware counters of a profile, as reported
+const char *counterNames[COUNTERS] = { "cycles", "instructions",
+				       "branch-misses", "llc-misses" };
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorting network building blocks, inline so the registers never leave.
+//
+// Puts the smaller of a and b in a and the larger in b, without a branch.
+inline void exchange(int& a, int& b) {
+  int low = min(a, b);
+  b = max(a, b);
+  a = low;
+}
+
+#if defined(__AVX2__)
+// Compare-exchanges each lane of v with the same lane of p, a permutation of
+//   v; the lanes set in 'take' keep the larger value.
+template <int take>
+inline __m256i exchange8(__m256i v, __m256i p) {
+  return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p),
+			    take);
+}
+
+// Lanes of v in the given order.
+inline __m256i lanes(__m256i v, int a, int b, int c, int d,
+		     int e, int f, int g, int h) {
+  return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(a, b, c, d,
+							  e, f, g, h));
+}
+
+// Sorts a bitonic register: compare-exchange at distances 4, 2 and 1.
+inline __m256i clean8(__m256i v) {
+  v = exchange8<0xF0>(v, lanes(v, 4, 5, 6, 7, 0, 1, 2, 3));
+  v = exchange8<0xCC>(v, lanes(v, 2, 3, 0, 1, 6, 7, 4, 5));
+  v = exchange8<0xAA>(v, lanes(v, 1, 0, 3, 2, 5, 4, 7, 6));
+  return v;
+}
+
+// Sorts the eight lanes of a register: pairs and quads are sorted up and
+//   down alternately, leaving one bitonic sequence to clean.
+inline __m256i sort8(__m256i v) {
+  v = exchange8<0x66>(v, lanes(v, 1, 0, 3, 2, 5, 4, 7, 6));
+  v = exchange8<0x3C>(v, lanes(v, 2, 3, 0, 1, 6, 7, 4, 5));
+  v = exchange8<0x5A>(v, lanes(v, 1, 0, 3, 2, 5, 4, 7, 6));
+  return clean8(v);
+}
+
+// Merges two sorted registers; a gets the smallest eight, b the largest.
+inline void merge16(__m256i& a, __m256i& b) {
+  __m256i back = lanes(b, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i low = _mm256_min_epi32(a, back);
+
+  b = clean8(_mm256_max_epi32(a, back));
+  a = clean8(low);
+}
+
+// Merges the sorted sixteen in a, b with the sorted sixteen in c, d.
+inline void merge32(__m256i& a, __m256i& b, __m256i& c, __m256i& d) {
+  __m256i backC = lanes(c, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i backD = lanes(d, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i low1 = _mm256_min_epi32(a, backD), high1 = _mm256_max_epi32(a, backD);
+  __m256i low2 = _mm256_min_epi32(b, backC), high2 = _mm256_max_epi32(b, backC);
+
+  // Each half is now bitonic; clean it at distance eight, then within
+  a = clean8(_mm256_min_epi32(low1, low2));
+  b = clean8(_mm256_max_epi32(low1, low2));
+  c = clean8(_mm256_min_epi32(high1, high2));
+  d = clean8(_mm256_max_epi32(high1, high2));
+}
+#endif
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Declarations
 //
-// Open file and import list into a vector.
+// Open file and import list into a vector, from text or the binary format.
 //   Pre:  The name of the file containing the list of numbers to be sorted.
 //   Post: A vector of the newly imported list of numbers.
 vector<int> importFile(string file_name);
 
-// Tests each number in vector, and checks each character is a digit.
-//   Pre:  A string to be checked.
-//   Post: Returns true if string is all digits; false otherwise.
-bool isValid(const string& expr);
+// Maps a file into memory for reading from front to back.
+//   Pre:  The name of the file to map.
+//   Post: Returns the contents of the file and stores its size in 'size', or
+//         returns NULL if the file is empty. Exits if it cannot be read.
+const char *mapFile(string file_name, size_t &size);
+
+// Reads a list from a stream, such as standard input. Chunks are read by a
+//   second thread into one buffer while the other is parsed; a binary list
+//   is known by its magic number and its values are taken raw.
+//   Pre:  A file descriptor open for reading.
+//   Post: A vector of the newly imported list of numbers.
+vector<int> readStream(int fd);
+
+// Body of the reader thread of readStream(); fills the buffers in turn.
+void* fillStream(void* arg);
+
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned.
+const char *parseDigits(const char *next, const char *end, unsigned int &value);
+
+// Scans a memory-mapped list of integers in place, without copying.
+//   Pre:  'next' and 'end' bound the contents of the file; 'list' has been
+//         reserved with enough room for the expected number of entries.
+//   Post: Each whitespace separated entry is appended to 'list'. Returns
+//         false if an entry contains anything other than digits.
+bool scanList(const char *next, const char *end, vector<int> &list);
+
+// Checks a block of the file a whole vector register at a time.
+//   Pre:  'next' and 'end' bound the block to be checked.
+//   Post: Returns true if the block holds only digits and whitespace.
+bool validBlock(const char *next, const char *end);
 
 // Sorts the vector master recursivly using the merge sort algorithm.
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void mergeSort(vector<Key>& master, Less before);
+
+// Sorts the range [lo, hi) of 'from' into 'into', trading places with the
+//   other array at each level of the recursion instead of allocating.
+//   Pre:  'from' and 'into' hold the same values over [lo, hi).
+//   Post: 'into' holds the range in order; 'from' is scratch.
+template <class Key, class Less>
+void sortRange(Key* from, Key* into, int lo, int hi, Less before);
+
+// Merges two sorted runs into one.
+//   Pre:  The runs src[lo, mid) (bot) and src[mid, hi) (top) are each sorted.
+//   Post: dst[lo, hi) holds the final sorted run containing the other two.
+template <class Key, class Less>
+void merge(const Key* src, int lo, int mid, int hi, Key* dst, Less before);
+
+// Merges two sorted arrays into one.
+//   Pre:  'bot' holds p sorted keys and 'top' holds q sorted keys.
+//   Post: dst[0, p + q) holds both in sorted order.
+template <class Key, class Less>
+void mergeRuns(const Key* bot, int p, const Key* top, int q, Key* dst,
+	       Less before);
+
+// Merges two sorted arrays of ints into one, eight at a time where AVX2
+//   allows, or without branches if so chosen.
+//   Pre:  'bot' holds p sorted ints and 'top' holds q sorted ints.
+//   Post: dst[0, p + q) holds both in sorted order.
+void mergeRuns(const int* bot, int p, const int* top, int q, int* dst,
+	       less<int> before);
+
+// Merges two sorted arrays into one, a value at a time.
+//   Pre:  'bot' holds p sorted keys and 'top' holds q sorted keys.
+//   Post: dst[0, p + q) holds both in sorted order, ties taken from 'bot'.
+template <class Key, class Less>
+void mergeScalar(const Key* bot, int p, const Key* top, int q, Key* dst,
+		 Less before);
+
+// Merges two sorted arrays into one without branching on the comparison,
+//   prefetching ahead in both runs.
+//   Pre:  'bot' holds p sorted ints and 'top' holds q sorted ints.
+//   Post: dst[0, p + q) holds both in sorted order, ties taken from 'bot'.
+void mergeBranchless(const int* bot, int p, const int* top, int q, int* dst);
+
+// Merges two sorted arrays of at least eight ints each with a bitonic merge
+//   network on AVX2 registers.
+//   Pre:  p >= 8 and q >= 8.
+//   Post: dst[0, p + q) holds both in sorted order.
+void mergeBitonic(const int* bot, int p, const int* top, int q, int* dst);
+
+// Sorts the vector master iteratively, merging runs from the bottom up. Short
+//   runs are formed by sortBlock(), then merged within cache sized tiles,
+//   and only then in passes over the whole list.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order.
+void bottomUpSort(vector<int>& master);
+
+// Sorts a block of at most NETWORK_SIZE keys in place, by insertion.
+//   Pre:  An array and the range [lo, hi) to be sorted.
+//   Post: list[lo, hi) is in order.
+template <class Key, class Less>
+void sortBlock(Key* list, int lo, int hi, Less before);
+
+// Sorts a block of at most NETWORK_SIZE ints in place: with the sorting
+//   network where AVX2 runs it in registers, otherwise by insertion, which
+//   beats the scalar network.
+//   Pre:  An array and the range [lo, hi) to be sorted.
+//   Post: list[lo, hi) is in ascending order.
+void sortBlock(int* list, int lo, int hi, less<int>);
+
+// Sorts a short range in place by insertion.
+//   Pre:  An array and the range [lo, hi) to be sorted.
+//   Post: list[lo, hi) is in order.
+template <class Key, class Less>
+void insertionSort(Key* list, int lo, int hi, Less before);
+
+// Merges each pair of neighboring runs of length 'width' within [lo, hi).
+//   Pre:  from[lo, hi) is made up of sorted runs of length 'width'.
+//   Post: into[lo, hi) is made up of sorted runs of length 2 * 'width'.
+void mergePass(const int* from, int* into, int lo, int hi, int width);
+
+// Sorts the vector master with a pool of threads. Each half is a task that an
+//   idle thread may steal, and the final merges are split between threads.
+//   Pre:  A vector of ints, the number of threads and the grain cutoff.
+//   Post: A vector of sorted ints in ascending order.
+void parallelSort(vector<int>& master, int count, int cutoff);
+
+// Finds how many of the first k merged values come from 'bot' (co-ranking).
+//   Pre:  'bot' holds p sorted ints, 'top' holds q sorted ints, k <= p + q.
+//   Post: Returns i such that bot[0, i) and top[0, k - i) are the first k
+//         values of a stable merge.
+int coRank(int k, const int* bot, int p, const int* top, int q);
+
+// Merges from[lo, mid) and from[mid, hi) into 'into', split between threads.
+//   Pre:  Both runs are sorted; 'self' is the worker calling.
+//   Post: into[lo, hi) holds the merged run.
+void parallelMerge(int* from, int* into, int lo, int mid, int hi, int self);
+
+// Task bodies for the pool: sort a range, or merge one piece of a merge.
+void sortTask(task* job, int self);
+void mergeTask(task* job, int self);
+
+// Pushes a task onto the worker's own deque.
+void spawn(task* job, int self);
+
+// Runs one task, from the worker's own deque or stolen from another.
+//   Post: Returns false if there was nothing to run.
+bool runOne(int self);
+
+// Runs other tasks until the given task is finished.
+void join(task* job, int self);
+
+// Body of each pool thread; runs tasks until the sort is done.
+void* workerLoop(void* arg);
+
+// Sorts a file that may be larger than memory. Chunks that fit the memory
+//   budget are sorted and spilled to temporary run files, which are then
+//   merged through a loser tree straight into the output file.
+//   Pre:  The name of the input file, the budget in megabytes, the threads to
+//         sort each chunk with, whether to write a binary list and whether
+//         to print diagnostic info.
+//   Post: The sorted list is written to output.txt, or output.bin.
+void externalSort(string file_name, int budget, int count, bool binary,
+		  bool verbose);
+
+// Sorts a chunk of an external sort and spills it to a temporary run file.
+//   Pre:  The chunk, the runs so far and the threads to sort with.
+//   Post: A run holding the sorted chunk is added to 'runs'.
+void spillRun(vector<int>& chunk, vector<run>& runs, int count);
+
+// Reads the next block of a run into its buffer.
+//   Post: Returns false, and marks the run done, once the run is exhausted.
+bool fillRun(run& source);
+
+// Orders two runs of a loser tree by their next value; exhausted runs lose,
+//   and ties go to the earlier run so the merge stays stable.
+bool runLess(vector<run>& runs, int a, int b);
+
+// Finds where a sorted run passes a value, by a binary search of its file.
+//   Post: Returns the position of the first value of the run greater than
+//         'value', or the end of the run.
+off_t runBound(const run& source, int value);
+
+// Reads the value of a run at a position. In text the position is moved on
+//   to the start of the next value, if it is not at one.
+//   Post: Returns false if no value is left in the run from there.
+bool runValue(const run& source, off_t& at, int& value);
+
+// Finds the start of the first value of text at or after a position.
+//   Post: Returns its position, or 'stop' if there is none before it.
+off_t textStart(const char *data, off_t at, off_t stop);
+
+// Plays the matches of the subtree rooted at 'node' to set up a loser tree,
+//   over runs of the external sort or pieces of sorted files.
+//   Pre:  Leaves are the nodes k through 2k - 1, for run node - k.
+//   Post: The losers are stored in 'tree'; returns the winning run.
+template <class Source>
+int playTree(vector<Source>& runs, vector<int>& tree, int node);
+
+// Reads the files to be merged: those named in a manifest, one per line, or
+//   matching a wildcard pattern. Each is checked a window of a quarter of the
+//   budget at a time, as externalSort() reads its chunks. Sorted windows are
+//   left in the file, to be merged from it in place; a window out of order
+//   is sorted and spilled as a run of its own to the spill file.
+//   Pre:  The manifest or pattern, the budget in MB and whether to print
+//         diagnostic info.
+//   Post: The files and their runs, in order, and the number of values are
+//         stored in 'job'. Exits if no files are found.
+void readShards(string source, merger& job, int budget, bool verbose);
+
+// Adds a window of a file to be merged to its runs. A sorted window that
+//   carries on the file's last run in place extends it, and any other sorted
+//   window begins a run in place; a window out of order is sorted and
+//   spilled.
+//   Pre:  The window's values, the file it is from and whether as text, and
+//         where it lies in the file: bytes of text, or values of a binary
+//         list. 'open' is set if the file's last run is read in place and
+//         'last' is its last value.
+//   Post: Returns false if the window had to be sorted.
+bool addShard(vector<int>& chunk, merger& job, int file, bool text,
+	      off_t first, off_t stop, bool& open, int& last);
+
+// Appends values to a temporary run file and empties the block.
+//   Post: Exits if the write fails.
+void spillValues(vector<int>& block, FILE *file);
+
+// Maps the files that runs of a merge are read from in place, each once for
+//   the runs of it that lie together.
+//   Post: The runs point into the mappings, which are kept in 'job' until
+//         unmapShards().
+void mapShards(merger& job, vector<run>& runs);
+
+// Undoes the mappings of mapShards().
+void unmapShards(merger& job);
+
+// Merges the runs of sorted files into output.txt, or output.bin. No more
+//   runs are merged at once than the budget gives RUN_BUFFER ints each, or
+//   than half the files that may be open at once; while there are more,
+//   passShards() merges them in groups onto the spill file. The merged list
+//   is then cut into a slice per thread at the values splitShards() picks,
+//   and each thread merges its piece of every run through a loser tree and
+//   buffers of its own into a temporary file. The slices are copied to the
+//   output in order.
+//   Pre:  The runs, the name of the merge for the header, the budget in MB
+//         for the buffers, the threads, whether to write a binary list and
+//         whether to print diagnostic info.
+//   Post: The merged list is written out and the spill file is closed.
+void mergeShards(merger& job, string file_name, int budget, int count,
+		 bool binary, bool verbose);
+
+// Merges the runs of sorted files in groups of 'fanIn', each group through
+//   a loser tree into one run on the spill file, so the next pass has fewer
+//   runs to merge.
+//   Pre:  More than 'fanIn' runs, and the ints to buffer for each.
+//   Post: Each group is replaced by its merged run, in the same order.
+void passShards(merger& job, size_t fanIn, size_t each);
+
+// Picks the values the merged list is cut after between slices, from
+//   samples spread over every run in proportion to its length. Equal values
+//   all fall in one slice, so the loser trees still take them from earlier
+//   runs first.
+//   Pre:  The runs, mapped, the values in all of them and the slices.
+//   Post: 'splitters' holds slices - 1 values in ascending order.
+void splitShards(vector<run>& runs, size_t length, int slices,
+		 vector<int>& splitters);
+
+// Body of each thread of mergeShards(), and of each group of passShards();
+//   merges one slice into its file.
+void* mergeSlice(void* arg);
+
+// Sorts many files at once, each on a thread of its own, into a file named
+//   after it with ".sorted" added. Files wait for memory while those being
+//   sorted would need more than the budget between them.
+//   Pre:  The files and choice of sort, the threads and the budget in MB.
+//   Post: Each file is sorted and a summary of the throughput is printed.
+void batchSort(batch& job, int count, int budget);
+
+// Lists the files of a batch: the names in a manifest, one per line, or
+//   the matches of a wildcard pattern.
+//   Post: The names are added to 'names'. Exits if none are found.
+void listBatch(string source, vector<string>& names);
+
+// Body of each batch thread; sorts files until none are left.
+void* batchLoop(void* arg);
+
+// Sorts one file of a batch, reporting rather than exiting on bad input.
+//   Pre:  The batch and the name of the file.
+//   Post: Returns false if the file could not be sorted; 'length' holds the
+//         number of values sorted.
+bool sortFile(batch& job, const string& name, size_t& length);
+
+// Sorts the vector master by merging the runs already in it, in the manner of
+//   TimSort. Ascending and descending runs are found and kept on a stack
+//   whose lengths shrink faster than the Fibonacci numbers, so sorted input
+//   takes one pass.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order; returns the number of
+//         natural runs found.
+int adaptiveSort(vector<int>& master);
+
+// Finds the length of the natural run starting at lo: ascending, or strictly
+//   descending.
+//   Pre:  lo < hi.
+//   Post: Returns the length; the list is unchanged.
+int countRun(const int* list, int lo, int hi);
+
+// Merges list[lo, mid) and list[mid, hi) in place, galloping through either
+//   run once it keeps winning.
+//   Pre:  Both runs are sorted; 'scratch' holds at least mid - lo ints.
+//   Post: list[lo, hi) is sorted.
+void gallopMerge(int* list, int lo, int mid, int hi, int* scratch);
+
+// Number of values in base[0, n) strictly less than 'key' (gallopLeft) or
+//   less than or equal to it (gallopRight), by exponential then binary search.
+int gallopLeft(int key, const int* base, int n);
+int gallopRight(int key, const int* base, int n);
+
+// Computes the shortest run worth merging for a list of n values.
+int minRun(int n);
+
+// Sorts a block of at most NETWORK_SIZE ints with a bitonic sorting network.
+//   With AVX2 the block is sorted in four registers of eight ints each;
+//   otherwise the same network is run with branchless compare-exchanges.
+//   Pre:  list[0, n) with n <= NETWORK_SIZE.
+//   Post: list[0, n) is in ascending order.
+void sortNetwork(int* list, int n);
+
+// Sorts the vector master by least significant digit radix sort, with
+//   11-bit digits. One read pass counts every digit; each scatter pass goes
+//   through cache-line buffers so writes to the buckets are combined.
 //   Pre:  A vector of ints.
 //   Post: A vector of sorted ints in ascending order.
-void mergeSort(vector<int>& master);
+void radixSort(vector<int>& master);
+
+// Tests for the binary list format by its magic number.
+bool isBinary(const char *data, size_t size);
+
+// Checks the header of a binary list against the size of the file, without
+//   exiting.
+//   Post: Returns NULL with the number of values in 'count', or what is wrong
+//         with the file if the width is unknown or the file is truncated.
+const char *checkBinary(const char *data, size_t size, size_t &count);
+
+// Checks the header of a binary list against the size of the file.
+//   Post: Returns the number of values. Exits if the width is unknown or the
+//         file is truncated.
+size_t binaryCount(const char *data, size_t size);
+
+// Copies values from a binary list into a vector, without exiting.
+//   Pre:  'data' holds a binary list checked by checkBinary().
+//   Post: Values [first, first + count) are appended to 'list'; returns
+//         false if a 64-bit value does not fit in an int.
+bool copyBinary(const char *data, size_t first, size_t count,
+		vector<int> &list);
+
+// Copies raw little-endian values, 4 or 8 bytes wide, into a vector, without
+//   exiting.
+//   Post: 'count' values are appended to 'list'; returns false if a 64-bit
+//         value does not fit in an int.
+bool copyValues(const char *values, size_t count, uint32_t width,
+		vector<int> &list);
+
+// Copies values from a binary list into a vector.
+//   Pre:  'data' holds a binary list checked by binaryCount().
+//   Post: Values [first, first + count) are appended to 'list'. Exits if a
+//         64-bit value does not fit in an int.
+void readBinary(const char *data, size_t first, size_t count,
+		vector<int> &list);
+
+// Creates output.bin for a binary list.
+//   Post: Returns the file descriptor. Exits if it cannot be opened.
+int createBinary();
+
+// Starts a binary list of 'count' values on a buffered writer: the header is
+//   written, and the values after it go out as raw ints.
+void writeHeader(writer& out, size_t count);
+
+// Flushes 'output' and opens output.txt again to append the list after it.
+//   Post: Returns the new file descriptor. Exits if it cannot be opened.
+int appendOutput();
+
+// Starts a buffered writer of text on a file descriptor.
+void openWriter(writer& out, int fd);
+
+// Adds an int to a buffered writer: as text on a line of its own, or as a raw
+//   little-endian int for a binary list.
+void writeInt(writer& out, int value);
+
+// Writes out whatever a buffered writer holds. Exits if the write fails.
+void flushWriter(writer& out);
+
+// Flushes a buffered writer and frees its buffer; the descriptor stays open.
+void closeWriter(writer& out);
+
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting);
+
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name);
 
-// Merges two sorted vectors into one.
-//   Pre:  Two vectors (bot and top) each sorted.
-//   Post: The final sorted vector (master) containing the other two vectors.
-void merge(vector<int>& master, vector<int>& bot, vector<int>& top);
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof);
+
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd);
+
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json);
 
 // Prints out instructions on the use of command line options.
 void usage();
@@ -82,20 +801,76 @@ void usage();
 
 ////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char **argv) {
-  char c;               // Used for line parsing
-  bool verbose = false; // For Diagnostic information.
-  string file_name;     // Input file name
-  int length = 0;       // Initialize length of list
-  vector<int> master;   // Vector to store input
+  char c;                 // Used for line parsing
+  bool verbose = false;   // For Diagnostic information.
+  bool adaptive = false;  // Natural merge sort
+  bool binary = false;    // Binary output
+  bool stream = false;    // Standard input to standard output
+  bool json = false;      // Profile as JSON
+  bool radix = false;     // Radix sort instead
+  bool iterative = false; // Bottom-up merge sort
+  int count = 0;          // Threads for the parallel or batch sort
+  int cutoff = GRAIN;     // Grain of the parallel sort
+  int budget = 0;         // Memory budget for an external or batch sort, MB
+  string manifest;        // Files to sort in a batch
+  string sources;         // Sorted files to merge
+  merger kway;            // Their merge
+  batch job;              // The batch sort
+  profile prof;           // Time and counters of each phase
+  string file_name;       // Input file name
+  int length = 0;         // Initialize length of list
+  int runs = 0;           // Natural runs found by the adaptive sort
+  vector<int> master;     // Vector to store input
+  writer list, echo;      // Buffered output of the list, and its verbose echo
+  int sorted = STDOUT_FILENO; // Standard output, when streaming
 
   printf("Welcome to Global Dynamics, Software Divison!\n");
 
   // Parse the line
-  while ((c = getopt(argc, argv, "hv")) != EOF) {
+  while ((c = getopt(argc, argv, "Babe:g:hijk:m:p:rsv")) != EOF) {
     switch (c) {
+    case 'B': // Binary output.
+      binary = true;
+      break;
+    case 'a': // Adaptive, natural merge sort.
+      adaptive = true;
+      break;
+    case 'b': // Branchless merge.
+      branchless = true;
+      break;
+    case 'e': // External sort within a memory budget.
+      budget = atoi(optarg);
+      if (budget < 1) { budget = 1; }
+      break;
+    case 'g': // Grain of the parallel sort.
+      cutoff = atoi(optarg);
+      if (cutoff < 1) { cutoff = 1; }
+      break;
     case 'h': // Help message on command line options.
       usage();
       break;
+    case 'i': // Iterative, bottom-up merge sort.
+      iterative = true;
+      break;
+    case 'j': // Profile as JSON.
+      json = true;
+      break;
+    case 'k': // Merge of sorted files, from a manifest or a pattern.
+      sources = optarg;
+      break;
+    case 'm': // Batch of files, from a manifest or a pattern.
+      manifest = optarg;
+      break;
+    case 'p': // Parallel merge sort.
+      count = atoi(optarg);
+      if (count < 1) { count = 1; }
+      break;
+    case 'r': // Radix sort.
+      radix = true;
+      break;
+    case 's': // Stream from standard input to standard output.
+      stream = true;
+      break;
     case 'v': // Print Diagnostic information.
       verbose = true;
       break;
@@ -104,8 +879,53 @@ int main(int argc, char **argv) {
     }
   }
   if (verbose) { printf("Verbose turned on.\n"); }
+  openProfile(prof, verbose || json);
+
+  // A batch sorts each of its files straight to its own output
+  if (!manifest.empty()) {
+    listBatch(manifest, job.names);
+    job.radix = radix;
+    job.adaptive = adaptive;
+    job.iterative = iterative;
+    job.binary = binary;
+    if (count == 0) { count = sysconf(_SC_NPROCESSORS_ONLN); }
+    startPhase(prof, "batch");
+    batchSort(job, count, budget);
+    endPhase(prof);
+    if (verbose) { reportProfile(prof, false); }
+    if (json) { reportProfile(prof, true); }
+    printf("Good Bye!\n");
+    return (job.failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
 
-  if (optind == argc) { // No command line arguments
+  if (!sources.empty() && stream) {
+    printf("A merge of sorted files reads files, not a stream.\n"
+	   "Good Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The parallel sort is neither adaptive nor bottom-up, so rather than one
+  //   flag quietly winning, the choice is left to the user
+  if ((count > 1) && (adaptive || iterative) && sources.empty() &&
+      (budget == 0)) {
+    printf("-p cannot be used with -a or -i.\n");
+    usage();
+    printf("Good Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Only the sorted list goes to standard output when streaming; messages,
+  //   even those still buffered, are sent to standard error instead
+  if (stream) {
+    sorted = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    file_name = "(standard input)";
+  }
+  else if (!sources.empty()) { // Files to merge, on all processors unless -p
+    file_name = sources;
+    if (count == 0) { count = sysconf(_SC_NPROCESSORS_ONLN); }
+  }
+  else if (optind == argc) { // No command line arguments
     printf("Please enter the name of the input file: ");
     getline(cin, file_name);
   }
@@ -113,14 +933,50 @@ int main(int argc, char **argv) {
     file_name = argv[optind];
   }
 
-  // Imput file into a vector
-  master = importFile(file_name);
+  // Sorted files are merged in place, straight to the output
+  if (!sources.empty()) {
+    if (budget == 0) { budget = SHARD_BUDGET; }
+    startPhase(prof, "ingest");
+    readShards(sources, kway, budget, verbose);
+    endPhase(prof);
+    startPhase(prof, "merge");
+    mergeShards(kway, file_name, budget, count, binary, verbose);
+    endPhase(prof);
+    if (verbose) { reportProfile(prof, false); }
+    if (json) { reportProfile(prof, true); }
+    printf("Good Bye!\n");
+    return EXIT_SUCCESS;
+  }
 
-  output.open("output.txt");
-  if (output.fail()) {
-    printf("Output file opening failed.\nGood Bye!\n");
-    exit(EXIT_FAILURE);
+  // Files larger than memory are sorted externally, straight to the output
+  if (budget > 0) {
+    if (stream) {
+      printf("An external sort needs an input file.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    startPhase(prof, "external");
+    externalSort(file_name, budget, count, binary, verbose);
+    endPhase(prof);
+    if (verbose) { reportProfile(prof, false); }
+    if (json) { reportProfile(prof, true); }
+    printf("Good Bye!\n");
+    return EXIT_SUCCESS;
+  }
+
+  // Imput file into a vector. A stream leaves 'output' closed, so the header
+  //   lines written to it are dropped.
+  startPhase(prof, "ingest");
+  if (stream) { master = readStream(STDIN_FILENO); }
+  else {
+    master = importFile(file_name);
+
+    output.open("output.txt");
+    if (output.fail()) {
+      printf("Output file opening failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
   }
+  endPhase(prof);
  
   // Output file name
   if (verbose) { cout << "File Name:\t" << file_name << "\n"; }
@@ -132,24 +988,52 @@ int main(int argc, char **argv) {
   output << "Length:\t\t" << length << "\n";
 
   // Merge sort list
-  mergeSort(master);
-
-  // Output sorted list
-  for (int i = 0; i < length; ++i) {
-    if (verbose) { printf("%i\n", master[i]); }
-    output << master[i] << endl;
+  startPhase(prof, "sort");
+  if (radix) { radixSort(master); }
+  else if (count > 1) { parallelSort(master, count, cutoff); }
+  else if (adaptive) {
+    runs = adaptiveSort(master);
+    if (verbose) { printf("Runs:\t\t%i\n", runs); }
+    output << "Runs:\t\t" << runs << "\n";
+  }
+  else if (iterative) { bottomUpSort(master); }
+  else { mergeSort(master, less<int>()); }
+  endPhase(prof);
 
-    // Test if list is actually sorted
-    if(i != (length - 1)) {
-      if(master[i] > master[i + 1]) {
-	printf("Sorting algorithm failed!\n");
-	break;
-      }
+  // Test if list is actually sorted
+  startPhase(prof, "verify");
+  for (int i = 0; i < (length - 1); ++i) {
+    if (master[i] > master[i + 1]) {
+      printf("Sorting algorithm failed!\n");
+      break;
     }
   }
+  endPhase(prof);
+
+  // Output sorted list, through large buffers rather than a line at a time
+  startPhase(prof, "output");
+  if (stream) { openWriter(list, sorted); }
+  else if (binary) { openWriter(list, createBinary()); }
+  else { openWriter(list, appendOutput()); }
+  if (binary) { writeHeader(list, length); }
+  if (verbose) {
+    fflush(stdout);
+    openWriter(echo, STDOUT_FILENO);
+  }
+  for (int i = 0; i < length; ++i) {
+    if (verbose) { writeInt(echo, master[i]); }
+    writeInt(list, master[i]);
+  }
 
   // Close file
+  if (verbose) { closeWriter(echo); }
+  closeWriter(list);
+  close(list.fd);
   output.close();
+  endPhase(prof);
+
+  if (verbose) { reportProfile(prof, false); }
+  if (json) { reportProfile(prof, true); }
   printf("Good Bye!\n");
   return EXIT_SUCCESS;
 }
@@ -158,107 +1042,2635 @@ int main(int argc, char **argv) {
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 //
-// Open file and import list into a vector.
+// Open file and import list into a vector, from text or the binary format.
 //   Pre:  The name of the file containing the list of numbers to be sorted.
 //   Post: A vector of the newly imported list of numbers.
 vector<int> importFile(string file_name) {
   vector<int> newList;
-  string number;
+  const char *data;   // Mapped contents of the file
+  const char *next;   // For counting lines
+  const char *end;    // One past the last character of the file
+  size_t size;        // Size of the file
+  size_t lines = 0;   // Estimate of the number of entries
 
   // Establish connection to input file
-  input.open(file_name.c_str());
-  if (input.fail()) {
-    printf("Unable to open \"%s\".\nGood Bye!\n", file_name.c_str());
-    exit(EXIT_FAILURE);
-  }
+  data = mapFile(file_name, size);
   output << file_name << "\n";
 
+  // Nothing to read in an empty file
+  if (data == NULL) { return newList; }
+  end = data + size;
+
+  // A binary list is copied straight across
+  if (isBinary(data, size)) {
+    readBinary(data, 0, binaryCount(data, size), newList);
+    munmap((void *)data, size);
+    return newList;
+  }
+
+  // Pre-size the vector from a quick count of the lines
+  next = data;
+  while ((next = (const char *)memchr(next, '\n', end - next)) != NULL) {
+    ++lines;
+    ++next;
+  }
+  newList.reserve(lines + 1);
+
   // Import numbers into a vector
-  while (input.good()) {
-    input >> number;
-    
-    if (!isValid(number)) { 
-      printf("File contains invalid characters.\n"
-	      "Good Bye!\n");
-      exit(EXIT_FAILURE);
-    }
-    newList.push_back(atoi(number.c_str()));
+  if (!scanList(data, end, newList)) {
+    printf("File contains invalid characters.\n"
+	   "Good Bye!\n");
+    exit(EXIT_FAILURE);
   }
-  input.close();
+  munmap((void *)data, size);
 
   return newList;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Tests each number in vector, and checks each character is a digit.
-//   Pre:  A string to be checked.
-//   Post: Returns true if string is all digits; false otherwise.
-bool isValid(const string& expr) {
-  char next;
-  bool failed = false;
+// Maps a file into memory for reading from front to back.
+//   Pre:  The name of the file to map.
+//   Post: Returns the contents of the file and stores its size in 'size', or
+//         returns NULL if the file is empty. Exits if it cannot be read.
+const char *mapFile(string file_name, size_t &size) {
+  struct stat info; // For the size of the file
+  void *data;
+  int fd;
+
+  fd = open(file_name.c_str(), O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &info) < 0)) {
+    printf("Unable to open \"%s\".\nGood Bye!\n", file_name.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  size = info.st_size;
+  if (size == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  // The mapping outlives the descriptor
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    printf("Unable to read \"%s\".\nGood Bye!\n", file_name.c_str());
+    exit(EXIT_FAILURE);
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  return (const char *)data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads a list from a stream, such as standard input. Chunks are read by a
+//   second thread into one buffer while the other is parsed; a binary list
+//   is known by its magic number and its values are taken raw.
+//   Pre:  A file descriptor open for reading.
+//   Post: A vector of the newly imported list of numbers.
+vector<int> readStream(int fd) {
+  stream input;        // The double buffer shared with the reader
+  pthread_t reader;    // Thread filling the buffers
+  vector<int> newList; // Vector to store input
+  vector<char> carry;  // A number split between two chunks
+  const char *data;    // Chunk being parsed
+  const char *end;     // One past its last byte
+  const char *first;   // End of the number carried into it
+  const char *last;    // Start of the number carried out of it
+  ssize_t size = 0;    // Bytes in the chunk
+  bool started = false; // The first chunk has been seen
+  bool binary = false; // The stream is a binary list
+  binaryHeader header; // Its header
+  uint32_t width = 0;  // Bytes per value of it
+  size_t take;         // Bytes that finish a value carried over
+  bool fits = true;    // Every 64-bit value fit in an int
+
+  input.fd = fd;
+  for (int side = 0; side < 2; ++side) {
+    input.buffer[side] = new char[STREAM_CHUNK];
+    input.full[side] = false;
+  }
+  pthread_mutex_init(&input.lock, NULL);
+  pthread_cond_init(&input.changed, NULL);
+  pthread_create(&reader, NULL, fillStream, &input);
+
+  for (int side = 0; ; side ^= 1) {
+    // Wait for the reader to fill this side
+    pthread_mutex_lock(&input.lock);
+    while (!input.full[side]) {
+      pthread_cond_wait(&input.changed, &input.lock);
+    }
+    size = input.fill[side];
+    pthread_mutex_unlock(&input.lock);
+    if (size <= 0) { break; }
 
-  for (unsigned int i = 0; !failed && (i < expr.length()); ++i) {
-    next = expr[i];
-    if (!(isdigit(next))) { failed = true; }
+    data = input.buffer[side];
+    end = data + size;
+
+    // A binary list is known by the magic number at the start of the stream,
+    //   as it is at the start of a file
+    if (!started) {
+      started = true;
+      if (isBinary(data, size)) {
+	memcpy(&header, data, sizeof(header));
+	width = LITTLE32(header.width);
+	if ((width != 4) && (width != 8)) {
+	  printf("Binary file has values of unknown width.\nGood Bye!\n");
+	  exit(EXIT_FAILURE);
+	}
+	binary = true;
+	data += sizeof(header);
+      }
+    }
+
+    // Finish the value carried over, then take the whole values as they are
+    if (binary) {
+      if (!carry.empty()) {
+	take = min((size_t)(end - data), width - carry.size());
+	carry.insert(carry.end(), data, data + take);
+	data += take;
+	if (carry.size() == width) {
+	  fits &= copyValues(&carry[0], 1, width, newList);
+	  carry.clear();
+	}
+      }
+      fits &= copyValues(data, (end - data) / width, width, newList);
+      carry.insert(carry.end(), data + (end - data) / width * width, end);
+    }
+
+    // Finish the number carried over, then parse up to the last whitespace
+    else {
+      for (first = data; (first < end) && !isspace((unsigned char)*first);
+	   ++first);
+      carry.insert(carry.end(), data, first);
+      if (first < end) {
+	for (last = end; !isspace((unsigned char)last[-1]); --last);
+	if ((!carry.empty() &&
+	     !scanList(&carry[0], &carry[0] + carry.size(), newList)) ||
+	    !scanList(first, last, newList)) {
+	  printf("File contains invalid characters.\nGood Bye!\n");
+	  exit(EXIT_FAILURE);
+	}
+	carry.assign(last, end);
+      }
+    }
+
+    // Hand the buffer back to the reader
+    pthread_mutex_lock(&input.lock);
+    input.full[side] = false;
+    pthread_cond_broadcast(&input.changed);
+    pthread_mutex_unlock(&input.lock);
+  }
+  pthread_join(reader, NULL);
+
+  if (size < 0) {
+    printf("Standard input could not be read.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  if (binary) {
+    if (!fits) {
+      printf("Binary file holds a value too large for an int.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    // Bytes past the values the header counts are left, as in a file
+    if (newList.size() < LITTLE64(header.count)) {
+      printf("Binary file is truncated.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    newList.resize(LITTLE64(header.count));
+  }
+  else if (!carry.empty() &&
+	   !scanList(&carry[0], &carry[0] + carry.size(), newList)) {
+    printf("File contains invalid characters.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
   }
-  return !failed;
+
+  pthread_cond_destroy(&input.changed);
+  pthread_mutex_destroy(&input.lock);
+  delete [] input.buffer[0];
+  delete [] input.buffer[1];
+  return newList;
 }
+
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Sorts the vector master recursivly using the merge sort algorithm.
-//   Pre:  A vector of ints.
-//   Post: A vector of sorted ints in ascending order.
-void mergeSort(vector<int>& master) {
-  int i;
-  int n = master.size();
-  vector<int> top; // First (top) half
-  vector<int> bot; // Last (bottom) half
-  
-  if (n > 1) {
-    // Split list in two parts
-    for (i = 0; i < (n/2); ++i) { bot.push_back(master[i]); }
-    for (; i < n; ++i) { top.push_back(master[i]); } 
-    
-    // Recursivly split list
-    mergeSort(bot);
-    mergeSort(top);
-    
-    // Join the split lists
-    merge(master, bot, top);
+// Body of the reader thread of readStream(); fills the buffers in turn.
+void* fillStream(void* arg) {
+  stream *input = (stream *)arg;
+  ssize_t size;       // Bytes read into the buffer so far
+  ssize_t got;        // Bytes from the last read
+
+  // Worth a try: a redirected file is read ahead by the kernel
+  posix_fadvise(input->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  for (int side = 0; ; side ^= 1) {
+    pthread_mutex_lock(&input->lock);
+    while (input->full[side]) {
+      pthread_cond_wait(&input->changed, &input->lock);
+    }
+    pthread_mutex_unlock(&input->lock);
+
+    // Fill the whole chunk, so the buffers trade places less often
+    for (size = 0; size < STREAM_CHUNK; size += got) {
+      got = read(input->fd, input->buffer[side] + size, STREAM_CHUNK - size);
+      if ((got < 0) && (errno == EINTR)) { got = 0; continue; }
+      if (got <= 0) { break; }
+    }
+    if (got < 0) { size = -1; }
+
+    pthread_mutex_lock(&input->lock);
+    input->fill[side] = size;
+    input->full[side] = true;
+    pthread_cond_broadcast(&input->changed);
+    pthread_mutex_unlock(&input->lock);
+    if (size <= 0) { break; }
   }
+  return NULL;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Merges two sorted vectors into one.
-//   Pre:  Two vectors (bot and top) each sorted.
-//   Post: The final sorted vector (master) containing the other two vectors.
-void merge(vector<int>& master, vector<int>& bot, vector<int>& top) {
-  int i, j, k, p, q;
-  i = j = k = 0;
-  p = bot.size();
-  q = top.size();
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned.
+const char *parseDigits(const char *next, const char *end, unsigned int &value) {
+  static const unsigned int scale[9] = { 1, 10, 100, 1000, 10000, 100000,
+					  1000000, 10000000, 100000000 };
+  uint64_t chunk, stop; // Eight characters and the non-digits among them
+  int digits;           // Leading digits in the chunk
 
-  while ((i < p) && (j < q)) {
-    // Sort list
-    if (bot[i] <= top[j]) { master[k++] = bot[i++]; }
-    else { master[k++] = top[j++]; }
+  value = 0;
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while ((end - next) >= 8) {
+    memcpy(&chunk, next, 8);
+    chunk ^= 0x3030303030303030ULL; // '0' through '9' become 0 through 9
+
+    // High bit of a byte is set wherever it is not a digit
+    stop = (((chunk & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | chunk)
+      & 0x8080808080808080ULL;
+    digits = stop ? (__builtin_ctzll(stop) >> 3) : 8;
+    if (digits == 0) { return next; }
+
+    // Shift out the rest so the digits are led by zeros, then combine pairs
+    chunk <<= 8 * (8 - digits);
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+    value = value * scale[digits] + (unsigned int)chunk;
+    next += digits;
+    if (digits < 8) { return next; }
   }
+#endif
 
-  // Finish the lists
-  if (i == p) { for (; j < q; ++j) { master[k++] = top[j]; } }
-  else { for (; i < p; ++i) { master[k++] = bot[i]; } }
+  // Tail of the file, one character at a time
+  for (; (next < end) && isdigit((unsigned char)*next); ++next) {
+    value = value * 10 + (*next - '0');
+  }
+  return next;
 }
+
+// Scans a memory-mapped list of integers in place, without copying.
+//   Pre:  'next' and 'end' bound the contents of the file; 'list' has been
+//         reserved with enough room for the expected number of entries.
+//   Post: Each whitespace separated entry is appended to 'list'. Returns
+//         false if an entry contains anything other than digits.
+bool scanList(const char *next, const char *end, vector<int> &list) {
+  const char *checked = next; // Validated up to here
+  const char *limit;          // End of the next chunk to validate
+  unsigned int value;         // Unsigned, so overflow wraps like atoi()
+
+  while (next < end) {
+    // Keep validation a chunk ahead of the parser
+    if (next >= checked) {
+      limit = ((end - checked) > SCAN_CHUNK) ? (checked + SCAN_CHUNK) : end;
+      if (!validBlock(checked, limit)) { return false; }
+      checked = limit;
+    }
+
+    // Skip the whitespace between entries
+    if (!isdigit((unsigned char)*next)) { ++next; continue; }
+
+    next = parseDigits(next, end, value);
+    list.push_back((int)value);
+  }
+  return (checked >= end) || validBlock(checked, end);
+}
+
+// Checks a block of the file a whole vector register at a time.
+//   Pre:  'next' and 'end' bound the block to be checked.
+//   Post: Returns true if the block holds only digits and whitespace.
+bool validBlock(const char *next, const char *end) {
+  // Digits are '0' plus 0 through 9; whitespace is ' ' or '\t' plus 0 
+  // through 4. Subtracting the base and taking the unsigned minimum with the
+  // span leaves matching bytes unchanged.
+#if defined(__AVX2__)
+  __m256i wide, digit, space;
+
+  for (; (end - next) >= 32; next += 32) {
+    wide = _mm256_loadu_si256((const __m256i *)next);
+    digit = _mm256_sub_epi8(wide, _mm256_set1_epi8('0'));
+    digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)),
+			      digit);
+    space = _mm256_sub_epi8(wide, _mm256_set1_epi8('\t'));
+    space = _mm256_cmpeq_epi8(_mm256_min_epu8(space, _mm256_set1_epi8(4)),
+			      space);
+    space = _mm256_or_si256(space,
+			    _mm256_cmpeq_epi8(wide, _mm256_set1_epi8(' ')));
+    if (_mm256_movemask_epi8(_mm256_or_si256(digit, space)) != -1) {
+      return false;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i block, digits, spaces;
+
+  for (; (end - next) >= 16; next += 16) {
+    block = _mm_loadu_si128((const __m128i *)next);
+    digits = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+    digits = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    spaces = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    spaces = _mm_cmpeq_epi8(_mm_min_epu8(spaces, _mm_set1_epi8(4)), spaces);
+    spaces = _mm_or_si128(spaces, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+    if (_mm_movemask_epi8(_mm_or_si128(digits, spaces)) != 0xFFFF) {
+      return false;
+    }
+  }
+#endif
+
+  // Whatever is left, or everything without vector support
+  for (; next < end; ++next) {
+    if (!isdigit((unsigned char)*next) && !isspace((unsigned char)*next)) {
+      return false;
+    }
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the vector master recursivly using the merge sort algorithm.
+//   Pre:  A vector of keys, and 'before', true where a key goes before another.
+//   Post: A vector of keys, sorted in that order.
+template <class Key, class Less>
+void mergeSort(vector<Key>& master, Less before) {
+  int n = master.size();
+  
+  if (n > 1) {
+    // The only allocation: a copy of the list to merge back and forth with
+    vector<Key> scratch(master);
+    sortRange(&scratch[0], &master[0], 0, n, before);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the range [lo, hi) of 'from' into 'into', trading places with the
+//   other array at each level of the recursion instead of allocating.
+//   Pre:  'from' and 'into' hold the same values over [lo, hi).
+//   Post: 'into' holds the range in order; 'from' is scratch.
+template <class Key, class Less>
+void sortRange(Key* from, Key* into, int lo, int hi, Less before) {
+  int mid = lo + (hi - lo) / 2; // Bottom half is [lo, mid), top is [mid, hi)
+
+  // Short ranges are sorted in place
+  if ((hi - lo) <= NETWORK_SIZE) { sortBlock(into, lo, hi, before); }
+  else {
+    // Recursivly sort each half into 'from', using 'into' as scratch
+    sortRange(into, from, lo, mid, before);
+    sortRange(into, from, mid, hi, before);
+    
+    // Join the split lists
+    merge(from, lo, mid, hi, into, before);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges two sorted runs into one.
+//   Pre:  The runs src[lo, mid) (bot) and src[mid, hi) (top) are each sorted.
+//   Post: dst[lo, hi) holds the final sorted run containing the other two.
+template <class Key, class Less>
+void merge(const Key* src, int lo, int mid, int hi, Key* dst, Less before) {
+  mergeRuns(src + lo, mid - lo, src + mid, hi - mid, dst + lo, before);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges two sorted arrays into one.
+//   Pre:  'bot' holds p sorted keys and 'top' holds q sorted keys.
+//   Post: dst[0, p + q) holds both in sorted order.
+template <class Key, class Less>
+void mergeRuns(const Key* bot, int p, const Key* top, int q, Key* dst,
+	       Less before) {
+  mergeScalar(bot, p, top, q, dst, before);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges two sorted arrays of ints into one, eight at a time where AVX2
+//   allows, or without branches if so chosen.
+//   Pre:  'bot' holds p sorted ints and 'top' holds q sorted ints.
+//   Post: dst[0, p + q) holds both in sorted order.
+void mergeRuns(const int* bot, int p, const int* top, int q, int* dst,
+	       less<int> before) {
+  if (branchless) {
+    mergeBranchless(bot, p, top, q, dst);
+    return;
+  }
+#if defined(__AVX2__)
+  if ((p >= 8) && (q >= 8)) {
+    mergeBitonic(bot, p, top, q, dst);
+    return;
+  }
+#endif
+  mergeScalar(bot, p, top, q, dst, before);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges two sorted arrays into one, a value at a time.
+//   Pre:  'bot' holds p sorted keys and 'top' holds q sorted keys.
+//   Post: dst[0, p + q) holds both in sorted order, ties taken from 'bot'.
+template <class Key, class Less>
+void mergeScalar(const Key* bot, int p, const Key* top, int q, Key* dst,
+		 Less before) {
+  int i, j, k;
+  i = j = k = 0;
+
+  while ((i < p) && (j < q)) {
+    // Sort list
+    if (!before(top[j], bot[i])) { dst[k++] = bot[i++]; }
+    else { dst[k++] = top[j++]; }
+  }
+
+  // Finish the lists
+  if (i == p) { for (; j < q; ++j) { dst[k++] = top[j]; } }
+  else { for (; i < p; ++i) { dst[k++] = bot[i]; } }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges two sorted arrays into one without branching on the comparison,
+//   prefetching ahead in both runs.
+//   Pre:  'bot' holds p sorted ints and 'top' holds q sorted ints.
+//   Post: dst[0, p + q) holds both in sorted order, ties taken from 'bot'.
+void mergeBranchless(const int* bot, int p, const int* top, int q, int* dst) {
+  const int *botEnd = bot + p, *topEnd = top + q;
+  int fromBot; // 1 if the next value comes from 'bot', 0 if from 'top'
+
+  while ((bot < botEnd) && (top < topEnd)) {
+    __builtin_prefetch(bot + PREFETCH_AHEAD);
+    __builtin_prefetch(top + PREFETCH_AHEAD);
+
+    // The comparison only moves pointers, so it compiles to a conditional
+    // move instead of a branch that random data would mispredict
+    fromBot = (*bot <= *top);
+    *dst++ = fromBot ? *bot : *top;
+    bot += fromBot;
+    top += 1 - fromBot;
+  }
+
+  // Finish the lists
+  memcpy(dst, bot, (botEnd - bot) * sizeof(int));
+  dst += botEnd - bot;
+  memcpy(dst, top, (topEnd - top) * sizeof(int));
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges two sorted arrays of at least eight ints each with a bitonic merge
+//   network on AVX2 registers.
+//   Pre:  p >= 8 and q >= 8.
+//   Post: dst[0, p + q) holds both in sorted order.
+void mergeBitonic(const int* bot, int p, const int* top, int q, int* dst) {
+#if defined(__AVX2__)
+  int held[8], mixed[16]; // The eight held back, and them with a short tail
+  int i = 8, j = 8, k = 0;
+  __m256i next, high;
+
+  // Each step writes the smallest eight of the next block and the eight held
+  // back, and holds back the largest eight.
+  next = _mm256_loadu_si256((const __m256i*)bot);
+  high = _mm256_loadu_si256((const __m256i*)top);
+  for (;;) {
+    merge16(next, high);
+    _mm256_storeu_si256((__m256i*)(dst + k), next);
+    k += 8;
+    if ((i + 8 > p) || (j + 8 > q)) { break; }
+
+    // The block with the smaller head is the next one needed
+    if (bot[i] <= top[j]) {
+      next = _mm256_loadu_si256((const __m256i*)(bot + i));
+      i += 8;
+    }
+    else {
+      next = _mm256_loadu_si256((const __m256i*)(top + j));
+      j += 8;
+    }
+  }
+
+  // Fold the eight held back into whichever run has less than eight left,
+  // then finish with the other
+  _mm256_storeu_si256((__m256i*)held, high);
+  if (i + 8 > p) {
+    mergeScalar(held, 8, bot + i, p - i, mixed, less<int>());
+    mergeScalar(mixed, 8 + p - i, top + j, q - j, dst + k, less<int>());
+  }
+  else {
+    mergeScalar(held, 8, top + j, q - j, mixed, less<int>());
+    mergeScalar(mixed, 8 + q - j, bot + i, p - i, dst + k, less<int>());
+  }
+#else
+  mergeScalar(bot, p, top, q, dst, less<int>());
+#endif
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the vector master iteratively, merging runs from the bottom up. Short
+//   runs are formed by sortBlock(), then merged within cache sized tiles,
+//   and only then in passes over the whole list.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order.
+void bottomUpSort(vector<int>& master) {
+  int n = master.size();
+  int lo, width;
+  int span;        // Width the runs reach within a tile
+  int *from, *into, *temp;
+
+  if (n < 2) { return; }
+  vector<int> scratch(n);
+
+  // Form short runs
+  for (lo = 0; lo < n; lo += RUN_SIZE) {
+    sortBlock(&master[0], lo, min(lo + RUN_SIZE, n), less<int>());
+  }
+
+  // Merge the runs of each tile while it is still in cache. Every tile makes
+  // the same number of passes, so they all finish in the same array.
+  span = min(n, CACHE_TILE);
+  for (lo = 0; lo < n; lo += CACHE_TILE) {
+    from = &master[0];
+    into = &scratch[0];
+    for (width = RUN_SIZE; width < span; width *= 2) {
+      mergePass(from, into, lo, min(lo + CACHE_TILE, n), width);
+      temp = from; from = into; into = temp;
+    }
+  }
+
+  // Find where the tiles ended up
+  from = &master[0];
+  into = &scratch[0];
+  for (width = RUN_SIZE; width < span; width *= 2) {
+    temp = from; from = into; into = temp;
+  }
+
+  // Merge the tiles in passes over the whole list
+  for (width = span; width < n; width *= 2) {
+    mergePass(from, into, 0, n, width);
+    temp = from; from = into; into = temp;
+  }
+
+  if (from != &master[0]) { master.swap(scratch); }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts a block of at most NETWORK_SIZE keys in place, by insertion.
+//   Pre:  An array and the range [lo, hi) to be sorted.
+//   Post: list[lo, hi) is in order.
+template <class Key, class Less>
+void sortBlock(Key* list, int lo, int hi, Less before) {
+  insertionSort(list, lo, hi, before);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts a block of at most NETWORK_SIZE ints in place: with the sorting
+//   network where AVX2 runs it in registers, otherwise by insertion, which
+//   beats the scalar network.
+//   Pre:  An array and the range [lo, hi) to be sorted.
+//   Post: list[lo, hi) is in ascending order.
+void sortBlock(int* list, int lo, int hi, less<int>) {
+#if defined(__AVX2__)
+  sortNetwork(list + lo, hi - lo);
+#else
+  insertionSort(list, lo, hi, less<int>());
+#endif
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts a short range in place by insertion.
+//   Pre:  An array and the range [lo, hi) to be sorted.
+//   Post: list[lo, hi) is in order.
+template <class Key, class Less>
+void insertionSort(Key* list, int lo, int hi, Less before) {
+  int i, j;
+  Key next;
+
+  for (i = lo + 1; i < hi; ++i) {
+    next = list[i];
+    // Strictly before, so equal keys keep their order
+    for (j = i; (j > lo) && before(next, list[j - 1]); --j) {
+      list[j] = list[j - 1];
+    }
+    list[j] = next;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// The merge sort engines, compiled for each type of key
+template void mergeSort(vector<int32_t>&, less<int32_t>);
+template void mergeSort(vector<int64_t>&, less<int64_t>);
+template void mergeSort(vector<uint64_t>&, less<uint64_t>);
+template void mergeSort(vector<record>&, byKey);
+template void merge(const int32_t*, int, int, int, int32_t*, less<int32_t>);
+template void merge(const int64_t*, int, int, int, int64_t*, less<int64_t>);
+template void merge(const uint64_t*, int, int, int, uint64_t*,
+		    less<uint64_t>);
+template void merge(const record*, int, int, int, record*, byKey);
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges each pair of neighboring runs of length 'width' within [lo, hi).
+//   Pre:  from[lo, hi) is made up of sorted runs of length 'width'.
+//   Post: into[lo, hi) is made up of sorted runs of length 2 * 'width'.
+void mergePass(const int* from, int* into, int lo, int hi, int width) {
+  int left, mid, right;
+
+  for (left = lo; left < hi; left += 2 * width) {
+    mid = min(left + width, hi);
+    right = min(left + 2 * width, hi);
+    merge(from, left, mid, right, into, less<int>());
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the vector master with a pool of threads. Each half is a task that an
+//   idle thread may steal, and the final merges are split between threads.
+//   Pre:  A vector of ints, the number of threads and the grain cutoff.
+//   Post: A vector of sorted ints in ascending order.
+void parallelSort(vector<int>& master, int count, int cutoff) {
+  int n = master.size();
+  task whole;
+
+  if (n < 2) { return; }
+  vector<int> scratch(master);
+
+  // Start the pool; the main thread is worker 0
+  threads = count;
+  grain = cutoff;
+  stopping = 0;
+  workers = new worker[threads];
+  for (int i = 0; i < threads; ++i) {
+    pthread_mutex_init(&workers[i].lock, NULL);
+  }
+  for (long i = 1; i < threads; ++i) {
+    pthread_create(&workers[i].thread, NULL, workerLoop, (void*)i);
+  }
+
+  // Sort the whole list from the scratch copy into master
+  whole.work = sortTask;
+  whole.from = &scratch[0];
+  whole.into = &master[0];
+  whole.lo = 0;
+  whole.hi = n;
+  whole.finished = 0;
+  sortTask(&whole, 0);
+
+  // Stop the pool
+  __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+  for (int i = 1; i < threads; ++i) { pthread_join(workers[i].thread, NULL); }
+  for (int i = 0; i < threads; ++i) { pthread_mutex_destroy(&workers[i].lock); }
+  delete [] workers;
+  workers = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Finds how many of the first k merged values come from 'bot' (co-ranking).
+//   Pre:  'bot' holds p sorted ints, 'top' holds q sorted ints, k <= p + q.
+//   Post: Returns i such that bot[0, i) and top[0, k - i) are the first k
+//         values of a stable merge.
+int coRank(int k, const int* bot, int p, const int* top, int q) {
+  int lo = max(0, k - q);
+  int hi = min(k, p);
+  int i;
+
+  // Take the fewest from 'bot' such that the last taken from 'top' is
+  // strictly less than the next in 'bot'; ties go to 'bot' first.
+  while (lo < hi) {
+    i = lo + (hi - lo) / 2;
+    if (top[k - i - 1] < bot[i]) { hi = i; }
+    else { lo = i + 1; }
+  }
+  return lo;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges from[lo, mid) and from[mid, hi) into 'into', split between threads.
+//   Pre:  Both runs are sorted; 'self' is the worker calling.
+//   Post: into[lo, hi) holds the merged run.
+void parallelMerge(int* from, int* into, int lo, int mid, int hi, int self) {
+  int pieces = min(threads, (hi - lo) / grain);
+  int p = mid - lo, q = hi - mid;
+  int k, i, nextK, nextI;
+
+  if (pieces < 2) {
+    merge(from, lo, mid, hi, into, less<int>());
+    return;
+  }
+
+  // Cut the output into even pieces and find where each begins in both runs
+  vector<task> jobs(pieces);
+  for (int piece = 0; piece < pieces; ++piece) {
+    k = (int)((long long)(hi - lo) * piece / pieces);
+    nextK = (int)((long long)(hi - lo) * (piece + 1) / pieces);
+    i = coRank(k, from + lo, p, from + mid, q);
+    nextI = coRank(nextK, from + lo, p, from + mid, q);
+
+    jobs[piece].work = mergeTask;
+    jobs[piece].from = from;
+    jobs[piece].into = into;
+    jobs[piece].lo = lo + i;
+    jobs[piece].hi = lo + nextI;
+    jobs[piece].top = mid + (k - i);
+    jobs[piece].end = mid + (nextK - nextI);
+    jobs[piece].out = lo + k;
+    jobs[piece].finished = 0;
+  }
+
+  // Offer all but the first piece to the pool and do that one here
+  for (int piece = 1; piece < pieces; ++piece) { spawn(&jobs[piece], self); }
+  mergeTask(&jobs[0], self);
+  for (int piece = 1; piece < pieces; ++piece) { join(&jobs[piece], self); }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Task bodies for the pool: sort a range, or merge one piece of a merge.
+void sortTask(task* job, int self) {
+  int lo = job->lo, hi = job->hi;
+  int mid = lo + (hi - lo) / 2;
+  task bot;
+
+  if ((hi - lo) <= grain) {
+    sortRange(job->from, job->into, lo, hi, less<int>());
+  }
+  else {
+    // Offer the bottom half to the pool and sort the top half here
+    bot.work = sortTask;
+    bot.from = job->into;
+    bot.into = job->from;
+    bot.lo = lo;
+    bot.hi = mid;
+    bot.finished = 0;
+    spawn(&bot, self);
+
+    task top = bot;
+    top.lo = mid;
+    top.hi = hi;
+    sortTask(&top, self);
+    join(&bot, self);
+
+    // Join the split lists
+    parallelMerge(job->from, job->into, lo, mid, hi, self);
+  }
+  __atomic_store_n(&job->finished, 1, __ATOMIC_RELEASE);
+}
+
+void mergeTask(task* job, int) {
+  mergeRuns(job->from + job->lo, job->hi - job->lo,
+	    job->from + job->top, job->end - job->top, job->into + job->out,
+	    less<int>());
+  __atomic_store_n(&job->finished, 1, __ATOMIC_RELEASE);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Pushes a task onto the worker's own deque.
+void spawn(task* job, int self) {
+  pthread_mutex_lock(&workers[self].lock);
+  workers[self].tasks.push_back(job);
+  pthread_mutex_unlock(&workers[self].lock);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Runs one task, from the worker's own deque or stolen from another.
+//   Post: Returns false if there was nothing to run.
+bool runOne(int self) {
+  task* job = NULL;
+  worker* victim;
+
+  // Newest of our own first, it is the most likely to still be in cache
+  pthread_mutex_lock(&workers[self].lock);
+  if (!workers[self].tasks.empty()) {
+    job = workers[self].tasks.back();
+    workers[self].tasks.pop_back();
+  }
+  pthread_mutex_unlock(&workers[self].lock);
+
+  // Otherwise steal the oldest, and largest, task of another worker
+  for (int i = 1; (job == NULL) && (i < threads); ++i) {
+    victim = &workers[(self + i) % threads];
+    pthread_mutex_lock(&victim->lock);
+    if (!victim->tasks.empty()) {
+      job = victim->tasks.front();
+      victim->tasks.pop_front();
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+
+  if (job == NULL) { return false; }
+  job->work(job, self);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Runs other tasks until the given task is finished.
+void join(task* job, int self) {
+  while (!__atomic_load_n(&job->finished, __ATOMIC_ACQUIRE)) {
+    if (!runOne(self)) { sched_yield(); }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Body of each pool thread; runs tasks until the sort is done.
+void* workerLoop(void* arg) {
+  int self = (int)(long)arg;
+
+  while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+    if (!runOne(self)) { sched_yield(); }
+  }
+  return NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts a file that may be larger than memory. Chunks that fit the memory
+//   budget are sorted and spilled to temporary run files, which are then
+//   merged through a loser tree straight into the output file.
+//   Pre:  The name of the input file, the budget in megabytes, the threads to
+//         sort each chunk with, whether to write a binary list and whether
+//         to print diagnostic info.
+//   Post: The sorted list is written to output.txt, or output.bin.
+void externalSort(string file_name, int budget, int count, bool binary,
+		  bool verbose) {
+  const char *data, *next, *cut, *end;
+  const char *page;       // Page holding the start of a chunk
+  size_t size;            // Size of the file
+  size_t window;          // Bytes of text read per chunk
+  size_t length = 0;      // Total number of values
+  size_t each;            // Buffer length per run during the merge
+  size_t total;           // Values in a binary list
+  int k, winner, loser, node, value, last;
+  vector<int> chunk;
+  vector<run> runs;
+  vector<int> tree;
+  writer list, echo;      // Buffered output of the list, and its verbose echo
+
+  data = mapFile(file_name, size);
+  end = data + size;
+
+  // A chunk of text holds at most one value per two bytes, so a window of a
+  // quarter of the budget keeps the chunk and the sort's scratch copy within
+  // it.
+  window = ((size_t)budget << 20) / 4;
+  chunk.reserve(window / 2 + 1);
+
+  // Sort each chunk and spill it to a run file
+  if ((data != NULL) && isBinary(data, size)) {
+    total = binaryCount(data, size);
+    for (size_t first = 0; first < total; first += window / 2) {
+      chunk.clear();
+      readBinary(data, first, min(window / 2, total - first), chunk);
+      spillRun(chunk, runs, count);
+      length += chunk.size();
+    }
+    end = data;
+  }
+  for (next = data; next < end; next = cut) {
+    cut = ((size_t)(end - next) > window) ? (next + window) : end;
+    while ((cut < end) && !isspace((unsigned char)*cut)) { ++cut; }
+
+    chunk.clear();
+    if (!scanList(next, cut, chunk)) {
+      printf("File contains invalid characters.\n"
+	     "Good Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    // The text of this chunk is no longer needed in memory
+    page = data + ((size_t)(next - data) / getpagesize()) * getpagesize();
+    madvise((void *)page, cut - page, MADV_DONTNEED);
+    if (chunk.empty()) { continue; }
+
+    spillRun(chunk, runs, count);
+    length += chunk.size();
+  }
+  if (data != NULL) { munmap((void *)data, size); }
+  vector<int>().swap(chunk);
+
+  output.open("output.txt");
+  if (output.fail()) {
+    printf("Output file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Output file name and length
+  if (verbose) { cout << "File Name:\t" << file_name << "\n"; }
+  output << "File Name:\t" << file_name << "\n";
+  if (verbose) { printf("Length:\t\t%lu\nRuns:\t\t%lu\n",
+			(unsigned long)length, (unsigned long)runs.size()); }
+  output << "Length:\t\t" << length << "\n";
+
+  // Split the budget between the run buffers
+  k = runs.size();
+  if (k > 0) {
+    each = max((size_t)RUN_BUFFER, ((size_t)budget << 20) / sizeof(int) / k);
+    for (int i = 0; i < k; ++i) {
+      runs[i].buffer.resize(each);
+      fillRun(runs[i]);
+    }
+    tree.resize(k);
+    tree[0] = playTree(runs, tree, 1);
+  }
+
+  // Merge the runs, writing each value as it wins
+  if (binary) {
+    openWriter(list, createBinary());
+    writeHeader(list, length);
+  }
+  else { openWriter(list, appendOutput()); }
+  if (verbose) {
+    fflush(stdout);
+    openWriter(echo, STDOUT_FILENO);
+  }
+  last = 0;
+  for (size_t i = 0; i < length; ++i) {
+    winner = tree[0];
+    value = runs[winner].buffer[runs[winner].next++];
+    if (runs[winner].next == runs[winner].fill) { fillRun(runs[winner]); }
+
+    if (verbose) { writeInt(echo, value); }
+    writeInt(list, value);
+
+    // Test if list is actually sorted
+    if ((i > 0) && (last > value)) {
+      printf("Sorting algorithm failed!\n");
+      break;
+    }
+    last = value;
+
+    // Replay the winner's path to the root
+    for (node = (winner + k) / 2; node > 0; node /= 2) {
+      if (runLess(runs, tree[node], winner)) {
+	loser = winner;
+	winner = tree[node];
+	tree[node] = loser;
+      }
+    }
+    tree[0] = winner;
+  }
+
+  for (int i = 0; i < k; ++i) { fclose(runs[i].file); }
+  if (verbose) { closeWriter(echo); }
+  closeWriter(list);
+  close(list.fd);
+  output.close();
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts a chunk of an external sort and spills it to a temporary run file.
+//   Pre:  The chunk, the runs so far and the threads to sort with.
+//   Post: A run holding the sorted chunk is added to 'runs'.
+void spillRun(vector<int>& chunk, vector<run>& runs, int count) {
+  if (count > 1) { parallelSort(chunk, count, GRAIN); }
+  else { mergeSort(chunk, less<int>()); }
+
+  runs.push_back(run());
+  runs.back().file = tmpfile();
+  if ((runs.back().file == NULL) ||
+      (fwrite(&chunk[0], sizeof(int), chunk.size(), runs.back().file) !=
+       chunk.size())) {
+    printf("Unable to write a temporary run file.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  fflush(runs.back().file);
+  runs.back().at = 0;
+  runs.back().stop = chunk.size() * sizeof(int);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads the next block of a run into its buffer. The file is read at the
+//   run's own offset, so threads may read their pieces of it at once.
+//   Post: Returns false, and marks the run done, once the run is exhausted.
+bool fillRun(run& source) {
+  size_t want;  // Bytes left in the run, up to a bufferful
+  ssize_t got;
+  const char *next, *end;
+  unsigned int value;
+
+  source.next = 0;
+  if (source.data == NULL) {
+    want = min((size_t)(source.stop - source.at),
+	       source.buffer.size() * sizeof(int));
+    got = (want > 0) ? pread(fileno(source.file), &source.buffer[0], want,
+			     source.at) : 0;
+    if (got < 0) {
+      printf("Unable to read a temporary run file.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    source.fill = got / sizeof(int);
+    source.at += source.fill * sizeof(int);
+  }
+  else if (source.text) {
+    // The text was checked as it was read in, so only whitespace is skipped
+    next = source.data + source.at;
+    end = source.data + source.stop;
+    source.fill = 0;
+    while ((source.fill < source.buffer.size()) && (next < end)) {
+      if (!isdigit((unsigned char)*next)) { ++next; continue; }
+      next = parseDigits(next, end, value);
+      source.buffer[source.fill++] = (int)value;
+    }
+    source.at = next - source.data;
+  }
+  else {
+    // The buffer is refilled up to the room it was given
+    want = min(source.buffer.capacity(), (size_t)(source.stop - source.at));
+    source.buffer.clear();
+    readBinary(source.data, source.at, want, source.buffer);
+    source.fill = want;
+    source.at += want;
+  }
+  source.done = (source.fill == 0);
+  return !source.done;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Orders two runs of a loser tree by their next value; exhausted runs lose,
+//   and ties go to the earlier run so the merge stays stable.
+bool runLess(vector<run>& runs, int a, int b) {
+  int x, y;
+
+  if (runs[a].done) { return false; }
+  if (runs[b].done) { return true; }
+  x = runs[a].buffer[runs[a].next];
+  y = runs[b].buffer[runs[b].next];
+  return (x < y) || ((x == y) && (a < b));
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Finds where a sorted run passes a value, by a binary search of its file.
+//   Post: Returns the position of the first value of the run greater than
+//         'value', or the end of the run.
+off_t runBound(const run& source, int value) {
+  off_t lo, hi, mid, at;
+  off_t unit;         // Bytes per value, or 1 for a binary list in place
+  const char *past;   // Just past a value of text
+  unsigned int found;
+  int probe;
+
+  // Values a fixed width apart
+  if (!source.text) {
+    unit = (source.data == NULL) ? sizeof(int) : 1;
+    lo = 0;
+    hi = (source.stop - source.at) / unit;
+    while (lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      at = source.at + mid * unit;
+      probe = 0;
+      runValue(source, at, probe);
+      if (probe <= value) { lo = mid + 1; }
+      else { hi = mid; }
+    }
+    return source.at + lo * unit;
+  }
+
+  // Text: 'lo' is kept at the start of a value and 'hi' at one, or the end;
+  //   when no value starts in the upper half, the one at 'lo' is tried
+  lo = textStart(source.data, source.at, source.stop);
+  hi = source.stop;
+  while (lo < hi) {
+    mid = textStart(source.data, lo + (hi - lo) / 2, hi);
+    if (mid == hi) { mid = lo; }
+    past = parseDigits(source.data + mid, source.data + hi, found);
+    if ((int)found > value) { hi = mid; }
+    else { lo = textStart(source.data, past - source.data, hi); }
+  }
+  return lo;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads the value of a run at a position. In text the position is moved on
+//   to the start of the next value, if it is not at one.
+//   Post: Returns false if no value is left in the run from there.
+bool runValue(const run& source, off_t& at, int& value) {
+  vector<int> one;    // The value of a binary list
+  unsigned int found;
+
+  if (source.data == NULL) {
+    if (pread(fileno(source.file), &value, sizeof(int), at) !=
+	(ssize_t)sizeof(int)) {
+      printf("Unable to read a temporary run file.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    return true;
+  }
+  if (source.text) {
+    at = textStart(source.data, at, source.stop);
+    if (at >= source.stop) { return false; }
+    parseDigits(source.data + at, source.data + source.stop, found);
+    value = (int)found;
+    return true;
+  }
+  if (at >= source.stop) { return false; }
+  readBinary(source.data, at, 1, one);
+  value = one[0];
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Finds the start of the first value of text at or after a position.
+//   Post: Returns its position, or 'stop' if there is none before it.
+off_t textStart(const char *data, off_t at, off_t stop) {
+  // Past the rest of a value the position falls within
+  if ((at > 0) && isdigit((unsigned char)data[at - 1])) {
+    while ((at < stop) && isdigit((unsigned char)data[at])) { ++at; }
+  }
+  while ((at < stop) && !isdigit((unsigned char)data[at])) { ++at; }
+  return at;
+}
+////////////////////////////////////////////////////////////////////////////////
+// Plays the matches of the subtree rooted at 'node' to set up a loser tree,
+//   over runs of the external sort or pieces of sorted files.
+//   Pre:  Leaves are the nodes k through 2k - 1, for run node - k.
+//   Post: The losers are stored in 'tree'; returns the winning run.
+template <class Source>
+int playTree(vector<Source>& runs, vector<int>& tree, int node) {
+  int k = runs.size();
+  int left, right;
+
+  if (node >= k) { return node - k; }
+
+  left = playTree(runs, tree, 2 * node);
+  right = playTree(runs, tree, 2 * node + 1);
+  if (runLess(runs, right, left)) {
+    tree[node] = left;
+    return right;
+  }
+  tree[node] = right;
+  return left;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads the files to be merged: those named in a manifest, one per line, or
+//   matching a wildcard pattern. Each is checked a window of a quarter of the
+//   budget at a time, as externalSort() reads its chunks. Sorted windows are
+//   left in the file, to be merged from it in place; a window out of order
+//   is sorted and spilled as a run of its own to the spill file.
+//   Pre:  The manifest or pattern, the budget in MB and whether to print
+//         diagnostic info.
+//   Post: The files and their runs, in order, and the number of values are
+//         stored in 'job'. Exits if no files are found.
+void readShards(string source, merger& job, int budget, bool verbose) {
+  const char *data, *next, *cut, *end;
+  const char *page;       // Page holding the start of a window
+  size_t size;            // Size of a file
+  size_t window;          // Bytes of text read per window
+  size_t total;           // Values in a binary list
+  vector<int> chunk;
+  bool open;              // The last run is this file's, read in place
+  bool told;              // Said that this file is being sorted
+  int last;               // Last value of the file's last run
+
+  listBatch(source, job.names);
+  job.length = 0;
+  job.spill = tmpfile();
+  if (job.spill == NULL) {
+    printf("Unable to write a temporary run file.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // As in externalSort(), a window of text a quarter of the budget keeps the
+  //   values and the sort's scratch copy within it
+  window = ((size_t)budget << 20) / 4;
+
+  for (size_t i = 0; i < job.names.size(); ++i) {
+    data = mapFile(job.names[i], size);
+    end = data + size;
+    chunk.reserve(min(window, size) / 2 + 1);
+    open = false;
+    told = false;
+    last = 0;
+
+    if ((data != NULL) && isBinary(data, size)) {
+      total = binaryCount(data, size);
+      for (size_t first = 0; first < total; first += window / 2) {
+	chunk.clear();
+	readBinary(data, first, min(window / 2, total - first), chunk);
+	if (!addShard(chunk, job, i, false, first, first + chunk.size(),
+		      open, last) && verbose && !told) {
+	  printf("Sorting %s first.\n", job.names[i].c_str());
+	  told = true;
+	}
+      }
+      end = data;
+    }
+    for (next = data; next < end; next = cut) {
+      cut = ((size_t)(end - next) > window) ? (next + window) : end;
+      while ((cut < end) && !isspace((unsigned char)*cut)) { ++cut; }
+
+      chunk.clear();
+      if (!scanList(next, cut, chunk)) {
+	printf("File contains invalid characters.\n"
+	       "Good Bye!\n");
+	exit(EXIT_FAILURE);
+      }
+      // The text of this window is no longer needed in memory
+      page = data + ((size_t)(next - data) / getpagesize()) * getpagesize();
+      madvise((void *)page, cut - page, MADV_DONTNEED);
+      if (chunk.empty()) { continue; }
+
+      if (!addShard(chunk, job, i, true, next - data, cut - data, open,
+		    last) && verbose && !told) {
+	printf("Sorting %s first.\n", job.names[i].c_str());
+	told = true;
+      }
+    }
+    if (data != NULL) { munmap((void *)data, size); }
+  }
+
+  // The spilled runs are read back at their own offsets, past the buffer
+  if (fflush(job.spill) != 0) {
+    printf("Unable to write a temporary run file.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds a window of a file to be merged to its runs. A sorted window that
+//   carries on the file's last run in place extends it, and any other sorted
+//   window begins a run in place; a window out of order is sorted and
+//   spilled.
+//   Pre:  The window's values, the file it is from and whether as text, and
+//         where it lies in the file: bytes of text, or values of a binary
+//         list. 'open' is set if the file's last run is read in place and
+//         'last' is its last value.
+//   Post: Returns false if the window had to be sorted.
+bool addShard(vector<int>& chunk, merger& job, int file, bool text,
+	      off_t first, off_t stop, bool& open, int& last) {
+  job.length += chunk.size();
+
+  for (size_t j = 1; j < chunk.size(); ++j) {
+    if (chunk[j - 1] > chunk[j]) {
+      mergeSort(chunk, less<int>());
+      job.runs.push_back(run());
+      job.runs.back().file = job.spill;
+      job.runs.back().at = ftello(job.spill);
+      job.runs.back().stop = job.runs.back().at + chunk.size() * sizeof(int);
+      job.runs.back().count = chunk.size();
+      spillValues(chunk, job.spill);
+      open = false;
+      return false;
+    }
+  }
+
+  if (open && (chunk[0] >= last)) {
+    job.runs.back().stop = stop;
+    job.runs.back().count += chunk.size();
+  }
+  else {
+    job.runs.push_back(run());
+    job.runs.back().shard = file;
+    job.runs.back().text = text;
+    job.runs.back().at = first;
+    job.runs.back().stop = stop;
+    job.runs.back().count = chunk.size();
+  }
+  open = true;
+  last = chunk.back();
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends values to a temporary run file and empties the block.
+//   Post: Exits if the write fails.
+void spillValues(vector<int>& block, FILE *file) {
+  if (!block.empty() &&
+      (fwrite(&block[0], sizeof(int), block.size(), file) != block.size())) {
+    printf("Unable to write a temporary run file.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  block.clear();
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Maps the files that runs of a merge are read from in place, each once for
+//   the runs of it that lie together.
+//   Post: The runs point into the mappings, which are kept in 'job' until
+//         unmapShards().
+void mapShards(merger& job, vector<run>& runs) {
+  const char *data = NULL;
+  size_t size;
+  int shard = -1;         // File mapped last
+
+  for (size_t i = 0; i < runs.size(); ++i) {
+    if (runs[i].file != NULL) { continue; }
+    if (runs[i].shard != shard) {
+      shard = runs[i].shard;
+      data = mapFile(job.names[shard], size);
+      job.maps.push_back(make_pair(data, size));
+    }
+    runs[i].data = data;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Undoes the mappings of mapShards().
+void unmapShards(merger& job) {
+  for (size_t i = 0; i < job.maps.size(); ++i) {
+    munmap((void *)job.maps[i].first, job.maps[i].second);
+  }
+  job.maps.clear();
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges the runs of sorted files into output.txt, or output.bin. No more
+//   runs are merged at once than the budget gives RUN_BUFFER ints each, or
+//   than half the files that may be open at once; while there are more,
+//   passShards() merges them in groups onto the spill file. The merged list
+//   is then cut into a slice per thread at the values splitShards() picks,
+//   and each thread merges its piece of every run through a loser tree and
+//   buffers of its own into a temporary file. The slices are copied to the
+//   output in order.
+//   Pre:  The runs, the name of the merge for the header, the budget in MB
+//         for the buffers, the threads, whether to write a binary list and
+//         whether to print diagnostic info.
+//   Post: The merged list is written out and the spill file is closed.
+void mergeShards(merger& job, string file_name, int budget, int count,
+		 bool binary, bool verbose) {
+  size_t room;            // Ints the read buffers may hold between them
+  size_t fanIn;           // Most runs merged at once
+  size_t k;               // Runs of the last pass
+  size_t runs;            // Runs before any pass
+  size_t merged = 0;      // Values that came out of the slices
+  int slices;             // Threads merging, one slice each
+  int passes = 0;         // Passes before the last
+  vector<int> splitters;  // Values the slices are cut after
+  vector<off_t> first, last; // Where each run is cut for a slice
+  vector<slice> team;
+  writer list, echo;      // Buffered output of the list, and its verbose echo
+  ssize_t got;            // Bytes of a slice read back
+  uint32_t raw;           // A value of a binary slice
+  bool failed = false;    // The slices did not come out in order
+  int previous = 0;       // Last value of the slices so far
+
+  output.open("output.txt");
+  if (output.fail()) {
+    printf("Output file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Output file name, length and number of files
+  if (verbose) { cout << "File Name:\t" << file_name << "\n"; }
+  output << "File Name:\t" << file_name << "\n";
+  if (verbose) { printf("Length:\t\t%lu\nFiles:\t\t%lu\n",
+			(unsigned long)job.length,
+			(unsigned long)job.names.size()); }
+  output << "Length:\t\t" << job.length << "\n";
+  output << "Files:\t\t" << job.names.size() << "\n";
+
+  // Bound the fan-in rather than the buffers, merging in passes until the
+  //   runs left fit
+  slices = max((size_t)1, min((size_t)count, job.length / GRAIN));
+  room = ((size_t)budget << 20) / sizeof(int);
+  fanIn = max((size_t)2, min(room / RUN_BUFFER / slices,
+			     (size_t)sysconf(_SC_OPEN_MAX) / 2));
+  runs = job.runs.size();
+  while (job.runs.size() > fanIn) {
+    passShards(job, fanIn, room / fanIn);
+    ++passes;
+  }
+  if (verbose) { printf("Runs:\t\t%lu\nPasses:\t\t%i\n",
+			(unsigned long)runs, passes + 1); }
+
+  // Cut every run at the same values, for a slice per thread
+  k = job.runs.size();
+  mapShards(job, job.runs);
+  splitShards(job.runs, job.length, slices, splitters);
+  team.resize(slices);
+  first.resize(k);
+  last.resize(k);
+  for (size_t i = 0; i < k; ++i) { first[i] = job.runs[i].at; }
+  for (int t = 0; t < slices; ++t) {
+    team[t].pieces = job.runs;
+    for (size_t i = 0; i < k; ++i) {
+      last[i] = (t < slices - 1) ? runBound(job.runs[i], splitters[t]) :
+	job.runs[i].stop;
+      team[t].pieces[i].at = first[i];
+      team[t].pieces[i].stop = last[i];
+    }
+    team[t].each = room / max((size_t)1, k * slices);
+    team[t].binary = binary;
+    team[t].spill = false;
+    team[t].out = tmpfile();
+    if (team[t].out == NULL) {
+      printf("Unable to write a temporary run file.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    first = last;
+  }
+
+  // The main thread merges the first slice
+  for (int t = 1; t < slices; ++t) {
+    pthread_create(&team[t].thread, NULL, mergeSlice, &team[t]);
+  }
+  mergeSlice(&team[0]);
+  for (int t = 1; t < slices; ++t) { pthread_join(team[t].thread, NULL); }
+  unmapShards(job);
+
+  // Test if list is actually sorted, within and across the slices, and
+  //   holds every value
+  for (int t = 0; t < slices; ++t) {
+    if (team[t].length == 0) { continue; }
+    if (team[t].failed || ((merged > 0) && (previous > team[t].first))) {
+      failed = true;
+    }
+    previous = team[t].last;
+    merged += team[t].length;
+  }
+  if (failed || (merged != job.length)) {
+    printf("Sorting algorithm failed!\n");
+  }
+
+  // Copy the slices to the output in order, straight through its buffer
+  if (binary) {
+    openWriter(list, createBinary());
+    writeHeader(list, merged);
+  }
+  else { openWriter(list, appendOutput()); }
+  flushWriter(list);
+  if (verbose) {
+    fflush(stdout);
+    openWriter(echo, STDOUT_FILENO);
+  }
+  for (int t = 0; t < slices; ++t) {
+    lseek(fileno(team[t].out), 0, SEEK_SET);
+    while ((got = read(fileno(team[t].out), list.buffer, WRITE_BUFFER)) > 0) {
+      list.fill = got;
+      if (verbose && binary) {
+	for (ssize_t j = 0; j + (ssize_t)sizeof(raw) <= got; j += sizeof(raw)) {
+	  memcpy(&raw, list.buffer + j, sizeof(raw));
+	  writeInt(echo, (int)LITTLE32(raw));
+	}
+      }
+      else if (verbose) {
+	memcpy(echo.buffer, list.buffer, got);
+	echo.fill = got;
+	flushWriter(echo);
+      }
+      flushWriter(list);
+    }
+    if (got < 0) {
+      printf("Unable to read a temporary run file.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    fclose(team[t].out);
+  }
+
+  fclose(job.spill);
+  if (verbose) { closeWriter(echo); }
+  closeWriter(list);
+  close(list.fd);
+  output.close();
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges the runs of sorted files in groups of 'fanIn', each group through
+//   a loser tree into one run on the spill file, so the next pass has fewer
+//   runs to merge.
+//   Pre:  More than 'fanIn' runs, and the ints to buffer for each.
+//   Post: Each group is replaced by its merged run, in the same order.
+void passShards(merger& job, size_t fanIn, size_t each) {
+  vector<run> merged;     // Runs for the next pass
+  slice part;             // The group being merged
+  off_t start;            // Where its run begins on the spill file
+
+  for (size_t g = 0; g < job.runs.size(); g += fanIn) {
+    if (g + 1 == job.runs.size()) {
+      merged.push_back(job.runs[g]);
+      continue;
+    }
+
+    part.pieces.assign(job.runs.begin() + g,
+		       job.runs.begin() + min(g + fanIn, job.runs.size()));
+    mapShards(job, part.pieces);
+    part.each = each;
+    part.binary = false;
+    part.spill = true;
+    part.out = job.spill;
+    start = ftello(job.spill);
+    mergeSlice(&part);
+    unmapShards(job);
+
+    merged.push_back(run());
+    merged.back().file = job.spill;
+    merged.back().at = start;
+    merged.back().stop = start + part.length * sizeof(int);
+    merged.back().count = part.length;
+  }
+  job.runs.swap(merged);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Picks the values the merged list is cut after between slices, from
+//   samples spread over every run in proportion to its length. Equal values
+//   all fall in one slice, so the loser trees still take them from earlier
+//   runs first.
+//   Pre:  The runs, mapped, the values in all of them and the slices.
+//   Post: 'splitters' holds slices - 1 values in ascending order.
+void splitShards(vector<run>& runs, size_t length, int slices,
+		 vector<int>& splitters) {
+  vector<pair<int, double> > samples; // Values, and how many each stands for
+  size_t taken;           // Samples of a run
+  size_t unit;            // Bytes per value of a run, or 1 for text
+  off_t at;
+  int value;
+  double seen = 0;        // Values the samples so far stand for
+
+  splitters.clear();
+  if (slices < 2) { return; }
+
+  for (size_t i = 0; i < runs.size(); ++i) {
+    taken = 1 + runs[i].count * SHARD_SAMPLES * slices / length;
+    unit = (runs[i].data == NULL) ? sizeof(int) : 1;
+    for (size_t j = 0; j < taken; ++j) {
+      at = runs[i].at;
+      if (runs[i].text) { at += (runs[i].stop - runs[i].at) * j / taken; }
+      else { at += (runs[i].stop - runs[i].at) / unit * j / taken * unit; }
+      if (runValue(runs[i], at, value)) {
+	samples.push_back(make_pair(value, (double)runs[i].count / taken));
+      }
+    }
+  }
+  sort(samples.begin(), samples.end());
+
+  for (size_t j = 0; j < samples.size(); ++j) {
+    seen += samples[j].second;
+    while (((int)splitters.size() < slices - 1) &&
+	   (seen >= (double)length * (splitters.size() + 1) / slices)) {
+      splitters.push_back(samples[j].first);
+    }
+  }
+  while ((int)splitters.size() < slices - 1) {
+    splitters.push_back(samples.back().first);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Body of each thread of mergeShards(), and of each group of passShards();
+//   merges one slice into its file.
+void* mergeSlice(void* arg) {
+  slice *part = (slice*)arg;
+  vector<run>& pieces = part->pieces;
+  int k = pieces.size();
+  int winner, loser, node, value;
+  size_t most;            // Most values a piece can hold
+  vector<int> tree(k);
+  vector<int> block;      // Values on their way to the spill file
+  writer list;            // Buffered output of the slice
+
+  part->length = 0;
+  part->failed = false;
+  if (k == 0) { return NULL; }
+
+  // No piece needs a buffer longer than itself
+  for (int i = 0; i < k; ++i) {
+    most = pieces[i].stop - pieces[i].at;
+    if (pieces[i].data == NULL) { most /= sizeof(int); }
+    else if (pieces[i].text) { most = most / 2 + 1; }
+    pieces[i].buffer.resize(min(part->each, most));
+    fillRun(pieces[i]);
+  }
+  tree[0] = playTree(pieces, tree, 1);
+
+  if (part->spill) { block.reserve(RUN_BUFFER); }
+  else {
+    openWriter(list, fileno(part->out));
+    list.binary = part->binary;
+  }
+  while (!pieces[tree[0]].done) {
+    winner = tree[0];
+    value = pieces[winner].buffer[pieces[winner].next++];
+    if (pieces[winner].next == pieces[winner].fill) { fillRun(pieces[winner]); }
+
+    if (!part->spill) { writeInt(list, value); }
+    else {
+      block.push_back(value);
+      if (block.size() == RUN_BUFFER) { spillValues(block, part->out); }
+    }
+
+    if (part->length == 0) { part->first = value; }
+    else if (part->last > value) { part->failed = true; }
+    part->last = value;
+    ++part->length;
+
+    // Replay the winner's path to the root
+    for (node = (winner + k) / 2; node > 0; node /= 2) {
+      if (runLess(pieces, tree[node], winner)) {
+	loser = winner;
+	winner = tree[node];
+	tree[node] = loser;
+      }
+    }
+    tree[0] = winner;
+  }
+
+  if (part->spill) {
+    spillValues(block, part->out);
+    if (fflush(part->out) != 0) {
+      printf("Unable to write a temporary run file.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  else { closeWriter(list); }
+
+  for (int i = 0; i < k; ++i) { vector<int>().swap(pieces[i].buffer); }
+  return NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts many files at once, each on a thread of its own, into a file named
+//   after it with ".sorted" added. Files wait for memory while those being
+//   sorted would need more than the budget between them.
+//   Pre:  The files and choice of sort, the threads and the budget in MB.
+//   Post: Each file is sorted and a summary of the throughput is printed.
+void batchSort(batch& job, int count, int budget) {
+  vector<pthread_t> pool;  // The batch threads
+  struct timespec start;   // When the batch started
+  struct timespec stop;    // And when it finished
+  double seconds;          // Time taken
+
+  job.next = 0;
+  job.budget = (size_t)(budget ? budget : BATCH_BUDGET) << 20;
+  job.held = 0;
+  job.values = job.bytes = 0;
+  job.failed = 0;
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.freed, NULL);
+
+  // No more threads than files
+  if ((size_t)count > job.names.size()) { count = job.names.size(); }
+  pool.resize(count);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < count; ++i) {
+    pthread_create(&pool[i], NULL, batchLoop, &job);
+  }
+  for (int i = 0; i < count; ++i) { pthread_join(pool[i], NULL); }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  if (seconds <= 0) { seconds = 1e-9; }
+
+  printf("Files:\t\t%lu (%i failed)\n"
+	 "Threads:\t%i\n"
+	 "Values:\t\t%lld\n"
+	 "Seconds:\t%.3f\n"
+	 "Throughput:\t%.1f files/s, %.0f values/s, %.1f MB/s\n",
+	 (unsigned long)job.names.size(), job.failed, count, job.values,
+	 seconds, job.names.size() / seconds, job.values / seconds,
+	 job.bytes / seconds / (1 << 20));
+
+  pthread_cond_destroy(&job.freed);
+  pthread_mutex_destroy(&job.lock);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Lists the files of a batch: the names in a manifest, one per line, or
+//   the matches of a wildcard pattern.
+//   Post: The names are added to 'names'. Exits if none are found.
+void listBatch(string source, vector<string>& names) {
+  ifstream manifest;  // File listing the inputs
+  string line;        // One name from it
+  glob_t matches;     // Files matching a pattern
+
+  if (source.find_first_of("*?[") != string::npos) {
+    if (glob(source.c_str(), 0, NULL, &matches) == 0) {
+      names.insert(names.end(), matches.gl_pathv,
+		   matches.gl_pathv + matches.gl_pathc);
+    }
+    globfree(&matches);
+  }
+  else {
+    manifest.open(source.c_str());
+    if (manifest.fail()) {
+      printf("Manifest file opening failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    while (getline(manifest, line)) {
+      if (!line.empty()) { names.push_back(line); }
+    }
+    manifest.close();
+  }
+
+  if (names.empty()) {
+    printf("No files to sort.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Body of each batch thread; sorts files until none are left.
+void* batchLoop(void* arg) {
+  batch *job = (batch *)arg;
+  string name;        // File being sorted
+  struct stat info;   // For the size of the file
+  size_t need;        // Memory the file is taken to need
+  size_t length;      // Values in the file
+  bool sorted;        // Whether it was sorted
+
+  while (true) {
+    pthread_mutex_lock(&job->lock);
+    if (job->next == job->names.size()) {
+      pthread_mutex_unlock(&job->lock);
+      break;
+    }
+    name = job->names[job->next++];
+    pthread_mutex_unlock(&job->lock);
+
+    if (stat(name.c_str(), &info) < 0) {
+      printf("%s: could not be opened.\n", name.c_str());
+      pthread_mutex_lock(&job->lock);
+      ++job->failed;
+      pthread_mutex_unlock(&job->lock);
+      continue;
+    }
+
+    // Wait for memory; a file larger than the budget runs on its own
+    need = (size_t)info.st_size * BATCH_FACTOR;
+    pthread_mutex_lock(&job->lock);
+    while ((job->held > 0) && (job->held + need > job->budget)) {
+      pthread_cond_wait(&job->freed, &job->lock);
+    }
+    job->held += need;
+    pthread_mutex_unlock(&job->lock);
+
+    length = 0;
+    sorted = sortFile(*job, name, length);
+
+    pthread_mutex_lock(&job->lock);
+    job->held -= need;
+    if (sorted) {
+      job->values += length;
+      job->bytes += info.st_size;
+    }
+    else { ++job->failed; }
+    pthread_cond_broadcast(&job->freed);
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts one file of a batch, reporting rather than exiting on bad input.
+//   Pre:  The batch and the name of the file.
+//   Post: Returns false if the file could not be sorted; 'length' holds the
+//         number of values sorted.
+bool sortFile(batch& job, const string& name, size_t& length) {
+  struct stat info;   // For the size of the file
+  const char *data;   // The file, mapped into memory
+  const char *problem = NULL; // What is wrong with a binary file, if anything
+  size_t count;       // Values in a binary file
+  vector<int> list;   // Vector to store input
+  writer out;         // Buffered output of the list
+  bool valid = true;  // Whether the file held only digits and whitespace
+  int fd;             // Input, then output file
+
+  // Map the whole file, as importFile() does, but without exiting on failure
+  fd = open(name.c_str(), O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &info) < 0)) {
+    printf("%s: could not be opened.\n", name.c_str());
+    if (fd >= 0) { close(fd); }
+    return false;
+  }
+  data = NULL;
+  if (info.st_size > 0) {
+    data = (const char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+			      fd, 0);
+    if (data == MAP_FAILED) {
+      printf("%s: could not be read.\n", name.c_str());
+      close(fd);
+      return false;
+    }
+    madvise((void *)data, info.st_size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  if (data != NULL) {
+    if (isBinary(data, info.st_size)) {
+      problem = checkBinary(data, info.st_size, count);
+      if ((problem == NULL) && !copyBinary(data, 0, count, list)) {
+	problem = "holds a value too large for an int";
+      }
+    }
+    else { valid = scanList(data, data + info.st_size, list); }
+    munmap((void *)data, info.st_size);
+  }
+  if (problem != NULL) {
+    printf("%s: binary file %s.\n", name.c_str(), problem);
+    return false;
+  }
+  if (!valid) {
+    printf("%s: contains invalid characters.\n", name.c_str());
+    return false;
+  }
+
+  // The thread pool is not shared, so each file is sorted on its own thread
+  if (job.radix) { radixSort(list); }
+  else if (job.adaptive) { adaptiveSort(list); }
+  else if (job.iterative) { bottomUpSort(list); }
+  else { mergeSort(list, less<int>()); }
+
+  fd = open((name + ".sorted").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    printf("%s.sorted: could not be written.\n", name.c_str());
+    return false;
+  }
+  if (!job.binary) {
+    dprintf(fd, "File Name:\t%s\nLength:\t\t%lu\n", name.c_str(),
+	    (unsigned long)list.size());
+  }
+  openWriter(out, fd);
+  if (job.binary) { writeHeader(out, list.size()); }
+  for (size_t i = 0; i < list.size(); ++i) { writeInt(out, list[i]); }
+  closeWriter(out);
+  close(fd);
+
+  length = list.size();
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the vector master by merging the runs already in it, in the manner of
+//   TimSort. Ascending and descending runs are found and kept on a stack
+//   whose lengths shrink faster than the Fibonacci numbers, so sorted input
+//   takes one pass.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order; returns the number of
+//         natural runs found.
+int adaptiveSort(vector<int>& master) {
+  int n = master.size();
+  int shortest = minRun(n);
+  int lo, length, force, top, found = 0;
+  int counted = 0;        // End of the natural runs counted so far
+  int *list;
+  vector<int> base, size; // Stack of pending runs
+  
+  if (n < 2) { return n; }
+  list = &master[0];
+  vector<int> scratch(n);
+
+  for (lo = 0; lo < n; lo += length) {
+    // Find the next run; past the runs counted, the list is still as given
+    length = countRun(list, lo, n);
+    force = max(length, min(shortest, n - lo));
+    if (lo == counted) {
+      counted += length;
+      ++found;
+    }
+
+    // Count the natural runs an extension takes in before sorting them
+    while (counted < lo + force) {
+      counted += countRun(list, counted, n);
+      ++found;
+    }
+
+    // Turn a descending run around, extending it if it is too short
+    if ((length > 1) && (list[lo + 1] < list[lo])) {
+      reverse(list + lo, list + lo + length);
+    }
+    if (length < force) {
+      insertionSort(list, lo, lo + force, less<int>());
+      length = force;
+    }
+    base.push_back(lo);
+    size.push_back(length);
+
+    // Merge until the top three runs on the stack satisfy
+    // size[i - 2] > size[i - 1] + size[i] and size[i - 1] > size[i]
+    while (size.size() > 1) {
+      top = size.size() - 2;
+      if (((top > 0) && (size[top - 1] <= size[top] + size[top + 1])) ||
+	  ((top > 1) && (size[top - 2] <= size[top - 1] + size[top]))) {
+	if (size[top - 1] < size[top + 1]) { --top; }
+      }
+      else if (size[top] > size[top + 1]) { break; }
+
+      gallopMerge(list, base[top], base[top + 1],
+		  base[top + 1] + size[top + 1], &scratch[0]);
+      size[top] += size[top + 1];
+      base.erase(base.begin() + top + 1);
+      size.erase(size.begin() + top + 1);
+    }
+  }
+
+  // Merge what is left, newest first
+  for (top = size.size() - 2; top >= 0; --top) {
+    gallopMerge(list, base[top], base[top + 1],
+		base[top + 1] + size[top + 1], &scratch[0]);
+    size[top] += size[top + 1];
+  }
+
+  return found;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Finds the length of the natural run starting at lo: ascending, or strictly
+//   descending.
+//   Pre:  lo < hi.
+//   Post: Returns the length; the list is unchanged.
+int countRun(const int* list, int lo, int hi) {
+  int next = lo + 1;
+
+  if (next == hi) { return 1; }
+
+  // Descending runs must be strict, so reversing them keeps the sort stable
+  if (list[next] < list[lo]) {
+    for (++next; (next < hi) && (list[next] < list[next - 1]); ++next) { }
+  }
+  else {
+    for (++next; (next < hi) && (list[next] >= list[next - 1]); ++next) { }
+  }
+  return next - lo;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges list[lo, mid) and list[mid, hi) in place, galloping through either
+//   run once it keeps winning.
+//   Pre:  Both runs are sorted; 'scratch' holds at least mid - lo ints.
+//   Post: list[lo, hi) is sorted.
+void gallopMerge(int* list, int lo, int mid, int hi, int* scratch) {
+  int i, j, k, p, q, step;
+  int winsBot = 0, winsTop = 0; // Wins in a row by either run
+
+  // The front of the bottom run and the back of the top run are already in
+  // place; for sorted input this leaves nothing to merge.
+  lo += gallopRight(list[mid], list + lo, mid - lo);
+  if (lo == mid) { return; }
+  hi = mid + gallopLeft(list[mid - 1], list + mid, hi - mid);
+  if (hi == mid) { return; }
+
+  // Move the bottom run aside and merge into the space it leaves
+  p = mid - lo;
+  q = hi;
+  memcpy(scratch, list + lo, p * sizeof(int));
+  i = 0;
+  j = mid;
+  k = lo;
+
+  while ((i < p) && (j < q)) {
+    if (winsBot >= MIN_GALLOP) {
+      // Copy every bottom value up to the next top value at once
+      step = gallopRight(list[j], scratch + i, p - i);
+      memcpy(list + k, scratch + i, step * sizeof(int));
+      i += step;
+      k += step;
+      winsBot = 0;
+    }
+    else if (winsTop >= MIN_GALLOP) {
+      // Copy every top value below the next bottom value at once
+      step = gallopLeft(scratch[i], list + j, q - j);
+      memmove(list + k, list + j, step * sizeof(int));
+      j += step;
+      k += step;
+      winsTop = 0;
+    }
+    else if (scratch[i] <= list[j]) {
+      list[k++] = scratch[i++];
+      ++winsBot;
+      winsTop = 0;
+    }
+    else {
+      list[k++] = list[j++];
+      ++winsTop;
+      winsBot = 0;
+    }
+  }
+
+  // Finish the lists; the rest of the top run is already in place
+  memcpy(list + k, scratch + i, (p - i) * sizeof(int));
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Number of values in base[0, n) strictly less than 'key' (gallopLeft) or
+//   less than or equal to it (gallopRight), by exponential then binary search.
+int gallopLeft(int key, const int* base, int n) {
+  int lo = 0, hi = 1, mid;
+
+  // Double the step until it passes the key
+  while ((hi < n) && (base[hi - 1] < key)) {
+    lo = hi;
+    hi = 2 * hi + 1;
+  }
+  if (hi > n) { hi = n; }
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (base[mid] < key) { lo = mid + 1; }
+    else { hi = mid; }
+  }
+  return lo;
+}
+
+int gallopRight(int key, const int* base, int n) {
+  int lo = 0, hi = 1, mid;
+
+  while ((hi < n) && (base[hi - 1] <= key)) {
+    lo = hi;
+    hi = 2 * hi + 1;
+  }
+  if (hi > n) { hi = n; }
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (base[mid] <= key) { lo = mid + 1; }
+    else { hi = mid; }
+  }
+  return lo;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Computes the shortest run worth merging for a list of n values.
+int minRun(int n) {
+  int odd = 0; // Set if any bit shifted off is set
+
+  while (n >= MIN_MERGE) {
+    odd |= (n & 1);
+    n >>= 1;
+  }
+  return n + odd;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the vector master by least significant digit radix sort, with
+//   11-bit digits. One read pass counts every digit; each scatter pass goes
+//   through cache-line buffers so writes to the buckets are combined.
+//   Pre:  A vector of ints.
+//   Post: A vector of sorted ints in ascending order.
+void radixSort(vector<int>& master) {
+  const unsigned int sign = 0x80000000u; // Flipped so negatives sort first
+  const unsigned int mask = RADIX_BUCKETS - 1;
+  int n = master.size();
+  int shift, digit;
+  unsigned int key, total, next;
+  unsigned int *from, *into, *temp, *start;
+  vector<unsigned int> count(RADIX_PASSES * RADIX_BUCKETS, 0);
+  vector<unsigned int> combine(RADIX_BUCKETS * COMBINE);
+  vector<int> fill(RADIX_BUCKETS);
+
+  if (n < 2) { return; }
+  vector<int> scratch(n);
+  from = (unsigned int*)&master[0];
+  into = (unsigned int*)&scratch[0];
+
+  // Count the digits of every pass in a single read of the list
+  for (int i = 0; i < n; ++i) {
+    key = from[i] ^ sign;
+    for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+      ++count[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & mask)];
+    }
+  }
+
+  for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+    shift = pass * RADIX_BITS;
+    start = &count[pass * RADIX_BUCKETS];
+
+    // Nothing moves if every key has the same digit
+    if (start[((from[0] ^ sign) >> shift) & mask] == (unsigned int)n) {
+      continue;
+    }
+
+    // Turn the counts into where each bucket starts
+    total = 0;
+    for (int b = 0; b < RADIX_BUCKETS; ++b) {
+      next = total + start[b];
+      start[b] = total;
+      total = next;
+    }
+
+    // Scatter, a cache line at a time per bucket; order within a bucket is
+    // kept, so each pass is stable
+    fill.assign(RADIX_BUCKETS, 0);
+    for (int i = 0; i < n; ++i) {
+      digit = ((from[i] ^ sign) >> shift) & mask;
+      combine[digit * COMBINE + fill[digit]++] = from[i];
+      if (fill[digit] == COMBINE) {
+	memcpy(into + start[digit], &combine[digit * COMBINE],
+	       COMBINE * sizeof(int));
+	start[digit] += COMBINE;
+	fill[digit] = 0;
+      }
+    }
+    for (int b = 0; b < RADIX_BUCKETS; ++b) {
+      memcpy(into + start[b], &combine[b * COMBINE], fill[b] * sizeof(int));
+    }
+
+    temp = from; from = into; into = temp;
+  }
+
+  if (from != (unsigned int*)&master[0]) { master.swap(scratch); }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts a block of at most NETWORK_SIZE ints with a bitonic sorting network.
+//   With AVX2 the block is sorted in four registers of eight ints each;
+//   otherwise the same network is run with branchless compare-exchanges.
+//   Pre:  list[0, n) with n <= NETWORK_SIZE.
+//   Post: list[0, n) is in ascending order.
+void sortNetwork(int* list, int n) {
+  int block[NETWORK_SIZE]; // Padded with the largest int
+  int width, k;
+
+  for (width = 8; width < n; width *= 2) { }
+  for (k = 0; k < width; ++k) { block[k] = (k < n) ? list[k] : INT_MAX; }
+
+#if defined(__AVX2__)
+  __m256i r0, r1, r2, r3;
+
+  r0 = sort8(_mm256_loadu_si256((const __m256i*)block));
+  if (width >= 16) {
+    r1 = sort8(_mm256_loadu_si256((const __m256i*)(block + 8)));
+    merge16(r0, r1);
+    if (width == 32) {
+      r2 = sort8(_mm256_loadu_si256((const __m256i*)(block + 16)));
+      r3 = sort8(_mm256_loadu_si256((const __m256i*)(block + 24)));
+      merge16(r2, r3);
+      merge32(r0, r1, r2, r3);
+      _mm256_storeu_si256((__m256i*)(block + 16), r2);
+      _mm256_storeu_si256((__m256i*)(block + 24), r3);
+    }
+    _mm256_storeu_si256((__m256i*)(block + 8), r1);
+  }
+  _mm256_storeu_si256((__m256i*)block, r0);
+#else
+  int lo, j;
+
+  // Blocks of size k are sorted alternately up and down, then each bitonic
+  // block is cleaned at distances k / 2 down to 1
+  for (k = 2; k <= width; k *= 2) {
+    for (j = k / 2; j > 0; j /= 2) {
+      for (lo = 0; lo < width; ++lo) {
+	if ((lo ^ j) > lo) {
+	  if ((lo & k) == 0) { exchange(block[lo], block[lo ^ j]); }
+	  else { exchange(block[lo ^ j], block[lo]); }
+	}
+      }
+    }
+  }
+#endif
+
+  memcpy(list, block, n * sizeof(int));
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Tests for the binary list format by its magic number.
+bool isBinary(const char *data, size_t size) {
+  return (size >= sizeof(binaryHeader)) &&
+    (memcmp(data, BINARY_MAGIC, 4) == 0);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Checks the header of a binary list against the size of the file, without
+//   exiting.
+//   Post: Returns NULL with the number of values in 'count', or what is wrong
+//         with the file if the width is unknown or the file is truncated.
+const char *checkBinary(const char *data, size_t size, size_t &count) {
+  binaryHeader header;
+  uint32_t width;
+  uint64_t total;
+
+  memcpy(&header, data, sizeof(header));
+  width = LITTLE32(header.width);
+  total = LITTLE64(header.count);
+
+  if ((width != 4) && (width != 8)) { return "has values of unknown width"; }
+  if ((size - sizeof(header)) / width < total) { return "is truncated"; }
+  count = total;
+  return NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Checks the header of a binary list against the size of the file.
+//   Post: Returns the number of values. Exits if the width is unknown or the
+//         file is truncated.
+size_t binaryCount(const char *data, size_t size) {
+  const char *problem;
+  size_t count;
+
+  problem = checkBinary(data, size, count);
+  if (problem != NULL) {
+    printf("Binary file %s.\nGood Bye!\n", problem);
+    exit(EXIT_FAILURE);
+  }
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Copies values from a binary list into a vector, without exiting.
+//   Pre:  'data' holds a binary list checked by checkBinary().
+//   Post: Values [first, first + count) are appended to 'list'; returns
+//         false if a 64-bit value does not fit in an int.
+bool copyBinary(const char *data, size_t first, size_t count,
+		vector<int> &list) {
+  binaryHeader header;
+  uint32_t width;
+
+  memcpy(&header, data, sizeof(header));
+  width = LITTLE32(header.width);
+  return copyValues(data + sizeof(header) + width * first, count, width,
+		    list);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Copies raw little-endian values, 4 or 8 bytes wide, into a vector, without
+//   exiting.
+//   Post: 'count' values are appended to 'list'; returns false if a 64-bit
+//         value does not fit in an int.
+bool copyValues(const char *values, size_t count, uint32_t width,
+		vector<int> &list) {
+  size_t base = list.size();
+  uint32_t narrow;
+  uint64_t wide;
+  int64_t value;
+
+  list.resize(base + count);
+
+  if (width == 4) {
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(&narrow, values + 4 * i, 4);
+      list[base + i] = (int)LITTLE32(narrow);
+    }
+  }
+  else {
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(&wide, values + 8 * i, 8);
+      value = (int64_t)LITTLE64(wide);
+      if ((value < INT_MIN) || (value > INT_MAX)) { return false; }
+      list[base + i] = (int)value;
+    }
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Copies values from a binary list into a vector.
+//   Pre:  'data' holds a binary list checked by binaryCount().
+//   Post: Values [first, first + count) are appended to 'list'. Exits if a
+//         64-bit value does not fit in an int.
+void readBinary(const char *data, size_t first, size_t count,
+		vector<int> &list) {
+  if (!copyBinary(data, first, count, list)) {
+    printf("Binary file holds a value too large for an int.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Creates output.bin for a binary list.
+//   Post: Returns the file descriptor. Exits if it cannot be opened.
+int createBinary() {
+  int fd;
+
+  fd = open("output.bin", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    printf("Output file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts a binary list of 'count' values on a buffered writer: the header is
+//   written, and the values after it go out as raw ints.
+void writeHeader(writer& out, size_t count) {
+  binaryHeader header;
+
+  memcpy(header.magic, BINARY_MAGIC, 4);
+  header.width = LITTLE32((uint32_t)sizeof(int));
+  header.count = LITTLE64((uint64_t)count);
+
+  memcpy(out.buffer + out.fill, &header, sizeof(header));
+  out.fill += sizeof(header);
+  out.binary = true;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Flushes 'output' and opens output.txt again to append the list after it.
+//   Post: Returns the new file descriptor. Exits if it cannot be opened.
+int appendOutput() {
+  int fd;
+
+  output.flush();
+  fd = open("output.txt", O_WRONLY | O_APPEND);
+  if (fd < 0) {
+    printf("Output file opening failed.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts a buffered writer of text on a file descriptor.
+void openWriter(writer& out, int fd) {
+  out.fd = fd;
+  out.buffer = new char[WRITE_BUFFER];
+  out.fill = 0;
+  out.binary = false;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds an int to a buffered writer: as text on a line of its own, or as a raw
+//   little-endian int for a binary list.
+void writeInt(writer& out, int value) {
+  static const char pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+  char digits[12];       // Filled from the back
+  int at = sizeof(digits);
+  unsigned int left = (value < 0) ? (0u - (unsigned int)value) : value;
+
+  if (out.fill + sizeof(digits) > WRITE_BUFFER) { flushWriter(out); }
+
+  if (out.binary) {
+    uint32_t raw = LITTLE32((uint32_t)value);
+    memcpy(out.buffer + out.fill, &raw, sizeof(raw));
+    out.fill += sizeof(raw);
+    return;
+  }
+
+  // Two digits at a time from the table, then the last one or two
+  digits[--at] = '\n';
+  while (left >= 100) {
+    const char *pair = pairs + 2 * (left % 100);
+    left /= 100;
+    digits[--at] = pair[1];
+    digits[--at] = pair[0];
+  }
+  if (left >= 10) {
+    digits[--at] = pairs[2 * left + 1];
+    digits[--at] = pairs[2 * left];
+  }
+  else { digits[--at] = '0' + left; }
+  if (value < 0) { digits[--at] = '-'; }
+
+  memcpy(out.buffer + out.fill, digits + at, sizeof(digits) - at);
+  out.fill += sizeof(digits) - at;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes out whatever a buffered writer holds. Exits if the write fails.
+void flushWriter(writer& out) {
+  size_t done = 0;
+  ssize_t wrote;
+
+  while (done < out.fill) {
+    wrote = write(out.fd, out.buffer + done, out.fill - done);
+    if (wrote < 0) {
+      if (errno == EINTR) { continue; }
+      printf("Output file writing failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    done += wrote;
+  }
+  out.fill = 0;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Flushes a buffered writer and frees its buffer; the descriptor stays open.
+void closeWriter(writer& out) {
+  flushWriter(out);
+  delete [] out.buffer;
+  out.buffer = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting) {
+#ifdef __linux__
+  static const unsigned long long config[COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+  struct perf_event_attr attr;
+#endif
+
+  prof.phases.clear();
+  for (int k = 0; k < COUNTERS; ++k) {
+    prof.fd[k] = -1;
+#ifdef __linux__
+    if (!counting) { continue; }
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[k];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count the threads started later too
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    prof.fd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name) {
+  phase fresh;   // A phase not seen before
+  size_t i;
+
+  for (i = 0; i < prof.phases.size(); ++i) {
+    if (strcmp(prof.phases[i].name, name) == 0) { break; }
+  }
+  if (i == prof.phases.size()) {
+    fresh.name = name;
+    fresh.seconds = 0;
+    for (int k = 0; k < COUNTERS; ++k) {
+      fresh.count[k] = (prof.fd[k] < 0) ? -1 : 0;
+    }
+    prof.phases.push_back(fresh);
+  }
+  prof.current = i;
+
+  for (int k = 0; k < COUNTERS; ++k) { prof.base[k] = readCounter(prof.fd[k]); }
+  clock_gettime(CLOCK_MONOTONIC, &prof.start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof) {
+  struct timespec stop;
+  phase &done = prof.phases[prof.current];
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  done.seconds += (stop.tv_sec - prof.start.tv_sec) +
+    (stop.tv_nsec - prof.start.tv_nsec) / 1e9;
+  for (int k = 0; k < COUNTERS; ++k) {
+    if (prof.fd[k] >= 0) {
+      done.count[k] += readCounter(prof.fd[k]) - prof.base[k];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd) {
+  unsigned long long value[3]; // Count, time enabled and time running
+
+  if ((fd < 0) || (read(fd, value, sizeof(value)) != sizeof(value))) {
+    return 0;
+  }
+  if ((value[2] == 0) || (value[2] >= value[1])) { return value[0]; }
+  return (long long)((double)value[0] * value[1] / value[2]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json) {
+  if (json) {
+    fflush(stdout);
+    fprintf(stderr, "{\"tool\": \"mergeSort\", \"phases\": [");
+    for (size_t i = 0; i < prof.phases.size(); ++i) {
+      fprintf(stderr, "%s{\"name\": \"%s\", \"seconds\": %.6f",
+	      i ? ", " : "", prof.phases[i].name, prof.phases[i].seconds);
+      for (int k = 0; k < COUNTERS; ++k) {
+	if (prof.phases[i].count[k] < 0) {
+	  fprintf(stderr, ", \"%s\": null", counterNames[k]);
+	}
+	else {
+	  fprintf(stderr, ", \"%s\": %lld", counterNames[k],
+		  prof.phases[i].count[k]);
+	}
+      }
+      fprintf(stderr, "}");
+    }
+    fprintf(stderr, "]}\n");
+    return;
+  }
+
+  printf("%-10s %12s", "Phase", "Seconds");
+  for (int k = 0; k < COUNTERS; ++k) { printf(" %14s", counterNames[k]); }
+  printf("\n");
+  for (size_t i = 0; i < prof.phases.size(); ++i) {
+    printf("%-10s %12.6f", prof.phases[i].name, prof.phases[i].seconds);
+    for (int k = 0; k < COUNTERS; ++k) {
+      if (prof.phases[i].count[k] < 0) { printf(" %14s", "n/a"); }
+      else { printf(" %14lld", prof.phases[i].count[k]); }
+    }
+    printf("\n");
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Prints out instructions on the use of command line options.
 void usage() {
   printf("Flags:\n"
+	 "\t-a\t\tSort adaptively, merging the runs already in the list\n"
+	 "\t-b\t\tMerge without branches\n"
+	 "\t-e <MB>\t\tSort externally, within this much memory\n"
+	 "\t-g <grain>\tLongest range sorted by one thread (-p)\n"
+	 "\t-B\t\tWrite the sorted list to output.bin, in binary\n"
 	 "\t-h\t\tPrints this message.\n"
-	 "\t-v\t\tPrint diagnostic info\n"
+	 "\t-i\t\tSort iteratively, from the bottom up\n"
+	 "\t-j\t\tPrint the time and counters of each phase as JSON,\n"
+	 "\t\t\ton standard error\n"
+	 "\t-k <list>\tMerge the sorted files named in a manifest, or\n"
+	 "\t\t\tmatching a quoted pattern; -p sets the threads\n"
+	 "\t\t\tand -e the memory in MB\n"
+	 "\t-m <list>\tSort each file named in a manifest, or matching a\n"
+	 "\t\t\tquoted pattern, into <file>.sorted; -p sets the\n"
+	 "\t\t\tthreads and -e the memory in MB\n"
+	 "\t-p <threads>\tSort in parallel with this many threads; not with\n"
+	 "\t\t\t-a or -i\n"
+	 "\t-r\t\tRadix sort instead\n"
+	 "\t-s\t\tSort standard input to standard output\n"
+	 "\t-v\t\tPrint diagnostic info, with the time and counters of\n"
+	 "\t\t\teach phase\n"
 	 "<input_file_name> \tIf you would like to supply an input file name,\n"
 	 "\t\t\tyou may do so here, otherwise, the program will ask for it.\n\n");
 }
@@ -13,12 +13,20 @@
 // the program will try and find an intersection, meaning it is a closed 
 // polygon, but not a convex one.
 //
+//   With -m, the polygons named in a manifest, or matching a quoted pattern,
+// are checked at once on a pool of threads, and the verdict on each is
+// written to a file named after it with .hull added. Polygons wait for
+// memory while those being checked would need more than a gigabyte between
+// them, and a summary of the throughput is printed at the end.
+//
 // Invariant
 //------------------------------------------------------------------------------
 //   The file input is formated as follows: The vertices  appear first, then a
 // dash (-) and then the edges. Each vertices/edge/dash appear on a line by 
 // themselves. The vertices and edges are defined as follows: (#,#) where #
-// is a single digit (0-9).
+// is a number of any number of digits; an edge names two vertices by their
+// place in the list, from 0. The file is read in place, without a copy of
+// its text.
 //
 // References
 //------------------------------------------------------------------------------
@@ -47,21 +55,33 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 // Libraries
+#include <algorithm> // sort(), unique()
 #include <cassert>  // Assert statements
 #include <cctype>   // type checking
+#include <climits>  // INT_MAX
 #include <cmath>    // For distance calculations
 #include <cstdio>   // cin, cout
 #include <cstdlib>  // EXIT_SUCCESS and things
-#include <fstream>  // File Stream
+#include <cstring>  // strcmp(), memset(), memcpy()
+#include <ctime>    // clock_gettime()
+#include <fcntl.h>  // open()
+#include <fstream>  // Batch manifest
+#include <glob.h>   // Batch patterns
 #include <iostream> // printf() etc...
+#include <pthread.h> // Batch threads
 #include <stack>    // Stack container
+#include <stdint.h> // uint64_t
 #include <string>   // String class
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
 #include <unistd.h> 
-#include <queue>    // Queue Container
 #include <vector>   // Vector Container
+#ifdef __linux__
+#include <linux/perf_event.h> // Hardware counters
+#include <sys/syscall.h>       // perf_event_open()
+#endif
 
 using namespace std;
-ifstream input;
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -69,90 +89,180 @@ ifstream input;
 // A vertex is a point on the Cartisian plane, defined with a x- and y-value.
 struct vertex { double x, y; };
 
-// Maximum number of points allowed
-#define MAXPOINTS 10
-
 // A vecter of vertexes
 typedef vector<vertex> vset; 
 
+// The edges of a polygon in compressed sparse row form. The neighbors of
+//   vertex v are neighbor[offset[v]] through neighbor[offset[v + 1] - 1], and
+//   each edge is listed under both of its ends.
+struct csr {
+  int vertices;          // Number of vertices
+  vector<int> offset;    // Where each vertex's neighbors begin; one extra
+  vector<int> neighbor;  // Neighbors of every vertex, one after another
+};
+
+// A polygon file mapped into memory and read in place, a record at a time,
+//   with no copy of its text.
+struct edgeReader {
+  const char *data;   // Contents of the file, or NULL if it is empty
+  size_t size;        // Size of the file
+  const char *next;   // Where reading resumes
+  const char *edges;  // Start of the first edge, after the dash
+  const char *end;    // One past the last character
+};
+
 // For debugging informaiton
 bool verbose = false;
+
+// The verdicts on a polygon, as reported
+enum { CONVEX, NON_CONVEX, NOT_POLYGON };
+const char *verdicts[3] = { "The figure is a convex polygon.",
+			    "The figure is a polygon, but it is non-convex.",
+			    "The figure is not a polygon." };
+
+// Batch check: memory held by all polygons at once, in MB; and the memory a
+//   polygon is taken to need, per byte of its file
+#define BATCH_BUDGET 1024
+#define BATCH_FACTOR 4
+
+// Shared by the threads of a batch check: the polygons still to be checked,
+//   the memory they may hold between them, and the totals for the summary.
+struct batch {
+  vector<string> names;    // Polygon files
+  size_t next;             // Next file to be handed out
+  size_t budget, held;     // Bytes the polygons may hold at once, and do hold
+  long long points;        // Points read
+  long long bytes;         // Bytes read
+  int convex;              // Polygons found convex
+  int failed;              // Polygons that could not be checked
+  pthread_mutex_t lock;    // Guards all of the above that changes
+  pthread_cond_t freed;    // Signalled as a polygon gives back its memory
+};
+
+// Profile: hardware counters read around each phase, named in counterNames
+#define COUNTERS 4
+
+// Names of the hardware counters of a profile, as reported
+const char *counterNames[COUNTERS] = { "cycles", "instructions",
+				       "branch-misses", "llc-misses" };
+
+// Wall time and hardware counters of one phase of the program. A phase run
+//   more than once adds up.
+struct phase {
+  const char *name;          // As reported
+  double seconds;            // Wall time
+  long long count[COUNTERS]; // Counted events; -1 where unavailable
+};
+
+// Timing of a run: the counters, the phase under way and those seen so far.
+struct profile {
+  int fd[COUNTERS];          // From perf_event_open(), or -1
+  long long base[COUNTERS];  // Counts when the current phase started
+  struct timespec start;     // Time when it started
+  size_t current;            // Its place in 'phases'
+  vector<phase> phases;      // In the order first started
+};
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Declarations
+// Checks many polygons at once, each on a thread of its own.
+// Pre:  The files of the batch and the number of threads.
+// Post: The verdict on each polygon is written to a file named after it with
+//       ".hull" added. Polygons wait for memory while those being checked
+//       would need more than BATCH_BUDGET between them. A summary of the
+//       throughput is printed.
+void batchHull(batch& job, int count);
+
+// Body of each batch thread; checks polygons until none are left.
+void* batchLoop(void* arg);
+
 // Makes sure there is at least two edges contected to the point in question.
-// Pre:  'test' is the entire set of points in the polygon, 'adj' is the
-//       adjacency matrix and 'point' is the index of the point in question.
+// Pre:  'adj' is the edges of the polygon and 'point' is the index of the
+//       point in question.
 // Post: Returns 'true' if the point has two or more edges connected, 'fasle' 
 //       otherwise.
-bool checkEdges(vset test, vector< vector<int> >& adj, int point);
-
-// Calculates the perpendicular distance between a point and a line.
-// Pre:  'a', 'b' and 'c' are coefficiants to a linear function and 'x' and 'y'
-//       is the point in question.
-// Post: The perpendiculaer distance from the point to the line is returned.
-double dist(int a, int b, int c, int x, int y);
+bool checkEdges(const csr& adj, int point);
+
+// Tests for an edge between two points.
+// Pre:  'adj' is the edges of the polygon and 'x' and 'y' are two points.
+// Post: Returns true if there is an edge between the two.
+bool hasEdge(const csr& adj, int x, int y);
+
+// Finds which side of a line a point is on, exactly. With whole coordinates
+//   below 2^31 the products fit a long long, where the coefficiants of the
+//   line would overflow an int.
+// Pre:  'alpha' and 'beta' are the endpoints of a line and 'point' is the
+//       point in question, all with whole coordinates.
+// Post: Returns a*x + b*y - c for the line a*x + b*y = c through alpha and
+//       beta: positive to the side split() keeps, and growing with the
+//       perpendicular distance from the line.
+long long side(vertex alpha, vertex beta, vertex point);
 
 // Implements the main part of the quickHull algorithm. Using recursion, 
 //   the function takes a line (defined between alpha and beta) and finds
 //   the farthest point from the line. It then repeats with the line defined
 //   between alpha and the farthest point. Once all the points are found, 
-//   the convex hull is held within the vset hull.
-// Pre:  'testSet' is the set of points to be analyzed, 'alpha' and 'beta' are
-//       the endpoints of the line and 'hull' is the solution set.
-// Post: The solution has been filled into the set 'hull'
-void findHull(vset testSet, vertex alpha, vertex beta, vset& hull);
+//   the convex hull is held within hull, in order around it.
+// Pre:  'points' is the polygon, 'testSet' the indices of the points to be
+//       analyzed, 'alpha' and 'beta' are the indices of the endpoints of the
+//       line and 'hull' is the solution so far, ending with alpha.
+// Post: The points of the hull between alpha and beta have been added to
+//       'hull', in order.
+void findHull(const vset& points, const vector<int>& testSet,
+	      int alpha, int beta, vector<int>& hull);
 
 // Finds the point in the set that is farthest from the line. (most likely
 //   on the convex hull.) 
-// Pre:  'alpha' and 'beta' are the endpoints of a line and 'sample' is the
-//       set to coose the point in.
-// Post: The vertex of the point perpendicularly farthest from the line
+// Pre:  'alpha' and 'beta' are the indices of the endpoints of a line and
+//       'sample' is the indices of the points to coose from.
+// Post: The index of the point perpendicularly farthest from the line
 //       alpha->beta.
-vertex findThird(vset sample, vertex alpha, vertex beta);
+int findThird(const vset& points, const vector<int>& sample,
+	      int alpha, int beta);
 
-// Inserts the vertex toAdd right after the addAfter vertex
-// Pre:  Vertex 'toAdd' is a point to be added after the point 'addAfter' in
-//       the set 'hull'.
-// Post: 'toAdd' has been added to the right location after 'addAfter' in the
-//       set 'hull'.
-void insert(vset& hull, vertex addAfter, vertex toAdd);
+// Checks one polygon of a batch, reporting rather than exiting on bad input.
+// Pre:  The batch, the name of the file and the file, mapped.
+// Post: The verdict is written to the ".hull" file. Returns false if the
+//       polygon could not be read or the file written; 'vertices' holds the
+//       number of points read.
+bool hullFile(batch& job, const string& name, edgeReader& poly,
+	      int& vertices);
 
 // Finds a point if an intersection occurs.
 // Pre:  'test' is the set of all points in the polygon and 'adj' is the 
-//       adjacency matrix.
+//       edges of the polygon.
 // Post: If an intersection is found, it is added to the avaible points,
-//       the adjacency matrix is updated and returns true. Returns false
-//       if unable to find an intersection.
-bool intersect(vset& test, vector< vector<int> >& adj);
+//       the two edges crossing there are replaced by four to it and returns
+//       true. Returns false if unable to find an intersection.
+bool intersect(vset& test, csr& adj);
 
 // Tests whether the polygon is a convex polygon
-// Pre:  'test' is the polygon in question and 'adj' is the adjacency matrix 
-//       for the polygon.
+// Pre:  'test' is the polygon in question and 'adj' is the edges of the
+//       polygon.
 // Post: Returns true if the polygon is convex, 'false' otherwise.
-bool isConvex(vset test, vector< vector<int> >& adj);
-
-// Tests if the 'point' is actually on the line segments
-// Pre:  'test' is all the points in the polygon, 'alpha' and 'beta' are
-//       endpoints for one line and 'gamma' and 'delta' for another, and
-//       'point' is the vertex in question.
-// Post: Returns true if the point is within the polygon, on the line
-//       alpha->beta and on the line gamma->delta. Returns false if 
+bool isConvex(const vset& test, const csr& adj);
+
+// Tests if the lines alpha->beta and gamma->delta actually cross, exactly,
+//   by which side of each line the ends of the other are on.
+// Pre:  'alpha' and 'beta' are endpoints for one line and 'gamma' and
+//       'delta' for another, all with whole coordinates.
+// Post: Returns true if the lines are not parallel and meet on both line
+//       segments, at a point that is not one of the end points, and stores
+//       that point, which need not be whole, in 'point'. Returns false if
 //       any of those conditions fails.
-bool isCorrect(vset test, vertex alpha, vertex beta, 
-	       vertex gamma, vertex delta, vertex point);
+bool isCorrect(vertex alpha, vertex beta, vertex gamma, vertex delta,
+	       vertex& point);
 
 // Checks if there is an edge missing from the actual polygon and the convex 
 //   hull solution. This function also returns, thru the reference calls, the
 //   two points where the edge is missing.
 // Pre:  'first' and 'second' are empty, 'test' is the set of points for the 
-//       polygon and 'adj' is the adjacency matrix.
+//       polygon and 'adj' is the edges of the polygon.
 // Post: Returns true if there is a descrepancy between the polygon and the
 //       convex hull solution. The indicies for the endpoints where the line 
 //       should appear are filled into 'first' and 'second'.
-bool isMissingEdge(vset test, vector< vector<int> >& adj,
-		   int& first, int& second);
+bool isMissingEdge(const vset& test, const csr& adj, int& first, int& second);
 
 // Tests for the 'exit' or 'quit' command.
 // Pre:  A string with the user input is passed in.
@@ -160,54 +270,105 @@ bool isMissingEdge(vset test, vector< vector<int> >& adj,
 //       the function returns true.
 bool isQuit(const string& expr);
 
-// Imports the polygon from a file and adds to a queue
+// Lists the polygons of a batch: the names in a manifest, one per line, or
+//   the matches of a wildcard pattern.
+// Post: The names are added to 'names'. Exits if none are found.
+void listBatch(string source, vector<string>& names);
+
+// Maps the polygon file into memory, to be read in place.
 // Pre:  'fp' is the file name where the polygon is stored.
-// Post: The contents of the file are imported into the queue 'poly'.
-bool loadPoly(string fp, queue<string>& poly);
+// Post: The file is mapped and 'poly' is left at its start. Returns false if
+//       it cannot be read.
+bool loadPoly(string fp, edgeReader& poly);
+
+// Maps a polygon file into memory for reading.
+//   Pre:  The name of the file and the reader to open.
+//   Post: Returns false if the file cannot be read.
+bool openEdges(string fp, edgeReader& in);
+
+// Reads the next record of a polygon file: the characters up to a space or
+//   the end of a line, holding numbers of any width separated by commas, and
+//   perhaps within parentheses, as in (x,y).
+//   Pre:  Room for 'fields' numbers in 'value'.
+//   Post: Returns 1 with the numbers stored in 'value', 0 at the end of the
+//         file, or -1 if the record is not 'fields' numbers of that form.
+int nextRecord(edgeReader& in, int fields, int *value);
+
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned. A run too long for an int stops early
+//         with 'value' above INT_MAX.
+const char *parseDigits(const char *next, const char *end, uint64_t &value);
+
+// Goes back to the first edge of a polygon file, to read the edges again.
+void rewindEdges(edgeReader& in);
+
+// Unmaps a polygon file.
+void closeEdges(edgeReader& in);
 
 // Used to find the farthest east (or largest) x vertex
 // Pre:  The set of points in the polygon.
 // Post: The index of the farthest east point in the polygon (largest x-value)
-int maxExtreme(vset points);
+int maxExtreme(const vset& points);
 
 // Used to find the farthest west (or smallest) x vertex
 // Pre:  The set of points in the polygon.
 // Post: The index of the farthest west point in the polygon (smallest x-value)
-int minExtreme(vset points);
-
-// Used to find the farthest north (or largest) y vertex
-// Pre:  The set of points in the polygon.
-// Post: The index of the farthest north point in the polygon (largest y-value)
-int maxExtremeY(vset points);
+int minExtreme(const vset& points);
 
-// Used to find the farthest south (or smallest) y vertex
-// Pre:  The set of points in the polygon.
-// Post: The index of the farthest south point in the polygon (smallest y-value)
-int minExtremeY(vset points);
+// Prints the neighbors of each vertex
+// Pre:  'adj' is the edges of the polygon.
+void printAdj(const csr& adj);
 
-// Prints Adjacency Matrix
-// Pre:  Size of adjacency matrix is length by length.
-void printAdj(int length, vector< vector<int> > adj);
-
-// Create the adjacency matrix for the polygon and add the points to a vector
+// Reads the points of the polygon into a vector and its edges into 'adj'
 // Pre:  The 'points', 'adj', 'vertices' and 'edges' have not been assigned
-//       values. The queue 'poly' is the unprocessed input from the file.
-// Post: An adjacency matrix of the edges in the polygon, the number of edges
-//       and verticies, and a set of all the points are filled in.
-bool processInput(queue<string>& poly, vector< vector<int> >& adj,
-		  vset& points, int& vertices, int& edges);
+//       values. 'poly' is the file, mapped and at its start.
+// Post: The edges of the polygon, in compressed sparse row form, the number
+//       of edges and verticies, and a set of all the points are filled in.
+//       The edges are read twice: once to count each vertex's neighbors and
+//       once to place them. Returns false on bad input.
+bool processInput(edgeReader& poly, csr& adj, vset& points,
+		  int& vertices, int& edges);
 
 // Sets up the inital environment for the quickHull search
 // Pre:  The set of all the vertices in the polygon.
-// Post: A convex hull solution is returned.
-vset quickHull (vset sample);
+// Post: The indices of the points of the convex hull are returned, in order
+//       around it.
+vector<int> quickHull(const vset& sample);
 
 // Splits the set of points into two sets, one above the line and one below
-// Pre:  'alpha' and 'beta' are the endpoints of a line and 'sample' is the 
-//       available points to be sorted.
-// Post: Returns a subset of 'sample' where all the points are to the left of
-//       the directed line, alpha->beta.v
-vset split(vertex alpha, vertex beta, vset sample);
+// Pre:  'alpha' and 'beta' are the indices of the endpoints of a line and
+//       'sample' is the indices of the available points to be sorted.
+// Post: Returns the indices of those of 'sample' to the left of the directed
+//       line, alpha->beta.
+vector<int> split(const vset& points, int alpha, int beta,
+		  const vector<int>& sample);
+
+// Decides what the figure is: a convex polygon, a polygon that is not
+//   convex, or not a polygon.
+// Pre:  'points' and 'adj' are the polygon as read.
+// Post: Returns CONVEX, NON_CONVEX or NOT_POLYGON, the verdict's place in
+//       'verdicts'. An intersection found is added to the polygon.
+int verdict(vset& points, csr& adj);
+
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting);
+
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name);
+
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof);
+
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd);
+
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json);
 
 // Prints out instructions on the use of command line options.
 void usage();
@@ -220,17 +381,33 @@ int main(int argc, char **argv) {
   int vertices, edges;
   string command;
   stack<int> results;
-  queue<string> poly;
-  vector< vector<int> > adj;
+  edgeReader poly = { NULL, 0, NULL, NULL, NULL };
+  csr adj;
   vset points;
+  bool loaded;        // Whether the polygon was read
+  bool json = false;  // Profile as JSON
+  profile prof;       // Time and counters of each phase
+  string manifest;    // Polygons to check in a batch
+  int count = 0;      // Threads for the batch
+  batch job;          // The batch check
 
   vertices = edges = 0;
 
   printf("Welcome to Torchwood, Division of Software!\n");
 
   // Parse the line
-  while ((c = getopt(argc, argv, "v")) != EOF) {
+  while ((c = getopt(argc, argv, "jm:p:v")) != EOF) {
     switch (c) {
+    case 'j': // Profile as JSON.
+      json = true;
+      break;
+    case 'm': // Batch of polygons, from a manifest or pattern.
+      manifest = optarg;
+      break;
+    case 'p': // Threads for the batch.
+      count = atoi(optarg);
+      if (count < 1) { count = 1; }
+      break;
     case 'v': // Print Diagnostic information.
       verbose = true;
       break;
@@ -240,40 +417,52 @@ int main(int argc, char **argv) {
   }
   if (verbose) { printf("Verbose turned on.\n"); }
 
+  // A batch checks each of its polygons straight to its own output
+  if (!manifest.empty()) {
+    listBatch(manifest, job.names);
+    if (count == 0) { count = sysconf(_SC_NPROCESSORS_ONLN); }
+    batchHull(job, count);
+    printf("Thank you!\n");
+    return (job.failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+  openProfile(prof, verbose || json);
+
   do {
     printf("Please enter the name of the input file: ");
     cin >> command;
 
     if (!isQuit(command)) {
       if (verbose) { printf("Didn't quit...\n"); }
-      if (loadPoly(command, poly)) {
+      startPhase(prof, "ingest");
+      loaded = loadPoly(command, poly) &&
+	processInput(poly, adj, points, vertices, edges);
+      closeEdges(poly);
+      endPhase(prof);
+      if (loaded) {
 	if (verbose) { printf("Loaded poly...\n"); }
-	if (processInput(poly, adj, points, vertices, edges)) {
-	  
-	  // Debugging information
-	  if (verbose) { 
-	    printf("Vertices = %i, Edges = %i\n", vertices, edges);
-
-	    for (int i = 0; i < vertices; ++i) {
-	      printf("Vertex: (%.2f, %.2f)\n", points[i].x, points[i].y);
-	    }
-	    printAdj(vertices, adj);
-	    
+
+	// Debugging information
+	if (verbose) { 
+	  printf("Vertices = %i, Edges = %i\n", vertices, edges);
+
+	  for (int i = 0; i < vertices; ++i) {
+	    printf("Vertex: (%.2f, %.2f)\n", points[i].x, points[i].y);
 	  }
-	  
-	  // Results
-	  if (isConvex(points, adj))
-	    printf("The figure is a convex polygon.\n");
-	  else if (intersect(points, adj))
-	    printf("The figure is a polygon, but it is non-convex.\n");
-	  else
-	    printf("The figure is not a polygon.\n");
+	  printAdj(adj);
+
 	}
+
+	// Results
+	startPhase(prof, "hull");
+	printf("%s\n", verdicts[verdict(points, adj)]);
+	endPhase(prof);
       }
     }
   }
   while(!isQuit(command));
-  
+
+  if (verbose) { reportProfile(prof, false); }
+  if (json) { reportProfile(prof, true); }
   printf("Thank you!\n");
   
   return EXIT_SUCCESS;
@@ -283,37 +472,153 @@ int main(int argc, char **argv) {
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 
+////////////////////////////////////////////////////////////////////////////////
+// Checks many polygons at once, each on a thread of its own.
+// Pre:  The files of the batch and the number of threads.
+// Post: The verdict on each polygon is written to a file named after it with
+//       ".hull" added. Polygons wait for memory while those being checked
+//       would need more than BATCH_BUDGET between them. A summary of the
+//       throughput is printed.
+void batchHull(batch& job, int count) {
+  vector<pthread_t> pool;  // The batch threads
+  struct timespec start;   // When the batch started
+  struct timespec stop;    // And when it finished
+  double seconds;          // Time taken
+
+  job.next = 0;
+  job.budget = (size_t)BATCH_BUDGET << 20;
+  job.held = 0;
+  job.points = job.bytes = 0;
+  job.convex = job.failed = 0;
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.freed, NULL);
+
+  // No more threads than polygons
+  if ((size_t)count > job.names.size()) { count = job.names.size(); }
+  pool.resize(count);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < count; ++i) {
+    pthread_create(&pool[i], NULL, batchLoop, &job);
+  }
+  for (int i = 0; i < count; ++i) { pthread_join(pool[i], NULL); }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  if (seconds <= 0) { seconds = 1e-9; }
+
+  printf("Files:\t\t%lu (%i failed)\n"
+	 "Convex:\t\t%i\n"
+	 "Points:\t\t%lld\n"
+	 "Threads:\t%i\n"
+	 "Seconds:\t%.3f\n"
+	 "Throughput:\t%.1f files/s, %.0f points/s, %.1f MB/s\n",
+	 (unsigned long)job.names.size(), job.failed, job.convex, job.points,
+	 count, seconds, job.names.size() / seconds, job.points / seconds,
+	 job.bytes / seconds / (1 << 20));
+
+  pthread_cond_destroy(&job.freed);
+  pthread_mutex_destroy(&job.lock);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Body of each batch thread; checks polygons until none are left.
+void* batchLoop(void* arg) {
+  batch *job = (batch *)arg;
+  string name;        // Polygon being checked
+  edgeReader poly = { NULL, 0, NULL, NULL, NULL };
+  size_t bytes;       // Size of its file
+  size_t need;        // Memory it is taken to need
+  int vertices;       // Its number of points
+  bool checked;       // Whether it was checked
+
+  while (true) {
+    pthread_mutex_lock(&job->lock);
+    if (job->next == job->names.size()) {
+      pthread_mutex_unlock(&job->lock);
+      break;
+    }
+    name = job->names[job->next++];
+    pthread_mutex_unlock(&job->lock);
+
+    // Wait for memory, once the file is open; a polygon larger than the
+    //   budget runs on its own
+    checked = loadPoly(name, poly);
+    bytes = poly.size;
+    need = 0;
+    vertices = 0;
+    if (checked) {
+      need = bytes * BATCH_FACTOR;
+      pthread_mutex_lock(&job->lock);
+      while ((job->held > 0) && (job->held + need > job->budget)) {
+	pthread_cond_wait(&job->freed, &job->lock);
+      }
+      job->held += need;
+      pthread_mutex_unlock(&job->lock);
+
+      checked = hullFile(*job, name, poly, vertices);
+    }
+    closeEdges(poly);
+    if (!checked) { printf("%s: could not be checked.\n", name.c_str()); }
+
+    pthread_mutex_lock(&job->lock);
+    job->held -= need;
+    if (checked) {
+      job->points += vertices;
+      job->bytes += bytes;
+    }
+    else { ++job->failed; }
+    pthread_cond_broadcast(&job->freed);
+    pthread_mutex_unlock(&job->lock);
+  }
+  return NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // Makes sure there is at least two edges contected to the point in question.
-// Pre:  'test' is the entire set of points in the polygon, 'adj' is the
-//       adjacency matrix and 'point' is the index of the point in question.
+// Pre:  'adj' is the edges of the polygon and 'point' is the index of the
+//       point in question.
 // Post: Returns 'true' if the point has two or more edges connected, 'fasle' 
 //       otherwise.
-bool checkEdges(vset test, vector< vector<int> >& adj, int point) {
-  int count = 0;            // Number of Edges
-  int length = test.size(); // Save Memeory Call
-
-  for (int i = 0; i < length; ++i) {
-    if (adj[point][i] == 1) { count++; }
-  }
-  if (count < 2) { return false; }
+bool checkEdges(const csr& adj, int point) {
+  // Number of Edges
+  if ((adj.offset[point + 1] - adj.offset[point]) < 2) { return false; }
 
   return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Calculates the perpendicular distance between a point and a line.
-// Pre:  'a', 'b' and 'c' are coefficiants to a linear function and 'x' and 'y'
-//       is the point in question.
-// Post: The perpendiculaer distance from the point to the line is returned.
-double dist(int a, int b, int c, int x, int y) {
-  double numer, denom;
- 
-  numer = abs(a*x + b*y - c);
-  denom = sqrt(a*a + b*b);
+// Tests for an edge between two points.
+// Pre:  'adj' is the edges of the polygon and 'x' and 'y' are two points.
+// Post: Returns true if there is an edge between the two.
+bool hasEdge(const csr& adj, int x, int y) {
+  for (int i = adj.offset[x]; i < adj.offset[x + 1]; ++i) {
+    if (adj.neighbor[i] == y) { return true; }
+  }
+  return false;
+}
+////////////////////////////////////////////////////////////////////////////////
 
-  return numer/denom;
+////////////////////////////////////////////////////////////////////////////////
+// Finds which side of a line a point is on, exactly. With whole coordinates
+//   below 2^31 the products fit a long long, where the coefficiants of the
+//   line would overflow an int.
+// Pre:  'alpha' and 'beta' are the endpoints of a line and 'point' is the
+//       point in question, all with whole coordinates.
+// Post: Returns a*x + b*y - c for the line a*x + b*y = c through alpha and
+//       beta: positive to the side split() keeps, and growing with the
+//       perpendicular distance from the line.
+long long side(vertex alpha, vertex beta, vertex point) {
+  long long a, b; // Coefficiants of the line, relative to alpha
+
+  a = (long long)beta.y - (long long)alpha.y;
+  b = (long long)alpha.x - (long long)beta.x;
+
+  return a * ((long long)point.x - (long long)alpha.x) +
+    b * ((long long)point.y - (long long)alpha.y);
 }
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -322,57 +627,59 @@ double dist(int a, int b, int c, int x, int y) {
 //   the function takes a line (defined between alpha and beta) and finds
 //   the farthest point from the line. It then repeats with the line defined
 //   between alpha and the farthest point. Once all the points are found, 
-//   the convex hull is held within the vset hull.
-// Pre:  'testSet' is the set of points to be analyzed, 'alpha' and 'beta' are
-//       the endpoints of the line and 'hull' is the solution set.
-// Post: The solution has been filled into the set 'hull'
-void findHull(vset testSet, vertex alpha, vertex beta, vset& hull) {
-  vertex gamma;
-  vset left, right;
+//   the convex hull is held within hull, in order around it.
+// Pre:  'points' is the polygon, 'testSet' the indices of the points to be
+//       analyzed, 'alpha' and 'beta' are the indices of the endpoints of the
+//       line and 'hull' is the solution so far, ending with alpha.
+// Post: The points of the hull between alpha and beta have been added to
+//       'hull', in order.
+void findHull(const vset& points, const vector<int>& testSet,
+	      int alpha, int beta, vector<int>& hull) {
+  int gamma;
+  vector<int> outside;
 
   // Base case
   if (testSet.empty()) { return; }
 
-  // Find the point farthest from the line and add to the convex hull
-  gamma = findThird(testSet, alpha, beta);
-  insert(hull, alpha, gamma);
-
-  // Split into three sets, inside the triangle, to the left and to the right
-  left = split(alpha, gamma, testSet);
-  right = split(gamma, beta, testSet);
-
-  // Recurse through the rest of the sets
-  findHull(left, alpha, gamma, hull);
-  findHull(right, gamma, beta, hull);
+  // Find the point farthest from the line; it is on the convex hull
+  gamma = findThird(points, testSet, alpha, beta);
+
+  // Points inside the triangle are dropped. Those to the left of alpha->gamma
+  //   come before gamma on the hull, and those to the right of gamma->beta
+  //   after it, so each set is only held while it is searched.
+  outside = split(points, alpha, gamma, testSet);
+  findHull(points, outside, alpha, gamma, hull);
+  hull.push_back(gamma);
+  outside = split(points, gamma, beta, testSet);
+  findHull(points, outside, gamma, beta, hull);
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Finds the point in the set that is farthest from the line. (most likely
 //   on the convex hull.) 
-// Pre:  'alpha' and 'beta' are the endpoints of a line and 'sample' is the
-//       set to coose the point in.
-// Post: The vertex of the point perpendicularly farthest from the line
+// Pre:  'alpha' and 'beta' are the indices of the endpoints of a line and
+//       'sample' is the indices of the points to coose from.
+// Post: The index of the point perpendicularly farthest from the line
 //       alpha->beta.
-vertex findThird(vset sample, vertex alpha, vertex beta) {
-  int a, b, c, length, max;
-  double maxD, test;
+int findThird(const vset& points, const vector<int>& sample,
+	      int alpha, int beta) {
+  int length, max;
+  long long maxD, test;
 
   // Set length
   length = sample.size();
   
-  // Find coefficiants
-  a = beta.y - alpha.y;
-  b = alpha.x - beta.x;
-  c = alpha.x*beta.y - alpha.y*beta.x;
-  
   max = 0;
+  maxD = side(points[alpha], points[beta], points[sample[max]]);
 
   // Find third coordinate
   for (int i = 1; i < length; ++i) {
-    maxD = dist(a, b, c, sample[max].x, sample[max].y);
-    test = dist(a, b, c, sample[i].x, sample[i].y);
-    if (maxD < test) { max = i; }
+    test = side(points[alpha], points[beta], points[sample[i]]);
+    if (maxD < test) {
+      max = i;
+      maxD = test;
+    }
   }
 
   return sample[max];
@@ -380,45 +687,50 @@ vertex findThird(vset sample, vertex alpha, vertex beta) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Inserts the vertex toAdd right after the addAfter vertex
-// Pre:  Vertex 'toAdd' is a point to be added after the point 'addAfter' in
-//       the set 'hull'.
-// Post: 'toAdd' has been added to the right location after 'addAfter' in the
-//       set 'hull'.
-void insert(vset& hull, vertex addAfter, vertex toAdd) {
-  vset temp;
-  int length = hull.size();
-  int i = 0;
-
-  for(; (addAfter.x != hull[i].x) && (addAfter.y != hull[i].y); ++i)
-    temp.push_back(hull[i]);
-
-  temp.push_back(toAdd);
-
-  for(; i < length; ++i)
-    temp.push_back(hull[i]);
-
-  hull = temp;
+// Checks one polygon of a batch, reporting rather than exiting on bad input.
+// Pre:  The batch, the name of the file and the file, mapped.
+// Post: The verdict is written to the ".hull" file. Returns false if the
+//       polygon could not be read or the file written; 'vertices' holds the
+//       number of points read.
+bool hullFile(batch& job, const string& name, edgeReader& poly,
+	      int& vertices) {
+  csr adj;        // The edges of the polygon
+  vset points;    // And its points
+  int edges;      // Number of edges, unused here
+  int answer;     // The verdict
+  FILE *out;      // The ".hull" file
+
+  if (!processInput(poly, adj, points, vertices, edges)) { return false; }
+  answer = verdict(points, adj);
+
+  out = fopen((name + ".hull").c_str(), "w");
+  if (out == NULL) { return false; }
+  fprintf(out, "%s\n", verdicts[answer]);
+  fclose(out);
+
+  if (answer == CONVEX) {
+    pthread_mutex_lock(&job.lock);
+    ++job.convex;
+    pthread_mutex_unlock(&job.lock);
+  }
+  return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 // Finds a point if an intersection occurs.
 // Pre:  'test' is the set of all points in the polygon and 'adj' is the 
-//       adjacency matrix.
+//       edges of the polygon.
 // Post: If an intersection is found, it is added to the avaible points,
-//       the adjacency matrix is updated and returns true. Returns false
-//       if unable to find an intersection.
-bool intersect(vset& test, vector< vector<int> >& adj) {
+//       the two edges crossing there are replaced by four to it and returns
+//       true. Returns false if unable to find an intersection.
+bool intersect(vset& test, csr& adj) {
   int first, second;                // The two indexes for the two points to
                                     // find an intersection
+  int i, j;                         // A neighbor of each
   int length = test.size();         // Save memory call
-  double a[2], b[2], c[2];             // Coefficiants for the two lines
-  double det;                       // The determinant
-  vector<int> row;                  // Used to add edge
   vertex alpha, beta, gamma, delta; // The four points of the two lines
   vertex point;                     // The intersection  
-  vector< vector<int> > temp;       // To add new edges
   
   if (verbose) { 
     printf("Entered intersect...\n");
@@ -432,11 +744,11 @@ bool intersect(vset& test, vector< vector<int> >& adj) {
       printf("Found missing edge...\n");
     
     // Check to see if there are more than one edge for each point.
-    if (!checkEdges(test, adj, first)) { return false; }
+    if (!checkEdges(adj, first)) { return false; }
     if (verbose)
       printf("Checked first point for multi-edges...\n");
 
-    if (!checkEdges(test, adj, second)) { return false; }
+    if (!checkEdges(adj, second)) { return false; }
     if (verbose)
       printf("Checked second point for multi-edges...\n");
     
@@ -445,95 +757,78 @@ bool intersect(vset& test, vector< vector<int> >& adj) {
     gamma = test[second];
 
     // for-loop to test if multiple edges for the point in question
-    for (int i = 0; i < length; ++i) {
-      if (adj[first][i] == 1) {
+    for (int p = adj.offset[first]; p < adj.offset[first + 1]; ++p) {
+      i = adj.neighbor[p];
 	
-	beta = test[i];
+      beta = test[i];
  
-	if (verbose)
-	  printf("Found first line...\n" \
-		 "Alpha (%.2f, %.2f), Beta(%.2f, %.2f)\n", 
-		 alpha.x, alpha.y, beta.x, beta.y);
+      if (verbose)
+	printf("Found first line...\n" \
+	       "Alpha (%.2f, %.2f), Beta(%.2f, %.2f)\n", 
+	       alpha.x, alpha.y, beta.x, beta.y);
 	
-	// Find coefficiants for first line
-	a[0] = beta.y - alpha.y;
-	b[0] = alpha.x - beta.x;
-	c[0] = alpha.x*beta.y - alpha.y*beta.x;
-
-	// for-loop to test if multiple edges for the point in question
-	for (int j = 0; j < length; ++j) {
-	  if (adj[second][j] == 1) {
-	    delta = test[j];
-	    
-	    if (verbose)
-	      printf("Found second line...\n" \
-		     "Gamma (%.2f, %.2f), Delta(%.2f, %.2f)\n",
-		     gamma.x, gamma.y, delta.x, delta.y);
+      // for-loop to test if multiple edges for the point in question
+      for (int q = adj.offset[second]; q < adj.offset[second + 1]; ++q) {
+	j = adj.neighbor[q];
+	delta = test[j];
 	    
-	    // Find coefficiants for second line
-	    a[1] = gamma.y - delta.y;
-	    b[1] = delta.x - gamma.x;
-	    c[1] = delta.x*gamma.y - delta.y*gamma.x;
-	    
-	    // Determine the determinant of the two lines
-	    det = a[0]*b[1] - a[1]*b[0];
-	    
-	    if (verbose)
-	      printf("Found determinant (%.2f)...\n", det);
-
-	    // If the determinant is parrallel, then it equals 0, and is not of
-	    //   our concern. Also avoids divide by zero.
-	    if (det != 0) {
-	      // Calculate the point of intersection
-	      point.x = (b[1]*c[0] - b[0]*c[1]) / det;
-	      point.y = (a[0]*c[1] - a[1]*c[0]) / det;
-	      
-	      if (verbose)
-		printf("Found intersection (%.2f, %.2f)\n", point.x, point.y);
-	      // Make sure intersection is within graph space, 
-	      //   otherwise, we have the wrong two lines
-	      if (isCorrect(test, alpha, beta, gamma, delta, point)) {
+	if (verbose)
+	  printf("Found second line...\n" \
+		 "Gamma (%.2f, %.2f), Delta(%.2f, %.2f)\n",
+		 gamma.x, gamma.y, delta.x, delta.y);
+
+	// Make sure the lines cross within graph space, otherwise, we have
+	//   the wrong two lines. Parallel lines are not of our concern.
+	if (isCorrect(alpha, beta, gamma, delta, point)) {
+	  if (verbose)
+	    printf("Found intersection (%.2f, %.2f)\n", point.x, point.y);
+
+	  if (verbose)
+	    printf("Is within parameters...\n" \
+		   "length = %i\n", length);
 		
-		if (verbose)
-		  printf("Is within parameters...\n" \
-			 "length = %i\n", length);
+	  // Add point to polygon
+	  test.push_back(point);
 		
-		// Add point to polygon
-		test.push_back(point);
+	  // Adjust length
+	  length = test.size();
 		
-		// Adjust length
-		length = test.size();
+	  if (verbose)
+	    printf("length = %i\n", length);
+
+	  // Remove edges, each end of the two now leading to the point
+	  //   instead
+	  adj.neighbor[p] = adj.neighbor[q] = length - 1;
+	  replace(adj.neighbor.begin() + adj.offset[i],
+		  adj.neighbor.begin() + adj.offset[i + 1],
+		  first, length - 1);
+	  replace(adj.neighbor.begin() + adj.offset[j],
+		  adj.neighbor.begin() + adj.offset[j + 1],
+		  second, length - 1);
 		
-		if (verbose)
-		  printf("length = %i\n", length);
-
-		if (length > MAXPOINTS) {
-		  printf("Error: Exceeded maximum vertices. Good bye!\n");
-		  exit(EXIT_FAILURE);
-		}
-
-		// Remove edges
-		adj[first][i] = adj[i][first] = 0;
-		adj[second][j] = adj[j][second] = 0;
-		
-		if (verbose)
-		  printf("Removed edges...\n" \
-			 "Made room for new edge...\n");
+	  if (verbose)
+	    printf("Removed edges...\n" \
+		   "Made room for new edge...\n");
 		
-		// Add edge
-		adj[first][length - 1] = adj[length - 1][first] = 1;
-		adj[second][length - 1] = adj[length - 1][second] = 1;
-		adj[i][length - 1] = adj[length - 1][i] = 1;
-		adj[j][length - 1] = adj[length - 1][j] = 1;
+	  // Add edge
+	  adj.neighbor.push_back(first);
+	  adj.neighbor.push_back(second);
+	  adj.neighbor.push_back(i);
+	  adj.neighbor.push_back(j);
+	  sort(adj.neighbor.begin() + adj.offset[length - 1],
+	       adj.neighbor.end());
+	  adj.neighbor.erase(unique(adj.neighbor.begin() +
+				    adj.offset[length - 1],
+				    adj.neighbor.end()),
+			     adj.neighbor.end());
+	  adj.offset.push_back(adj.neighbor.size());
+	  adj.vertices = length;
 		
-		if (verbose) {
-		  printAdj(length, adj);
-		  printf("Added edge...\n");
-		}
-		return true;
-	      }
-	    }
+	  if (verbose) {
+	    printAdj(adj);
+	    printf("Added edge...\n");
 	  }
+	  return true;
 	}
       }
     }
@@ -546,10 +841,10 @@ bool intersect(vset& test, vector< vector<int> >& adj) {
 
 ////////////////////////////////////////////////////////////////////////////////
 // Tests whether the polygon is a convex polygon
-// Pre:  'test' is the polygon in question and 'adj' is the adjacency matrix 
-//       for the polygon.
+// Pre:  'test' is the polygon in question and 'adj' is the edges of the
+//       polygon.
 // Post: Returns true if the polygon is convex, 'false' otherwise.
-bool isConvex(vset test, vector< vector<int> >& adj) {
+bool isConvex(const vset& test, const csr& adj) {
 
   int first, second; // Not needed for this function, but needed for function
                      //   call isMissingEdge
@@ -564,78 +859,61 @@ bool isConvex(vset test, vector< vector<int> >& adj) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Tests if the 'point' is actually on the line segments
-// Pre:  'test' is all the points in the polygon, 'alpha' and 'beta' are
-//       endpoints for one line and 'gamma' and 'delta' for another, and
-//       'point' is the vertex in question.
-// Post: Returns true if the point is within the polygon, on the line
-//       alpha->beta and on the line gamma->delta. Returns false if 
+// Tests if the lines alpha->beta and gamma->delta actually cross, exactly,
+//   by which side of each line the ends of the other are on.
+// Pre:  'alpha' and 'beta' are endpoints for one line and 'gamma' and
+//       'delta' for another, all with whole coordinates.
+// Post: Returns true if the lines are not parallel and meet on both line
+//       segments, at a point that is not one of the end points, and stores
+//       that point, which need not be whole, in 'point'. Returns false if
 //       any of those conditions fails.
-bool isCorrect(vset test, vertex alpha, vertex beta, 
-	       vertex gamma, vertex delta, vertex point) {
-  int north, east, south, west; // Make sure the intersection is within the
-                                // two lines
-
-  // Make sure point isn't one of the end points
-  if (((point.x != alpha.x) && (point.y != alpha.y)) ||
-      ((point.x != beta.x) && (point.y != beta.y)) ||
-      ((point.x != gamma.x) && (point.y != gamma.y)) ||
-      ((point.x != delta.x) && (point.y != delta.y))) {
-    
-    // Set perimeter of polygon to limit calculation
-    north = test[maxExtremeY(test)].y;
-    east = test[maxExtreme(test)].x;
-    south = test[minExtremeY(test)].y;
-    west = test[minExtreme(test)].x;
-    
-    // Test if point is within perimeter
-    if ((point.y >= south) && (point.y <= north) && 
-	(point.x >= west) && (point.x <= east)) {
-      
-      // Test if point is actually on existing line alpha->beta
-      if (alpha.x > beta.x) {
-	east = alpha.x;
-	west = beta.x;
-      }
-      else {
-	west = alpha.x;
-	east = beta.x;
-      }
-      if (alpha.y > beta.y) {
-	north = alpha.y;
-	south = beta.y;
-      }
-      else {
-	south = alpha.y;
-	north = beta.y;
-      }
-      if ((point.y >= south) && (point.y <= north) && 
-	  (point.x >= west) && (point.x <= east)) {
-	
-	// Test if point is actually on existing line gamma->delta
-	if (gamma.x > delta.x) {
-	  east = gamma.x;
-	  west = delta.x;
-	}
-	else {
-	  west = gamma.x;
-	  east = delta.x;
-	}
-	if (gamma.y > delta.y) {
-	  north = gamma.y;
-	  south = delta.y;
-	}
-	else {
-	  south = gamma.y;
-	  north = delta.y;
-	}
-	if ((point.y >= south) && (point.y <= north) && 
-	    (point.x >= west) && (point.x <= east)) { return true; }
-      }
-    } 
+bool isCorrect(vertex alpha, vertex beta, vertex gamma, vertex delta,
+	       vertex& point) {
+  long long a[2], b[2], c[2]; // Coefficiants for the two lines
+  long long det;              // The determinant
+  __int128 x, y;              // The intersection, times the determinant
+  vertex ends[4] = { alpha, beta, gamma, delta };
+  bool apart;                 // An end point differs from it in x and y
+
+  // If the determinant is parrallel, then it equals 0, and is not of
+  //   our concern. With coordinates below 2^31 it fits a long long.
+  a[0] = (long long)beta.y - (long long)alpha.y;
+  b[0] = (long long)alpha.x - (long long)beta.x;
+  a[1] = (long long)gamma.y - (long long)delta.y;
+  b[1] = (long long)delta.x - (long long)gamma.x;
+  det = a[0]*b[1] - a[1]*b[0];
+  if (det == 0) { return false; }
+
+  // Test if the ends of each line are on the same side of the other, in
+  //   which case the lines meet past the end of one of them
+  if (((side(alpha, beta, gamma) > 0) && (side(alpha, beta, delta) > 0)) ||
+      ((side(alpha, beta, gamma) < 0) && (side(alpha, beta, delta) < 0)) ||
+      ((side(gamma, delta, alpha) > 0) && (side(gamma, delta, beta) > 0)) ||
+      ((side(gamma, delta, alpha) < 0) && (side(gamma, delta, beta) < 0))) {
+    return false;
   }
-  
-  return false;
+
+  // Calculate the point of intersection, times the determinant so it is
+  //   whole; the products need more than a long long
+  c[0] = (long long)alpha.x*(long long)beta.y -
+    (long long)alpha.y*(long long)beta.x;
+  c[1] = (long long)delta.x*(long long)gamma.y -
+    (long long)delta.y*(long long)gamma.x;
+  x = (__int128)b[1]*c[0] - (__int128)b[0]*c[1];
+  y = (__int128)a[0]*c[1] - (__int128)a[1]*c[0];
+
+  // Make sure point isn't one of the end points: at least one of them must
+  //   differ from it in both x and y
+  apart = false;
+  for (int i = 0; i < 4; ++i) {
+    if ((x != (__int128)(long long)ends[i].x * det) &&
+	(y != (__int128)(long long)ends[i].y * det)) { apart = true; }
+  }
+  if (!apart) { return false; }
+
+  point.x = (double)x / (double)det;
+  point.y = (double)y / (double)det;
+  return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -644,18 +922,17 @@ bool isCorrect(vset test, vertex alpha, vertex beta,
 //   hull solution. This function also returns, thru the reference calls, the
 //   two points where the edge is missing.
 // Pre:  'first' and 'second' are empty, 'test' is the set of points for the 
-//       polygon and 'adj' is the adjacency matrix.
+//       polygon and 'adj' is the edges of the polygon.
 // Post: Returns true if there is a descrepancy between the polygon and the
 //       convex hull solution. The indicies for the endpoints where the line 
 //       should appear are filled into 'first' and 'second'.
-bool isMissingEdge(vset test, vector< vector<int> >& adj,
-		   int& first, int& second) {
+bool isMissingEdge(const vset& test, const csr& adj, int& first, int& second) {
 
   if (verbose) { printf("Entered isConvex...\n"); }
 
-  int hLen, len; // Used to save a memory call
-  int i, j;      // Iterators
-  vset hull;     // The convex hull solution
+  int hLen;         // Used to save a memory call
+  int i;            // Iterator
+  vector<int> hull; // The convex hull solution, as indices of points
 
   if (verbose)
     printf("Entered isMissingEdge...\n");
@@ -663,12 +940,11 @@ bool isMissingEdge(vset test, vector< vector<int> >& adj,
   // Set values
   hull = quickHull(test);
   hLen = hull.size();
-  len = test.size();
   
   if (verbose) {
     printf("Convex Hull:\n");
     for (unsigned int i = 0; i < hull.size(); ++i)
-      printf("(%.2f, %.2f)\n", hull[i].x, hull[i].y);
+      printf("(%.2f, %.2f)\n", test[hull[i]].x, test[hull[i]].y);
   }
   
   if (verbose)
@@ -676,30 +952,17 @@ bool isMissingEdge(vset test, vector< vector<int> >& adj,
   
   for (i = 0; i < hLen; ++i) {
 
-    // Find the first point in the polygon that is part of the convex sol'n
-    for (j = 0; j < len; ++j) {
-      if ((hull[i].x == test[j].x) &&
-	  (hull[i].y == test[j].y)) {
-       		
-	first = j;
-	break;
-      }
-    }
-    // Find the second point in the polygon that is part of the convex sol'n
-    for (j = 0; j < len; ++j) {
-      if ((hull[(i + 1)%hLen].x == test[j].x) &&
-	  (hull[(i + 1)%hLen].y == test[j].y)) {
-	
-	second = j;
-	break;
-      } 
-    }     
+    // The two points in the polygon that are next to each other on the
+    //   convex sol'n
+    first = hull[i];
+    second = hull[(i + 1)%hLen];
       
     // Test to see if there is an edge there
     if (verbose)
-      printf("adj[%i][%i] = %i\n", first, second, adj[first][second]);
+      printf("adj[%i][%i] = %i\n", first, second,
+	     hasEdge(adj, first, second));
     
-    if (adj[first][second] == 0) { 
+    if (!hasEdge(adj, first, second)) { 
       if (verbose)
 	printf("Failed! first = %i, second = %i\n", first, second);
       return true; }
@@ -729,98 +992,231 @@ bool isQuit(const string& expr) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Imports the polygon from a file and adds to a queue
-// Pre:  'fp' is the file name where the polygon is stored.
-// Post: The contents of the file are imported into the queue 'poly'.
-bool loadPoly(string fp, queue<string>& poly) {
-  string extract;
+// Lists the polygons of a batch: the names in a manifest, one per line, or
+//   the matches of a wildcard pattern.
+// Post: The names are added to 'names'. Exits if none are found.
+void listBatch(string source, vector<string>& names) {
+  ifstream manifest;  // File listing the polygons
+  string line;        // One name from it
+  glob_t matches;     // Files matching a pattern
+
+  if (source.find_first_of("*?[") != string::npos) {
+    if (glob(source.c_str(), 0, NULL, &matches) == 0) {
+      names.insert(names.end(), matches.gl_pathv,
+		   matches.gl_pathv + matches.gl_pathc);
+    }
+    globfree(&matches);
+  }
+  else {
+    manifest.open(source.c_str());
+    if (manifest.fail()) {
+      printf("Manifest file opening failed.\nGood Bye!\n");
+      exit(EXIT_FAILURE);
+    }
+    while (getline(manifest, line)) {
+      if (!line.empty()) { names.push_back(line); }
+    }
+    manifest.close();
+  }
 
+  if (names.empty()) {
+    printf("No polygons to check.\nGood Bye!\n");
+    exit(EXIT_FAILURE);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Maps the polygon file into memory, to be read in place.
+// Pre:  'fp' is the file name where the polygon is stored.
+// Post: The file is mapped and 'poly' is left at its start. Returns false if
+//       it cannot be read.
+bool loadPoly(string fp, edgeReader& poly) {
   if (isQuit(fp)) { return false; }
 
-  input.open(fp.c_str());
-  if (input.fail()) {
+  if (!openEdges(fp, poly)) {
     printf("Error loading file <%s>. Please try again.\n", fp.c_str());
     return false;
   }
 
-  while(input.good()) {
-    input >> extract;
-    poly.push(extract);
-  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////
 
-  input.close();
-  if (input.fail()) {
-    printf("Error closing file <%s>. Please try again.\n", fp.c_str());
+////////////////////////////////////////////////////////////////////////////////
+// Maps a polygon file into memory for reading.
+//   Pre:  The name of the file and the reader to open.
+//   Post: Returns false if the file cannot be read.
+bool openEdges(string fp, edgeReader& in) {
+  int fd;
+  struct stat info;
+
+  in.data = NULL;
+  in.size = 0;
+  fd = open(fp.c_str(), O_RDONLY);
+  if (fd < 0) { return false; }
+  if (fstat(fd, &info) < 0) {
+    close(fd);
     return false;
   }
 
+  in.size = info.st_size;
+  if (in.size > 0) {
+    in.data = (const char *)mmap(NULL, in.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (in.data == MAP_FAILED) {
+      in.data = NULL;
+      close(fd);
+      return false;
+    }
+    madvise((void *)in.data, in.size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  in.next = in.edges = in.data;
+  in.end = in.data + in.size;
   return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Used to find the farthest east (or largest) x vertex
-// Pre:  The set of points in the polygon.
-// Post: The index of the farthest east point in the polygon (largest x-value)
-int maxExtreme(vset points) {
-  int max = 0, length = points.size();
-
-  for(int i = 1; i < length; ++i) {
-    if (points[max].x < points[i].x) { max = i; }
+// Reads the next record of a polygon file: the characters up to a space or
+//   the end of a line, holding numbers of any width separated by commas, and
+//   perhaps within parentheses, as in (x,y).
+//   Pre:  Room for 'fields' numbers in 'value'.
+//   Post: Returns 1 with the numbers stored in 'value', 0 at the end of the
+//         file, or -1 if the record is not 'fields' numbers of that form.
+int nextRecord(edgeReader& in, int fields, int *value) {
+  const char *next = in.next, *end = in.end;
+  bool paren;         // Whether the record is within parentheses
+  int field = 0;      // Numbers read so far
+  uint64_t number;    // The one being read
+
+  while ((next < end) && isspace((unsigned char)*next)) { ++next; }
+  in.next = next;
+  if (next == end) { return 0; }
+
+  paren = (*next == '(');
+  if (paren) { ++next; }
+  for (;;) {
+    if ((field == fields) || (next == end) ||
+	!isdigit((unsigned char)*next)) { return -1; }
+    next = parseDigits(next, end, number);
+    if (number > INT_MAX) { return -1; }
+    value[field++] = (int)number;
+
+    if ((next == end) || (*next != ',')) { break; }
+    ++next;
   }
-  return max;
+  if (paren) {
+    if ((next == end) || (*next != ')')) { return -1; }
+    ++next;
+  }
+  if ((field != fields) ||
+      ((next < end) && !isspace((unsigned char)*next))) { return -1; }
+
+  in.next = next;
+  return 1;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Used to find the farthest west (or smallest) x vertex
-// Pre:  The set of points in the polygon.
-// Post: The index of the farthest west point in the polygon (smallest x-value)
-int minExtreme(vset points) {
-  int min = 0, length = points.size();
+// Converts the run of digits at 'next', eight characters at a time.
+//   Pre:  'next' points at a digit and 'end' bounds the file.
+//   Post: The value of the run is stored in 'value' and a pointer just past
+//         the last digit is returned. A run too long for an int stops early
+//         with 'value' above INT_MAX.
+const char *parseDigits(const char *next, const char *end, uint64_t &value) {
+  static const unsigned int scale[9] = { 1, 10, 100, 1000, 10000, 100000,
+					  1000000, 10000000, 100000000 };
+  uint64_t chunk, stop; // Eight characters and the non-digits among them
+  int digits;           // Leading digits in the chunk
+
+  value = 0;
+#if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while ((end - next) >= 8) {
+    memcpy(&chunk, next, 8);
+    chunk ^= 0x3030303030303030ULL; // '0' through '9' become 0 through 9
+
+    // High bit of a byte is set wherever it is not a digit
+    stop = (((chunk & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | chunk)
+      & 0x8080808080808080ULL;
+    digits = stop ? (__builtin_ctzll(stop) >> 3) : 8;
+    if (digits == 0) { return next; }
+
+    // Shift out the rest so the digits are led by zeros, then combine pairs
+    chunk <<= 8 * (8 - digits);
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+    value = value * scale[digits] + chunk;
+    next += digits;
+    if ((digits < 8) || (value > INT_MAX)) { return next; }
+  }
+#endif
 
-  for(int i = 1; i < length; ++i) { 
-    if (points[min].x > points[i].x) { min = i; }
+  // Tail of the file, one character at a time
+  for (; (next < end) && isdigit((unsigned char)*next); ++next) {
+    value = value * 10 + (*next - '0');
+    if (value > INT_MAX) { return next + 1; }
   }
-  return min;
+  return next;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Used to find the farthest north (or largest) y vertex
+// Goes back to the first edge of a polygon file, to read the edges again.
+void rewindEdges(edgeReader& in) {
+  in.next = in.edges;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Unmaps a polygon file.
+void closeEdges(edgeReader& in) {
+  if (in.data != NULL) { munmap((void *)in.data, in.size); }
+  in.data = NULL;
+  in.size = 0;
+  in.next = in.edges = in.end = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Used to find the farthest east (or largest) x vertex
 // Pre:  The set of points in the polygon.
-// Post: The index of the farthest north point in the polygon (largest y-value)
-int maxExtremeY(vset points) {
+// Post: The index of the farthest east point in the polygon (largest x-value)
+int maxExtreme(const vset& points) {
   int max = 0, length = points.size();
 
   for(int i = 1; i < length; ++i) {
-    if (points[max].y < points[i].y) { max = i; }
+    if (points[max].x < points[i].x) { max = i; }
   }
   return max;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Used to find the farthest south (or smallest) y vertex
+// Used to find the farthest west (or smallest) x vertex
 // Pre:  The set of points in the polygon.
-// Post: The index of the farthest south point in the polygon (smallest y-value)
-int minExtremeY(vset points) {
+// Post: The index of the farthest west point in the polygon (smallest x-value)
+int minExtreme(const vset& points) {
   int min = 0, length = points.size();
 
   for(int i = 1; i < length; ++i) { 
-    if (points[min].y > points[i].y) { min = i; }
+    if (points[min].x > points[i].x) { min = i; }
   }
   return min;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Prints Adjacency Matrix
-// Pre:  Size of adjacency matrix is length by length.
-void printAdj(int length, vector< vector<int> > adj) {
-  for (int i = 0; i < length; ++i) {
-    for (int j = 0; j < length; ++j){
-      printf("%i ", adj[i][j]);
+// Prints the neighbors of each vertex
+// Pre:  'adj' is the edges of the polygon.
+void printAdj(const csr& adj) {
+  for (int i = 0; i < adj.vertices; ++i) {
+    printf("%i:", i);
+    for (int j = adj.offset[i]; j < adj.offset[i + 1]; ++j){
+      printf(" %i", adj.neighbor[j]);
     }
     printf("\n");
   }	        
@@ -828,75 +1224,91 @@ void printAdj(int length, vector< vector<int> > adj) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// Create the adjacency matrix for the polygon and add the points to a vector
+// Reads the points of the polygon into a vector and its edges into 'adj'
 // Pre:  The 'points', 'adj', 'vertices' and 'edges' have not been assigned
-//       values. The queue 'poly' is the unprocessed input from the file.
-// Post: An adjacency matrix of the edges in the polygon, the number of edges
-//       and verticies, and a set of all the points are filled in.
-bool processInput(queue<string>& poly, vector< vector<int> >& adj,
-		  vector<vertex>& points, int& vertices, int& edges) {
-  int i;  // Iterator
-  int x, y; // Used to store the integer digits
-  int length; // Used to save a memory call
-  vector<int> row;
-  string temp;
-  string tempx, tempy; // Used to store the asci digits
-  bool passedDash = false;
+//       values. 'poly' is the file, mapped and at its start.
+// Post: The edges of the polygon, in compressed sparse row form, the number
+//       of edges and verticies, and a set of all the points are filled in.
+//       The edges are read twice: once to count each vertex's neighbors and
+//       once to place them. Returns false on bad input.
+bool processInput(edgeReader& poly, csr& adj, vset& points,
+		  int& vertices, int& edges) {
+  int value[2];      // The two numbers of a record
+  int found;         // Whether it was read, from nextRecord()
+  int at;            // Where the next neighbor goes when compacting
   vertex extracted;
 
   // Make sure inputs are empty
   vertices = edges = 0;
-  adj.clear();
   points.clear();
 
-  // Create adjacency and points matrix while checking for bad input
-  while(!poly.empty()) {  
-    temp = poly.front();
-    poly.pop();
-
-    // Test to see if before or after the dash
-    if (temp[0] == '-') {
-      passedDash = true;
+  // The points come first, each in form (#,#), up to the dash
+  while ((found = nextRecord(poly, 2, value)) > 0) {
+    extracted.x = value[0];
+    extracted.y = value[1];
+    points.push_back(extracted);
+    vertices++;
+  }
+  if (found < 0) {
+    if ((*poly.next != '-') || ((poly.next + 1 < poly.end) &&
+				!isspace((unsigned char)poly.next[1]))) {
+      printf("Invalid character in graph.\n");
+      return false;
+    }
+    ++poly.next;
+  }
+  poly.edges = poly.next;
+  if (vertices == 0) {
+    printf("The polygon has no vertices.\n");
+    return false;
+  }
 
-      // Zero out adjacency and points matrix
-      length = points.size();
-      for (i = 0; i < MAXPOINTS; ++i) { row.push_back(0); }
-      for (i = 0; i < MAXPOINTS; ++i) { adj.push_back(row); }
+  // First pass: count each vertex's neighbors while checking for bad input
+  adj.vertices = vertices;
+  adj.offset.assign(vertices + 1, 0);
+  while ((found = nextRecord(poly, 2, value)) > 0) {
+    if ((value[0] >= vertices) || (value[1] >= vertices)) {
+      printf("Edge (%i,%i) names a vertex not in the polygon.\n",
+	     value[0], value[1]);
+      return false;
     }
-    else {
-      // Make sure input is in form (#,#) where # is a single digit (0-9)
-      if(!(isdigit(temp[1]) &&
-	   isdigit(temp[3]))) {
-	printf("Invalid character in graph.\n");
-	return false;
-      }
-      
-      // Convert the ascii digits to integers
-      tempx = temp[1];
-      tempy = temp[3];
-      x = atoi(tempx.c_str());
-      y = atoi(tempy.c_str());
-      
-      // If after the dash, create adjacency matrix of the edges
-      if (passedDash) {
-	adj[x][y] = 1;
-	adj[y][x] = 1;
-	edges++;
-      }
-      else { // If before the dash, add vertices to points vector
-	extracted.x = x;
-	extracted.y = y;
-	points.push_back(extracted);
-	vertices++;
-      }
-      
-      // Reset varibles
-      x = y = 0;
-      temp.clear();
-      tempx.clear();
-      tempy.clear();
+    ++adj.offset[value[0] + 1];
+    ++adj.offset[value[1] + 1];
+    edges++;
+  }
+  if (found < 0) {
+    printf("Invalid character in graph.\n");
+    return false;
+  }
+  for (int v = 0; v < vertices; ++v) {
+    if (adj.offset[v + 1] > (INT_MAX - adj.offset[v])) {
+      printf("Polygon has too many edges.\n");
+      return false;
     }
+    adj.offset[v + 1] += adj.offset[v];
+  }
+
+  // Second pass: read the edges again, placing each under both of its ends
+  vector<int> next(adj.offset.begin(), adj.offset.end() - 1);
+  adj.neighbor.resize(adj.offset[vertices]);
+  rewindEdges(poly);
+  while (nextRecord(poly, 2, value) > 0) {
+    adj.neighbor[next[value[0]]++] = value[1];
+    adj.neighbor[next[value[1]]++] = value[0];
+  }
+
+  // Put each vertex's neighbors in order, dropping edges given twice
+  at = 0;
+  for (int v = 0; v < vertices; ++v) {
+    vector<int>::iterator first = adj.neighbor.begin() + adj.offset[v];
+    vector<int>::iterator last = adj.neighbor.begin() + adj.offset[v + 1];
+    sort(first, last);
+    last = unique(first, last);
+    adj.offset[v] = at;
+    at = copy(first, last, adj.neighbor.begin() + at) - adj.neighbor.begin();
   }
+  adj.offset[vertices] = at;
+  adj.neighbor.resize(at);
 
   return true;
 }
@@ -905,30 +1317,30 @@ bool processInput(queue<string>& poly, vector< vector<int> >& adj,
 ////////////////////////////////////////////////////////////////////////////////
 // Sets up the inital environment for the quickHull search
 // Pre:  The set of all the vertices in the polygon.
-// Post: A convex hull solution is returned.
-vset quickHull (vset sample) {
-  vset hull;        // The convex hull found
-  vset left, right; // The set above the line created from the max/min line
-  vertex max, min;  // The minimum and maximum points in the set
+// Post: The indices of the points of the convex hull are returned, in order
+//       around it.
+vector<int> quickHull(const vset& sample) {
+  vector<int> hull;    // The convex hull found, in order
+  vector<int> outside; // Every point, to be split by the line max to min
+  int max, min;        // The minimum and maximum points in the set
 
   if (verbose)
     printf("Entered quickHull...\n");
 
   // Find the extreme vertices
-  max = sample[maxExtreme(sample)];
-  min = sample[minExtreme(sample)];
+  max = maxExtreme(sample);
+  min = minExtreme(sample);
 
-  // Add the extreme vertices to the solution
+  // Every point is a candidate to begin with
+  outside.resize(sample.size());
+  for (unsigned int i = 0; i < sample.size(); ++i) { outside[i] = i; }
+
+  // Split the set in two and add each side of the hull in turn, from the
+  //   extreme vertices, going from max to min and back
   hull.push_back(max);
+  findHull(sample, split(sample, max, min, outside), max, min, hull);
   hull.push_back(min);
-
-  // Split the set in two
-  left = split(min, max, sample);
-  right = split(max, min, sample);
-
-  // Begin split recursion
-  findHull(left, min, max, hull);
-  findHull(right, max, min, hull);
+  findHull(sample, split(sample, min, max, outside), min, max, hull);
 
   if (verbose)
     printf("Exiting quickHull...\n");
@@ -939,38 +1351,180 @@ vset quickHull (vset sample) {
 
 ////////////////////////////////////////////////////////////////////////////////
 // Splits the set of points into two sets, one above the line and one below
-// Pre:  'alpha' and 'beta' are the endpoints of a line and 'sample' is the 
-//       available points to be sorted.
-// Post: Returns a subset of 'sample' where all the points are to the left of
-//       the directed line, alpha->beta.
-vset split(vertex alpha, vertex beta, vset sample) {
-  int a, b, c; // Used for linear algebra
+// Pre:  'alpha' and 'beta' are the indices of the endpoints of a line and
+//       'sample' is the indices of the available points to be sorted.
+// Post: Returns the indices of those of 'sample' to the left of the directed
+//       line, alpha->beta.
+vector<int> split(const vset& points, int alpha, int beta,
+		  const vector<int>& sample) {
   int length;  // Used to save a memory call
-  vertex test; // The vertex we are testing
-  vset above;
+  vector<int> above;
 
   // Set length
   length = sample.size();
-  
-  // Find coefficiants
-  a = beta.y - alpha.y;
-  b = alpha.x - beta.x;
-  c = alpha.x*beta.y - alpha.y*beta.x;
 
   // Split above and below the line. Points on the line can be ignored, 
   //   (are not on the convex hull since they are between points.)
   for (int i = 0; i < length; ++i) {
-    test = sample[i];
-    if ((a*test.x + b*test.y - c) > 0) { above.push_back(test); }
+    if (side(points[alpha], points[beta], points[sample[i]]) > 0) {
+      above.push_back(sample[i]);
+    }
   }
 
   return above;
 }
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// Decides what the figure is: a convex polygon, a polygon that is not
+//   convex, or not a polygon.
+// Pre:  'points' and 'adj' are the polygon as read.
+// Post: Returns CONVEX, NON_CONVEX or NOT_POLYGON, the verdict's place in
+//       'verdicts'. An intersection found is added to the polygon.
+int verdict(vset& points, csr& adj) {
+  if (isConvex(points, adj)) { return CONVEX; }
+  if (intersect(points, adj)) { return NON_CONVEX; }
+  return NOT_POLYGON;
+}
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Sets up the timing of a run, opening the hardware counters if asked to.
+//   Counters the system will not give are reported as unavailable.
+void openProfile(profile& prof, bool counting) {
+#ifdef __linux__
+  static const unsigned long long config[COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+  struct perf_event_attr attr;
+#endif
+
+  prof.phases.clear();
+  for (int k = 0; k < COUNTERS; ++k) {
+    prof.fd[k] = -1;
+#ifdef __linux__
+    if (!counting) { continue; }
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[k];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count the threads started later too
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+    prof.fd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Starts timing a phase, by name; a phase seen before carries on adding up.
+void startPhase(profile& prof, const char *name) {
+  phase fresh;   // A phase not seen before
+  size_t i;
+
+  for (i = 0; i < prof.phases.size(); ++i) {
+    if (strcmp(prof.phases[i].name, name) == 0) { break; }
+  }
+  if (i == prof.phases.size()) {
+    fresh.name = name;
+    fresh.seconds = 0;
+    for (int k = 0; k < COUNTERS; ++k) {
+      fresh.count[k] = (prof.fd[k] < 0) ? -1 : 0;
+    }
+    prof.phases.push_back(fresh);
+  }
+  prof.current = i;
+
+  for (int k = 0; k < COUNTERS; ++k) { prof.base[k] = readCounter(prof.fd[k]); }
+  clock_gettime(CLOCK_MONOTONIC, &prof.start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Stops timing the current phase and adds its time and counts to it.
+void endPhase(profile& prof) {
+  struct timespec stop;
+  phase &done = prof.phases[prof.current];
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  done.seconds += (stop.tv_sec - prof.start.tv_sec) +
+    (stop.tv_nsec - prof.start.tv_nsec) / 1e9;
+  for (int k = 0; k < COUNTERS; ++k) {
+    if (prof.fd[k] >= 0) {
+      done.count[k] += readCounter(prof.fd[k]) - prof.base[k];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads a hardware counter, scaled up for any time the kernel had it
+//   multiplexed off the processor.
+long long readCounter(int fd) {
+  unsigned long long value[3]; // Count, time enabled and time running
+
+  if ((fd < 0) || (read(fd, value, sizeof(value)) != sizeof(value))) {
+    return 0;
+  }
+  if ((value[2] == 0) || (value[2] >= value[1])) { return value[0]; }
+  return (long long)((double)value[0] * value[1] / value[2]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Prints the time and counters of each phase: as a table on standard output,
+//   or as one line of JSON on standard error.
+void reportProfile(profile& prof, bool json) {
+  if (json) {
+    fflush(stdout);
+    fprintf(stderr, "{\"tool\": \"quickHull\", \"phases\": [");
+    for (size_t i = 0; i < prof.phases.size(); ++i) {
+      fprintf(stderr, "%s{\"name\": \"%s\", \"seconds\": %.6f",
+	      i ? ", " : "", prof.phases[i].name, prof.phases[i].seconds);
+      for (int k = 0; k < COUNTERS; ++k) {
+	if (prof.phases[i].count[k] < 0) {
+	  fprintf(stderr, ", \"%s\": null", counterNames[k]);
+	}
+	else {
+	  fprintf(stderr, ", \"%s\": %lld", counterNames[k],
+		  prof.phases[i].count[k]);
+	}
+      }
+      fprintf(stderr, "}");
+    }
+    fprintf(stderr, "]}\n");
+    return;
+  }
+
+  printf("%-10s %12s", "Phase", "Seconds");
+  for (int k = 0; k < COUNTERS; ++k) { printf(" %14s", counterNames[k]); }
+  printf("\n");
+  for (size_t i = 0; i < prof.phases.size(); ++i) {
+    printf("%-10s %12.6f", prof.phases[i].name, prof.phases[i].seconds);
+    for (int k = 0; k < COUNTERS; ++k) {
+      if (prof.phases[i].count[k] < 0) { printf(" %14s", "n/a"); }
+      else { printf(" %14lld", prof.phases[i].count[k]); }
+    }
+    printf("\n");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////
 // Prints out instructions on the use of command line options.
 void usage() {
-  printf("Add flag -v to turn verbose on.");
+  printf("Add flag -v to turn verbose on, with the time and counters of each\n"
+	 "phase, or -j for those as JSON on standard error.\n"
+	 "Add -m <list> to check each polygon named in a manifest, or matching\n"
+	 "a quoted pattern, into <file>.hull, on -p <threads> threads (every\n"
+	 "processor by default).\n");
 }
 ////////////////////////////////////////////////////////////////////////////////